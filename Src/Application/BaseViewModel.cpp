@@ -3,6 +3,8 @@
 #include "IView.h"
 #include "IResourceRepository.h"
 
+#include <API/GEM_ContentStoreItem.h>
+
 BaseViewModel::BaseViewModel( IMapService* mapService, INavigationService* navigationService, IViewModelListener* listener )
     : m_mapService( mapService )
     , m_navigationService( navigationService )
@@ -10,10 +12,16 @@ BaseViewModel::BaseViewModel( IMapService* mapService, INavigationService* navig
     , m_mapView( mapService->GetMapView() )
 {
     m_mapService->AddListener( this );
+
+    if (auto resourceRepository = m_mapService->GetResourceRepository())
+        resourceRepository->AddListener( this );
 }
 
 BaseViewModel::~BaseViewModel()
 {
+    if (auto resourceRepository = m_mapService->GetResourceRepository())
+        resourceRepository->RemoveListener( this );
+
     m_mapService->RemoveListener( this );
 }
 
@@ -100,6 +108,34 @@ void BaseViewModel::OnMapServiceEvent( EMapServiceEvent event )
     }
 }
 
+void BaseViewModel::OnResourceUpdated( EResourceType resType )
+{
+    // the items were replaced, their progress is read again from the SDK
+    m_downloadProgress.clear();
+}
+
+void BaseViewModel::OnDownloadProgress( gem::LargeInteger itemId, int progress )
+{
+    m_downloadProgress[itemId] = progress;
+}
+
+void BaseViewModel::OnDownloadFinished( gem::LargeInteger itemId, int reason )
+{
+    m_downloadProgress.erase( itemId );
+}
+
+int BaseViewModel::GetDownloadProgress( const gem::ContentStoreItem& item )
+{
+    auto it = m_downloadProgress.find( item.getId() );
+    if (it != m_downloadProgress.end())
+        return it->second;
+
+    int progress = item.getDownloadProgress();
+    m_downloadProgress[item.getId()] = progress;
+
+    return progress;
+}
+
 void BaseViewModel::SetMenuItems( const MenuItems& items )
 {
     m_menuItems = items;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "IMapService.h"
+#include "IResourceRepository.h"
 
 #include "IViewModel.h"
 #include "IViewModelListener.h"
@@ -10,10 +11,11 @@
 #include "INavigationService.h"
 
 #include <functional>
+#include <unordered_map>
 
 class IView;
 
-class BaseViewModel : public IViewModel, public IMapServiceListener
+class BaseViewModel : public IViewModel, public IMapServiceListener, public IResourceRepositoryListener
 {
 public:
     BaseViewModel( IMapService* mapService, INavigationService* navigationService, IViewModelListener* listener );
@@ -41,6 +43,14 @@ public:
     // IMapServiceListener methods
     void OnMapServiceEvent( EMapServiceEvent event ) override;
 
+    // IResourceRepositoryListener methods
+    void OnResourceUpdated( EResourceType resType ) override;
+    void OnDownloadProgress( gem::LargeInteger itemId, int progress ) override;
+    void OnDownloadFinished( gem::LargeInteger itemId, int reason ) override;
+
+    // last reported progress of a running download (the SDK is queried for items without a report yet)
+    int GetDownloadProgress( const gem::ContentStoreItem& item );
+
 protected:
     void SetMenuItems( const MenuItems& items );
 
@@ -58,4 +68,6 @@ protected:
     std::vector<std::string> m_menuCaptions;
 
     Action m_action;
+
+    std::unordered_map<gem::LargeInteger, int> m_downloadProgress;
 };
@@ -0,0 +1,130 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "BitmapBufferPool.h"
+
+// smallest size class (32x32 RGBA)
+const size_t MIN_SIZE_CLASS = 4 * 1024;
+
+// free buffers kept for reuse, the rest is released
+const size_t DEFAULT_MAX_POOLED_BYTES = 16 * 1024 * 1024;
+
+BitmapBufferPool& BitmapBufferPool::Instance()
+{
+    static BitmapBufferPool pool;
+
+    return pool;
+}
+
+BitmapBufferPool::BitmapBufferPool()
+    : m_maxPooledBytes( DEFAULT_MAX_POOLED_BYTES )
+{
+
+}
+
+BitmapBufferPool::~BitmapBufferPool()
+{
+    Clear();
+}
+
+unsigned char* BitmapBufferPool::Lease( size_t bytes )
+{
+    size_t sizeClass = GetSizeClass( bytes );
+
+    {
+        std::lock_guard<std::mutex> guard( m_sync );
+
+        m_stats.leases++;
+
+        auto it = m_freeBuffers.find( sizeClass );
+        if ( it != m_freeBuffers.end() && !it->second.empty() )
+        {
+            unsigned char* buffer = it->second.back();
+            it->second.pop_back();
+
+            m_stats.reuses++;
+            m_stats.pooledBytes -= sizeClass;
+
+            return buffer;
+        }
+
+        m_stats.allocations++;
+    }
+
+    return new unsigned char[sizeClass];
+}
+
+void BitmapBufferPool::Return( unsigned char* buffer, size_t bytes )
+{
+    if ( !buffer )
+        return;
+
+    size_t sizeClass = GetSizeClass( bytes );
+
+    {
+        std::lock_guard<std::mutex> guard( m_sync );
+
+        if ( m_stats.pooledBytes + sizeClass <= m_maxPooledBytes )
+        {
+            m_freeBuffers[sizeClass].push_back( buffer );
+            m_stats.pooledBytes += sizeClass;
+
+            return;
+        }
+    }
+
+    delete[] buffer;
+}
+
+size_t BitmapBufferPool::GetSizeClass( size_t bytes )
+{
+    size_t sizeClass = MIN_SIZE_CLASS;
+
+    while ( sizeClass < bytes )
+        sizeClass <<= 1;
+
+    return sizeClass;
+}
+
+void BitmapBufferPool::SetMaxPooledBytes( size_t maxPooledBytes )
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    m_maxPooledBytes = maxPooledBytes;
+
+    // drop the biggest buffers first
+    for ( auto it = m_freeBuffers.rbegin(); it != m_freeBuffers.rend() && m_stats.pooledBytes > m_maxPooledBytes; ++it )
+    {
+        while ( !it->second.empty() && m_stats.pooledBytes > m_maxPooledBytes )
+        {
+            delete[] it->second.back();
+            it->second.pop_back();
+
+            m_stats.pooledBytes -= it->first;
+        }
+    }
+}
+
+BitmapPoolStats BitmapBufferPool::GetStats() const
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    return m_stats;
+}
+
+void BitmapBufferPool::Clear()
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    for ( auto& it : m_freeBuffers )
+        for ( auto buffer : it.second )
+            delete[] buffer;
+
+    m_freeBuffers.clear();
+    m_stats.pooledBytes = 0;
+}
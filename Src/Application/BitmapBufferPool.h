@@ -0,0 +1,62 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include <map>
+#include <vector>
+#include <mutex>
+
+struct BitmapPoolStats
+{
+    BitmapPoolStats()
+        : leases( 0 )
+        , reuses( 0 )
+        , allocations( 0 )
+        , pooledBytes( 0 )
+    {}
+
+    size_t leases;
+    size_t reuses;      // leases served from the pool
+    size_t allocations; // leases that needed a new buffer
+    size_t pooledBytes; // free buffers kept for reuse
+};
+
+// Pixel buffers for BitmapImpl, grouped in power of two size classes and reused
+// instead of being allocated for each texture. Thread safe (bitmaps are rendered on workers).
+class BitmapBufferPool
+{
+public:
+    static BitmapBufferPool& Instance();
+
+    // the buffer has at least 'bytes' bytes; its contents are undefined
+    unsigned char* Lease( size_t bytes );
+    void Return( unsigned char* buffer, size_t bytes );
+
+    // actual size of the buffer leased for 'bytes'
+    static size_t GetSizeClass( size_t bytes );
+
+    void SetMaxPooledBytes( size_t maxPooledBytes );
+
+    BitmapPoolStats GetStats() const;
+
+    void Clear();
+
+private:
+    BitmapBufferPool();
+    ~BitmapBufferPool();
+
+private:
+    std::map<size_t, std::vector<unsigned char*>> m_freeBuffers; // size class -> free buffers
+
+    size_t m_maxPooledBytes;
+
+    BitmapPoolStats m_stats;
+
+    mutable std::mutex m_sync;
+};
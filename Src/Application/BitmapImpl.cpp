@@ -8,20 +8,22 @@
 
 #include "BitmapImpl.h"
 
+#include "BitmapBufferPool.h"
+
 #include <cstdlib>
+#include <cstring>
 
-BitmapImpl::BitmapImpl( int width, int height )
+BitmapImpl::BitmapImpl( int width, int height, bool bClear /*= true*/ )
     : m_buffer( nullptr )
+    , m_bufferSize( 0 )
+    , m_bClear( bClear )
 {
     resize( width, height );
 }
 
 BitmapImpl::~BitmapImpl()
 {
-    if( m_buffer )
-    {
-        delete[] m_buffer;
-    }
+    releaseBuffer();
 }
 
 gem::EImagePixelFormat BitmapImpl::encoding() const
@@ -64,12 +66,31 @@ void BitmapImpl::resize( int w, int h )
     m_size = gem::Size( w, h );
     m_viewport = gem::Rect( 0, 0, w, h );
 
-    if( m_buffer )
-        delete[] m_buffer;
+    size_t bufferSize = (size_t)w * (size_t)h * 4;
+
+    // keep the current buffer if it's from the same size class
+    if( m_buffer && BitmapBufferPool::GetSizeClass( bufferSize ) != BitmapBufferPool::GetSizeClass( m_bufferSize ) )
+        releaseBuffer();
 
     if( w && h )
     {
-        m_buffer = new unsigned char[(size_t)w * (size_t)h * 4];
-        clear();
+        if( !m_buffer )
+            m_buffer = BitmapBufferPool::Instance().Lease( bufferSize );
+
+        m_bufferSize = bufferSize;
+
+        if( m_bClear )
+            clear();
     }
+    else
+        releaseBuffer();
+}
+
+void BitmapImpl::releaseBuffer()
+{
+    if( m_buffer )
+        BitmapBufferPool::Instance().Return( m_buffer, m_bufferSize );
+
+    m_buffer = nullptr;
+    m_bufferSize = 0;
 }
@@ -13,7 +13,8 @@
 class BitmapImpl : public gem::IBitmap
 {
 public:
-    BitmapImpl( int width, int height );
+    // bClear = false when the renderer overwrites every pixel (the pooled buffer contents are undefined)
+    BitmapImpl( int width, int height, bool bClear = true );
     ~BitmapImpl();
 
     // gem::IRenderContext methods
@@ -33,8 +34,13 @@ public:
 
     void resize( int w, int h );
 
+private:
+    void releaseBuffer();
+
 private:
     gem::Size m_size;
     gem::Rect m_viewport;
     unsigned char* m_buffer;
+    size_t m_bufferSize;
+    bool m_bClear;
 };
@@ -0,0 +1,139 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "ContentCatalog.h"
+
+#include "IResourceRepository.h"
+
+ContentCatalog::ContentCatalog()
+{
+
+}
+
+ContentCatalog::ContentCatalog( const gem::ContentStoreItemList& items, const std::vector<EItemState>& states )
+{
+    m_items.reserve( items.size() );
+    m_sizes.reserve( items.size() );
+    m_idToIndex.reserve( items.size() );
+
+    for ( const auto& item : items )
+    {
+        size_t index = m_items.size();
+
+        m_items.push_back( item );
+        m_sizes.push_back( item.getTotalSize() );
+        m_idToIndex[item.getId()] = index;
+
+        for ( const auto& iso : item.getCountryCodes() )
+        {
+            int isoCode = IsoToInt( iso );
+            if ( isoCode != INVALID_ISO_CODE )
+                m_isoToIndexes[isoCode].push_back( index );
+        }
+
+        EItemState state = index < states.size() ? states[index] : EItemState::Other;
+        m_states.push_back( state );
+
+        Group& group = GetGroup( state );
+        group.items.insert( group.items.end(), index );
+        group.totalSize += m_sizes[index];
+    }
+}
+
+size_t ContentCatalog::GetItemCount() const
+{
+    return m_items.size();
+}
+
+const gem::ContentStoreItem& ContentCatalog::GetItem( size_t index ) const
+{
+    return m_items[index];
+}
+
+EItemState ContentCatalog::GetItemState( size_t index ) const
+{
+    return m_states[index];
+}
+
+bool ContentCatalog::SetItemState( size_t index, EItemState state )
+{
+    EItemState oldState = m_states[index];
+    if ( oldState == state )
+        return false;
+
+    Group& oldGroup = GetGroup( oldState );
+    oldGroup.items.erase( index );
+    oldGroup.totalSize -= m_sizes[index];
+
+    Group& newGroup = GetGroup( state );
+    newGroup.items.insert( index );
+    newGroup.totalSize += m_sizes[index];
+
+    m_states[index] = state;
+
+    return true;
+}
+
+size_t ContentCatalog::FindItem( gem::LargeInteger id ) const
+{
+    auto it = m_idToIndex.find( id );
+
+    return it == m_idToIndex.end() ? size_t( -1 ) : it->second;
+}
+
+const std::vector<size_t>& ContentCatalog::GetItemsByIso( const gem::String& iso ) const
+{
+    static const std::vector<size_t> NO_ITEMS;
+
+    auto it = m_isoToIndexes.find( IsoToInt( iso ) );
+
+    return it == m_isoToIndexes.end() ? NO_ITEMS : it->second;
+}
+
+const std::set<size_t>& ContentCatalog::GetItemsByState( EItemState state ) const
+{
+    return GetGroup( state ).items;
+}
+
+gem::LargeInteger ContentCatalog::GetTotalSize( EItemState state ) const
+{
+    return GetGroup( state ).totalSize;
+}
+
+int ContentCatalog::IsoToInt( const gem::String& iso )
+{
+    if ( iso.size() != 3 )
+        return INVALID_ISO_CODE;
+
+    int isoCode = 0;
+
+    for ( int index = 0; index < 3; index++ )
+    {
+        // printable ASCII, so that each character fits its byte
+        if ( iso[index] <= ' ' || iso[index] > '~' )
+            return INVALID_ISO_CODE;
+
+        isoCode |= int( iso[index] ) << ( 8 * index );
+    }
+
+    return isoCode;
+}
+
+ContentCatalog::Group& ContentCatalog::GetGroup( EItemState state )
+{
+    size_t slot = size_t( state );
+
+    return m_groups[slot < m_groups.size() ? slot : size_t( EItemState::Other )];
+}
+
+const ContentCatalog::Group& ContentCatalog::GetGroup( EItemState state ) const
+{
+    size_t slot = size_t( state );
+
+    return m_groups[slot < m_groups.size() ? slot : size_t( EItemState::Other )];
+}
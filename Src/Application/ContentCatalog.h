@@ -0,0 +1,75 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include "API/GEM_ApiLists.h"
+#include "API/GEM_ContentStoreItem.h"
+
+#include <set>
+#include <array>
+#include <vector>
+#include <unordered_map>
+
+enum class EItemState;
+
+// ContentCatalog::IsoToInt of a code which is not 3 ASCII characters
+const int INVALID_ISO_CODE = 0;
+
+// Index of a content store list: items by id / country, items grouped by state
+// (kept in list order) and the total size of each group. State changes are
+// applied incrementally, moving only the changed item between groups.
+class ContentCatalog
+{
+public:
+    ContentCatalog();
+    ContentCatalog( const gem::ContentStoreItemList& items, const std::vector<EItemState>& states );
+
+    size_t GetItemCount() const;
+    const gem::ContentStoreItem& GetItem( size_t index ) const;
+    EItemState GetItemState( size_t index ) const;
+
+    // returns true if the state changed
+    bool SetItemState( size_t index, EItemState state );
+
+    // indexes in the list, -1 if not found
+    size_t FindItem( gem::LargeInteger id ) const;
+
+    const std::vector<size_t>& GetItemsByIso( const gem::String& iso ) const;
+    const std::set<size_t>& GetItemsByState( EItemState state ) const;
+
+    gem::LargeInteger GetTotalSize( EItemState state ) const;
+
+    // the 3 letters code packed in an int, INVALID_ISO_CODE for a short or invalid code
+    static int IsoToInt( const gem::String& iso );
+
+private:
+    struct Group
+    {
+        Group()
+            : totalSize( 0 )
+        {}
+
+        std::set<size_t> items;
+        gem::LargeInteger totalSize;
+    };
+
+    Group& GetGroup( EItemState state );
+    const Group& GetGroup( EItemState state ) const;
+
+private:
+    std::vector<gem::ContentStoreItem> m_items;
+    std::vector<EItemState> m_states;
+    std::vector<gem::LargeInteger> m_sizes;
+
+    std::unordered_map<gem::LargeInteger, size_t> m_idToIndex;
+    std::unordered_map<int, std::vector<size_t>> m_isoToIndexes;
+
+    // EItemState values start at 1, slot 0 is unused
+    std::array<Group, 6> m_groups;
+};
@@ -13,12 +13,14 @@
 #include <functional>
 
 using StatusChangedFunc = std::function<void( int )>;
+using ProgressChangedFunc = std::function<void( int )>;
 
 class ContentUpdateListener : public gem::IProgressListener
 {
 public:
-    ContentUpdateListener( StatusChangedFunc func )
+    ContentUpdateListener( StatusChangedFunc func, ProgressChangedFunc progressFunc = nullptr )
         : m_statusChangedFunc( func )
+        , m_progressChangedFunc( progressFunc )
     {
     }
     void notifyStart( bool hasProgress ) override {}
@@ -30,7 +32,15 @@ public:
             m_statusChangedFunc( status );
         }
     }
+    void notifyProgress( int progress ) override
+    {
+        if ( m_progressChangedFunc )
+        {
+            m_progressChangedFunc( progress );
+        }
+    }
 
 private:
     StatusChangedFunc m_statusChangedFunc;
+    ProgressChangedFunc m_progressChangedFunc;
 };
@@ -0,0 +1,193 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "CountryMetadata.h"
+
+#include "ContentCatalog.h"
+
+#include <API/GEM_MapDetails.h>
+
+#include <set>
+#include <algorithm>
+
+// average keys per bucket (more = smaller seeds table, longer seed search)
+const size_t KEYS_PER_BUCKET = 2;
+
+// a bucket seed is searched up to this value (never reached for a few hundred keys)
+const uint32_t MAX_SEED = 1 << 20;
+
+CountryMetadata::CountryMetadata()
+{
+
+}
+
+size_t CountryMetadata::GetCount() const
+{
+    Build();
+
+    return m_countries.size();
+}
+
+const CountryInfo& CountryMetadata::GetCountry( size_t index ) const
+{
+    Build();
+
+    return m_countries[index];
+}
+
+const CountryInfo* CountryMetadata::Find( const gem::String& iso ) const
+{
+    Build();
+
+    int isoCode = ContentCatalog::IsoToInt( iso );
+
+    if ( m_countries.empty() || isoCode == INVALID_ISO_CODE )
+        return nullptr;
+
+    // any code hashes to some slot, the stored code tells a miss
+    const CountryInfo& country = m_countries[GetSlot( isoCode )];
+
+    return country.isoCode == isoCode ? &country : nullptr;
+}
+
+gem::Image CountryMetadata::GetFlagImage( const gem::String& iso ) const
+{
+    const CountryInfo* country = Find( iso );
+
+    return country ? gem::Image( country->flagImageUid ) : gem::Image();
+}
+
+std::map<int, unsigned int> CountryMetadata::GetFlagImageUids() const
+{
+    Build();
+
+    std::map<int, unsigned int> flagImageUids;
+
+    for ( const auto& country : m_countries )
+        flagImageUids[country.isoCode] = country.flagImageUid;
+
+    return flagImageUids;
+}
+
+void CountryMetadata::Build() const
+{
+    std::call_once( m_buildFlag, [this]()
+    {
+        std::vector<CountryInfo> countries;
+        std::set<int> isoCodes;
+
+        auto collectCountries = [&]( const gem::String& name, const gem::Image& icon, const gem::String& iso )
+        {
+            int isoCode = ContentCatalog::IsoToInt( iso );
+
+            if ( isoCode != INVALID_ISO_CODE && isoCodes.insert( isoCode ).second )
+            {
+                CountryInfo country;
+                country.iso = iso;
+                country.name = name;
+                country.isoCode = isoCode;
+                country.flagImageUid = icon.getUid();
+
+                countries.push_back( country );
+            }
+
+            return true;
+        };
+
+        gem::MapDetails().iterateCountries( collectCountries );
+
+        if ( countries.empty() )
+            return;
+
+        const size_t slotCount = countries.size();
+        const size_t bucketCount = ( slotCount + KEYS_PER_BUCKET - 1 ) / KEYS_PER_BUCKET;
+
+        std::vector<std::vector<size_t>> buckets( bucketCount );
+        for ( size_t index = 0; index < countries.size(); index++ )
+            buckets[Hash( countries[index].isoCode, 0 ) % bucketCount].push_back( index );
+
+        // the largest buckets are placed first, while most slots are free
+        std::vector<size_t> bucketOrder( bucketCount );
+        for ( size_t bucket = 0; bucket < bucketCount; bucket++ )
+            bucketOrder[bucket] = bucket;
+
+        std::stable_sort( bucketOrder.begin(), bucketOrder.end(), [&]( size_t a, size_t b ) { return buckets[a].size() > buckets[b].size(); } );
+
+        std::vector<bool> usedSlots( slotCount, false );
+        std::vector<size_t> countrySlots( countries.size() );
+
+        m_seeds.assign( bucketCount, 0 );
+
+        for ( auto bucket : bucketOrder )
+        {
+            const auto& keys = buckets[bucket];
+            if ( keys.empty() )
+                break;
+
+            std::vector<size_t> slots;
+
+            for ( uint32_t seed = 1; seed < MAX_SEED; seed++ )
+            {
+                slots.clear();
+
+                for ( auto index : keys )
+                {
+                    size_t slot = Hash( countries[index].isoCode, seed ) % slotCount;
+
+                    if ( usedSlots[slot] || std::find( slots.begin(), slots.end(), slot ) != slots.end() )
+                        break;
+
+                    slots.push_back( slot );
+                }
+
+                if ( slots.size() == keys.size() )
+                {
+                    m_seeds[bucket] = seed;
+                    break;
+                }
+            }
+
+            // not expected, the table stays empty (every lookup misses) rather than wrong
+            if ( slots.size() != keys.size() )
+            {
+                m_seeds.clear();
+                return;
+            }
+
+            for ( size_t key = 0; key < keys.size(); key++ )
+            {
+                usedSlots[slots[key]] = true;
+                countrySlots[keys[key]] = slots[key];
+            }
+        }
+
+        m_countries.resize( slotCount );
+        for ( size_t index = 0; index < countries.size(); index++ )
+            m_countries[countrySlots[index]] = countries[index];
+    } );
+}
+
+size_t CountryMetadata::GetSlot( int isoCode ) const
+{
+    uint32_t seed = m_seeds[Hash( isoCode, 0 ) % m_seeds.size()];
+
+    return Hash( isoCode, seed ) % m_countries.size();
+}
+
+uint32_t CountryMetadata::Hash( int isoCode, uint32_t seed )
+{
+    // murmur3 finalizer
+    uint32_t h = uint32_t( isoCode ) ^ ( seed * 0x9E3779B9u );
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+
+    return h;
+}
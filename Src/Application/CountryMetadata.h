@@ -0,0 +1,64 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include <API/GEM_Images.h>
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+struct CountryInfo
+{
+    CountryInfo()
+        : isoCode( 0 )
+        , flagImageUid( 0 )
+    {}
+
+    gem::String iso;
+    gem::String name;
+    int isoCode;                // ContentCatalog::IsoToInt
+    unsigned int flagImageUid;
+};
+
+// The SDK countries (iso, name, flag), read once on first use and shared by the repositories.
+// Stored in a flat array indexed by a minimal perfect hash of the 3 letters code (hash and
+// displace: one seed per bucket), so a lookup is two hashes and one compare.
+class CountryMetadata
+{
+public:
+    CountryMetadata();
+
+    size_t GetCount() const;
+    const CountryInfo& GetCountry( size_t index ) const;
+
+    // nullptr if the iso code is unknown
+    const CountryInfo* Find( const gem::String& iso ) const;
+
+    // gem::Image() if the iso code is unknown
+    gem::Image GetFlagImage( const gem::String& iso ) const;
+
+    // ( iso code, flag image uid ), sorted by iso code
+    std::map<int, unsigned int> GetFlagImageUids() const;
+
+private:
+    void Build() const;
+    size_t GetSlot( int isoCode ) const;
+
+    static uint32_t Hash( int isoCode, uint32_t seed );
+
+private:
+    mutable std::once_flag m_buildFlag;
+
+    mutable std::vector<CountryInfo> m_countries;   // by slot
+    mutable std::vector<uint32_t> m_seeds;          // by bucket
+};
+using CountryMetadataPtr = std::shared_ptr<CountryMetadata>;
@@ -0,0 +1,306 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "DiskTextureCache.h"
+
+#include <Windows.h>
+
+#include <cstring>
+#include <algorithm>
+
+// 'GTXC'
+const uint32_t PACK_MAGIC = 0x43585447;
+
+// bump when the layout below, the stored pixels or the keys hashes change
+const uint32_t PACK_VERSION = 3;
+
+// the pack starts over once it would grow past this size
+const uint64_t MAX_PACK_SIZE = 128ull * 1024 * 1024;
+
+// entries & pixels are 8 bytes aligned in the pack
+const uint64_t PACK_ALIGNMENT = 8;
+
+struct PackHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t dataVersion;   // of the maps & styles the textures were rendered from
+};
+
+struct PackEntry
+{
+    uint32_t imageUid;
+    int32_t width;
+    int32_t height;
+    uint32_t pixelFlags;
+    uint64_t settingsHash;
+    uint64_t dataSize;
+};
+
+static uint64_t AlignPackOffset( uint64_t offset )
+{
+    return ( offset + PACK_ALIGNMENT - 1 ) & ~( PACK_ALIGNMENT - 1 );
+}
+
+DiskTextureCache::DiskTextureCache()
+    : m_file( INVALID_HANDLE_VALUE )
+    , m_mapping( nullptr )
+    , m_view( nullptr )
+    , m_mappedSize( 0 )
+    , m_fileSize( 0 )
+    , m_dataVersion( 0 )
+{
+
+}
+
+DiskTextureCache::~DiskTextureCache()
+{
+    Close();
+}
+
+bool DiskTextureCache::Open( const std::string& filePath, uint64_t dataVersion )
+{
+    Close();
+
+    m_dataVersion = dataVersion;
+
+    m_file = CreateFileA( filePath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if ( m_file == INVALID_HANDLE_VALUE )
+        return false;
+
+    LARGE_INTEGER size;
+    if ( !GetFileSizeEx( m_file, &size ) )
+    {
+        Close();
+        return false;
+    }
+
+    m_fileSize = (uint64_t)size.QuadPart;
+
+    if ( !ReadIndex() && !Reset() )
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void DiskTextureCache::Close()
+{
+    Unmap();
+
+    if ( m_file != INVALID_HANDLE_VALUE )
+        CloseHandle( m_file );
+
+    m_file = INVALID_HANDLE_VALUE;
+    m_fileSize = 0;
+
+    m_entries.clear();
+}
+
+bool DiskTextureCache::IsOpen() const
+{
+    return m_file != INVALID_HANDLE_VALUE;
+}
+
+const void* DiskTextureCache::Find( const DiskTextureKey& key, size_t dataSize )
+{
+    auto it = m_entries.find( key );
+    if ( it == m_entries.end() || it->second.size != dataSize )
+        return nullptr;
+
+    // appended after the file was mapped
+    if ( it->second.offset + it->second.size > m_mappedSize && !Map() )
+        return nullptr;
+
+    return m_view + it->second.offset;
+}
+
+bool DiskTextureCache::Contains( const DiskTextureKey& key, size_t dataSize ) const
+{
+    auto it = m_entries.find( key );
+
+    return it != m_entries.end() && it->second.size == dataSize;
+}
+
+void DiskTextureCache::Store( const DiskTextureKey& key, const void* data, size_t dataSize )
+{
+    if ( !IsOpen() || m_entries.find( key ) != m_entries.end() )
+        return;
+
+    uint64_t entryOffset = AlignPackOffset( m_fileSize );
+    uint64_t dataOffset = AlignPackOffset( entryOffset + sizeof( PackEntry ) );
+
+    if ( dataOffset + dataSize > MAX_PACK_SIZE )
+    {
+        if ( sizeof( PackHeader ) + sizeof( PackEntry ) + dataSize + 2 * PACK_ALIGNMENT > MAX_PACK_SIZE )
+            return;
+
+        Invalidate( m_dataVersion );
+
+        entryOffset = AlignPackOffset( m_fileSize );
+        dataOffset = AlignPackOffset( entryOffset + sizeof( PackEntry ) );
+    }
+
+    PackEntry entry;
+    memset( &entry, 0, sizeof( entry ) );
+    entry.imageUid = key.key.imageUid;
+    entry.width = key.key.width;
+    entry.height = key.key.height;
+    entry.pixelFlags = key.pixelFlags;
+    entry.settingsHash = key.key.settingsHash;
+    entry.dataSize = dataSize;
+
+    // the mapped view is not affected, the file only grows
+    LARGE_INTEGER position;
+    position.QuadPart = (LONGLONG)entryOffset;
+
+    const char padding[PACK_ALIGNMENT] = {};
+    DWORD written = 0;
+
+    bool bWritten = SetFilePointerEx( m_file, position, nullptr, FILE_BEGIN )
+        && WriteFile( m_file, &entry, sizeof( entry ), &written, nullptr )
+        && WriteFile( m_file, padding, DWORD( dataOffset - entryOffset - sizeof( entry ) ), &written, nullptr )
+        && WriteFile( m_file, data, DWORD( dataSize ), &written, nullptr ) && written == dataSize;
+
+    if ( !bWritten )
+    {
+        // the partial entry is dropped when the index is read
+        return;
+    }
+
+    m_fileSize = dataOffset + dataSize;
+
+    Entry& indexEntry = m_entries[key];
+    indexEntry.offset = dataOffset;
+    indexEntry.size = dataSize;
+}
+
+void DiskTextureCache::Invalidate( uint64_t dataVersion )
+{
+    m_dataVersion = dataVersion;
+
+    if ( IsOpen() && !Reset() )
+        Close();
+}
+
+size_t DiskTextureCache::GetEntryCount() const
+{
+    return m_entries.size();
+}
+
+bool DiskTextureCache::Map()
+{
+    Unmap();
+
+    if ( m_fileSize == 0 )
+        return false;
+
+    m_mapping = CreateFileMappingA( m_file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    if ( !m_mapping )
+        return false;
+
+    m_view = (const unsigned char*)MapViewOfFile( m_mapping, FILE_MAP_READ, 0, 0, 0 );
+    if ( !m_view )
+    {
+        Unmap();
+        return false;
+    }
+
+    m_mappedSize = m_fileSize;
+
+    return true;
+}
+
+void DiskTextureCache::Unmap()
+{
+    if ( m_view )
+        UnmapViewOfFile( m_view );
+
+    if ( m_mapping )
+        CloseHandle( m_mapping );
+
+    m_view = nullptr;
+    m_mapping = nullptr;
+    m_mappedSize = 0;
+}
+
+bool DiskTextureCache::ReadIndex()
+{
+    m_entries.clear();
+
+    if ( m_fileSize < sizeof( PackHeader ) || !Map() )
+        return false;
+
+    const PackHeader* header = (const PackHeader*)m_view;
+    if ( header->magic != PACK_MAGIC || header->version != PACK_VERSION || header->dataVersion != m_dataVersion )
+        return false;
+
+    uint64_t offset = AlignPackOffset( sizeof( PackHeader ) );
+
+    while ( offset + sizeof( PackEntry ) <= m_mappedSize )
+    {
+        const PackEntry* entry = (const PackEntry*)( m_view + offset );
+        uint64_t dataOffset = AlignPackOffset( offset + sizeof( PackEntry ) );
+
+        // entry written partially (e.g. the app was killed meanwhile) or corrupt; checked
+        // without overflowing on a huge size
+        if ( dataOffset > m_mappedSize || entry->dataSize > m_mappedSize - dataOffset )
+            break;
+
+        Entry& indexEntry = m_entries[DiskTextureKey( TextureKey( entry->imageUid, entry->width, entry->height, entry->settingsHash ), entry->pixelFlags )];
+        indexEntry.offset = dataOffset;
+        indexEntry.size = entry->dataSize;
+
+        offset = AlignPackOffset( dataOffset + entry->dataSize );
+    }
+
+    // new entries are appended after the last valid one, a partial tail is cut off
+    m_fileSize = (std::min)( offset, m_mappedSize );
+
+    if ( m_fileSize < m_mappedSize )
+    {
+        Unmap();
+
+        LARGE_INTEGER position;
+        position.QuadPart = (LONGLONG)m_fileSize;
+
+        if ( !SetFilePointerEx( m_file, position, nullptr, FILE_BEGIN ) || !SetEndOfFile( m_file ) )
+            return false;
+    }
+
+    return true;
+}
+
+bool DiskTextureCache::Reset()
+{
+    Unmap();
+    m_entries.clear();
+
+    PackHeader header;
+    memset( &header, 0, sizeof( header ) );
+    header.magic = PACK_MAGIC;
+    header.version = PACK_VERSION;
+    header.dataVersion = m_dataVersion;
+
+    LARGE_INTEGER position;
+    position.QuadPart = 0;
+
+    DWORD written = 0;
+
+    if ( !SetFilePointerEx( m_file, position, nullptr, FILE_BEGIN ) || !SetEndOfFile( m_file ) )
+        return false;
+
+    if ( !WriteFile( m_file, &header, sizeof( header ), &written, nullptr ) || written != sizeof( header ) )
+        return false;
+
+    m_fileSize = sizeof( header );
+
+    return true;
+}
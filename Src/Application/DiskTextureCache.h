@@ -0,0 +1,87 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include "TextureCache.h"
+
+#include <map>
+#include <string>
+#include <cstdint>
+
+struct DiskTextureKey
+{
+    DiskTextureKey( const TextureKey& key = TextureKey(), uint32_t pixelFlags = 0 )
+        : key( key )
+        , pixelFlags( pixelFlags )
+    {}
+
+    bool operator<( const DiskTextureKey& other ) const
+    {
+        return std::tie( key, pixelFlags ) < std::tie( other.key, other.pixelFlags );
+    }
+
+    TextureKey key;
+    uint32_t pixelFlags; // texture format & premultiplied alpha, the stored pixels are converted
+};
+
+// Rendered bitmaps persisted across launches, in a single pack file which is memory mapped,
+// so that a hit is uploaded straight from the mapping instead of being rasterized again.
+// New entries are appended to the file. Render thread only.
+class DiskTextureCache
+{
+public:
+    DiskTextureCache();
+    ~DiskTextureCache();
+
+    // creates the pack if missing, written by another version of the cache or rendered from
+    // another version of the data (dataVersion, e.g. the maps version)
+    bool Open( const std::string& filePath, uint64_t dataVersion );
+    void Close();
+
+    bool IsOpen() const;
+
+    // valid until the next Find / Store / Invalidate / Close call (an entry appended since the file
+    // was mapped remaps it), so the data has to be used right away; nullptr on miss
+    const void* Find( const DiskTextureKey& key, size_t dataSize );
+
+    // a hit without touching the mapping
+    bool Contains( const DiskTextureKey& key, size_t dataSize ) const;
+
+    void Store( const DiskTextureKey& key, const void* data, size_t dataSize );
+
+    // drops every entry (e.g. content update applied); the new pack is tagged with dataVersion
+    void Invalidate( uint64_t dataVersion );
+
+    size_t GetEntryCount() const;
+
+private:
+    bool Map();
+    void Unmap();
+
+    bool ReadIndex();
+    bool Reset();
+
+private:
+    struct Entry
+    {
+        uint64_t offset;    // of the pixels, in the pack
+        uint64_t size;
+    };
+
+    std::map<DiskTextureKey, Entry> m_entries;
+
+    void* m_file;
+    void* m_mapping;
+    const unsigned char* m_view;
+
+    uint64_t m_mappedSize;
+    uint64_t m_fileSize;
+
+    uint64_t m_dataVersion;
+};
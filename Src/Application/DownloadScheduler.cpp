@@ -0,0 +1,618 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "DownloadScheduler.h"
+
+#include <API/GEM_ContentStore.h>
+#include <API/GEM_Error.h>
+
+#include <tuple>
+#include <algorithm>
+
+// downloads running at once (the rest are queued)
+const size_t DEFAULT_MAX_PARALLEL_DOWNLOADS = 3;
+
+// the download rate is measured over windows of this length
+const std::chrono::milliseconds RATE_WINDOW( 500 );
+
+// a slot is given back once the rate goes below this fraction of the cap
+const double RATE_CAP_LOW_WATERMARK = 0.8;
+
+using DownloadListenerFunc = std::function<void( int )>;
+
+// forwards the completion & progress of a download
+class DownloadListener : public gem::IProgressListener
+{
+public:
+    DownloadListener( DownloadListenerFunc completeFunc, DownloadListenerFunc progressFunc )
+        : m_completeFunc( completeFunc )
+        , m_progressFunc( progressFunc )
+    {
+    }
+
+private:
+    void notifyStart( bool hasProgress ) override {}
+    void notifyComplete( int reason, gem::String ) override
+    {
+        m_completeFunc( reason );
+    }
+    void notifyProgress( int progress ) override
+    {
+        m_progressFunc( progress );
+    }
+
+private:
+    DownloadListenerFunc m_completeFunc;
+    DownloadListenerFunc m_progressFunc;
+};
+
+//
+// ContentStoreDownloadBackend
+//
+
+int ContentStoreDownloadBackend::StartDownload( gem::LargeInteger itemId, gem::ContentStoreItem& item, gem::StrongPointer<gem::IProgressListener> listener )
+{
+    return item.asyncDownload( listener );
+}
+
+void ContentStoreDownloadBackend::PauseDownload( gem::LargeInteger itemId, gem::ContentStoreItem& item )
+{
+    item.pauseDownload();
+}
+
+void ContentStoreDownloadBackend::CancelDownload( gem::LargeInteger itemId, gem::StrongPointer<gem::IProgressListener> listener )
+{
+    gem::ContentStore().cancel( listener );
+}
+
+gem::LargeInteger ContentStoreDownloadBackend::GetDownloadedBytes( gem::LargeInteger itemId, const gem::ContentStoreItem& item ) const
+{
+    return item.getTotalSize() * item.getDownloadProgress() / 100;
+}
+
+//
+// DownloadScheduler
+//
+
+DownloadScheduler::DownloadScheduler( std::unique_ptr<IDownloadBackend> backend /* = std::make_unique<ContentStoreDownloadBackend>() */ )
+    : m_backend( std::move( backend ) )
+    , m_maxParallelDownloads( DEFAULT_MAX_PARALLEL_DOWNLOADS )
+    , m_allowedSlots( DEFAULT_MAX_PARALLEL_DOWNLOADS )
+    , m_maxBytesPerSecond( 0 )
+    , m_bytesPerSecond( 0 )
+    , m_rateTime( std::chrono::steady_clock::now() )
+    , m_bThrottled( false )
+    , m_bQueuePaused( false )
+    , m_startCount( 0 )
+    , m_bAlive( std::make_shared<bool>( true ) )
+{
+
+}
+
+DownloadScheduler::~DownloadScheduler()
+{
+    CancelAll();
+
+    // late notifications are ignored
+    m_bAlive.reset();
+}
+
+EEnqueueResult DownloadScheduler::Enqueue( const gem::ContentStoreItem& item, EDownloadPriority priority, DownloadCompleteFunc completeFunc /* = nullptr */ )
+{
+    return Enqueue( item.getId(), item, priority, completeFunc );
+}
+
+EEnqueueResult DownloadScheduler::Enqueue( gem::LargeInteger itemId, const gem::ContentStoreItem& item, EDownloadPriority priority, DownloadCompleteFunc completeFunc /* = nullptr */ )
+{
+    // of the start made by this call, 0 if the download stays queued
+    size_t startId = 0;
+
+    {
+        std::lock_guard<std::recursive_mutex> guard( m_sync );
+
+        auto activeIt = m_active.find( itemId );
+        if ( activeIt != m_active.end() )
+        {
+            activeIt->second.priority = std::min( activeIt->second.priority, priority );
+            if ( completeFunc )
+                activeIt->second.completeFunc = completeFunc;
+
+            return EEnqueueResult::Started;
+        }
+
+        Download download;
+
+        if ( RemoveQueued( itemId, &download ) )
+        {
+            download.priority = std::min( download.priority, priority );
+            if ( completeFunc )
+                download.completeFunc = completeFunc;
+        }
+        else
+        {
+            download.itemId = itemId;
+            download.item = item;
+            download.priority = priority;
+            download.completeFunc = completeFunc;
+        }
+
+        m_queue[download.priority].push_back( download );
+
+        StartQueued();
+
+        activeIt = m_active.find( itemId );
+        if ( activeIt != m_active.end() )
+            startId = activeIt->second.startId;
+    }
+
+    RunBackendCalls();
+
+    if ( startId == 0 )
+        return EEnqueueResult::Queued;
+
+    std::lock_guard<std::recursive_mutex> guard( m_sync );
+
+    return m_failedStartIds.erase( startId ) ? EEnqueueResult::Refused : EEnqueueResult::Started;
+}
+
+void DownloadScheduler::Pause( gem::LargeInteger itemId )
+{
+    {
+        std::lock_guard<std::recursive_mutex> guard( m_sync );
+
+        if ( RemoveQueued( itemId ) )
+            return;
+
+        auto it = m_active.find( itemId );
+        if ( it == m_active.end() )
+            return;
+
+        // the listener of the paused download is ignored from now on
+        StopDownload( it->second, false );
+        m_active.erase( it );
+
+        StartQueued();
+    }
+
+    RunBackendCalls();
+}
+
+bool DownloadScheduler::IsScheduled( gem::LargeInteger itemId ) const
+{
+    std::lock_guard<std::recursive_mutex> guard( m_sync );
+
+    if ( m_active.find( itemId ) != m_active.end() )
+        return true;
+
+    for ( const auto& it : m_queue )
+        for ( const auto& download : it.second )
+            if ( download.itemId == itemId )
+                return true;
+
+    return false;
+}
+
+void DownloadScheduler::SetMaxParallelDownloads( size_t maxParallelDownloads )
+{
+    {
+        std::lock_guard<std::recursive_mutex> guard( m_sync );
+
+        m_maxParallelDownloads = std::max<size_t>( 1, maxParallelDownloads );
+        m_allowedSlots = std::min( m_allowedSlots, m_maxParallelDownloads );
+
+        if ( m_maxBytesPerSecond <= 0 )
+            m_allowedSlots = m_maxParallelDownloads;
+
+        StartQueued();
+    }
+
+    RunBackendCalls();
+}
+
+void DownloadScheduler::SetMaxBytesPerSecond( double maxBytesPerSecond )
+{
+    {
+        std::lock_guard<std::recursive_mutex> guard( m_sync );
+
+        m_maxBytesPerSecond = maxBytesPerSecond;
+
+        if ( m_maxBytesPerSecond <= 0 )
+        {
+            m_allowedSlots = m_maxParallelDownloads;
+            m_bThrottled = false;
+
+            StartQueued();
+        }
+    }
+
+    RunBackendCalls();
+}
+
+void DownloadScheduler::PauseQueue()
+{
+    {
+        std::lock_guard<std::recursive_mutex> guard( m_sync );
+
+        m_bQueuePaused = true;
+
+        while ( !m_active.empty() )
+            Requeue( m_active.begin()->first );
+    }
+
+    RunBackendCalls();
+}
+
+void DownloadScheduler::ResumeQueue()
+{
+    {
+        std::lock_guard<std::recursive_mutex> guard( m_sync );
+
+        m_bQueuePaused = false;
+
+        StartQueued();
+    }
+
+    RunBackendCalls();
+}
+
+bool DownloadScheduler::IsQueuePaused() const
+{
+    std::lock_guard<std::recursive_mutex> guard( m_sync );
+
+    return m_bQueuePaused;
+}
+
+void DownloadScheduler::CancelAll()
+{
+    {
+        std::lock_guard<std::recursive_mutex> guard( m_sync );
+
+        // a cancel may notify the completion right away, ignored as the download is no longer active
+        for ( const auto& it : m_active )
+            StopDownload( it.second, true );
+
+        m_active.clear();
+        m_queue.clear();
+    }
+
+    RunBackendCalls();
+}
+
+DownloadSchedulerStats DownloadScheduler::GetStats() const
+{
+    std::lock_guard<std::recursive_mutex> guard( m_sync );
+
+    DownloadSchedulerStats stats;
+
+    for ( const auto& it : m_queue )
+        stats.queued += it.second.size();
+
+    stats.active = m_active.size();
+    stats.allowedSlots = m_allowedSlots;
+    stats.bytesPerSecond = m_bytesPerSecond;
+    stats.bThrottled = m_bThrottled;
+
+    return stats;
+}
+
+void DownloadScheduler::SetProgressFunc( DownloadProgressFunc progressFunc )
+{
+    std::lock_guard<std::recursive_mutex> guard( m_sync );
+
+    m_progressFunc = progressFunc;
+}
+
+void DownloadScheduler::Tick()
+{
+    Tick( std::chrono::steady_clock::now() );
+}
+
+void DownloadScheduler::Tick( std::chrono::steady_clock::time_point now )
+{
+    std::vector<std::function<void()>> failedDownloads;
+
+    {
+        std::lock_guard<std::recursive_mutex> guard( m_sync );
+
+        // the duty cycle pause is over, the rate is measured from the resume
+        if ( m_bThrottled && now >= m_throttledUntil )
+        {
+            m_bThrottled = false;
+            m_rateTime = now;
+        }
+
+        UpdateRate( now );
+
+        StartQueued();
+
+        failedDownloads.swap( m_failedDownloads );
+        m_failedStartIds.clear();
+    }
+
+    RunBackendCalls();
+
+    // outside the lock, like the SDK notifications
+    for ( auto& notify : failedDownloads )
+        notify();
+}
+
+void DownloadScheduler::OnDownloadComplete( gem::LargeInteger itemId, size_t startId, int reason )
+{
+    DownloadCompleteFunc completeFunc;
+
+    {
+        std::lock_guard<std::recursive_mutex> guard( m_sync );
+
+        // a paused / requeued download (its listener was replaced)
+        auto it = m_active.find( itemId );
+        if ( it == m_active.end() || it->second.startId != startId )
+            return;
+
+        // a failure notified from within the start
+        if ( !it->second.bStarted && reason != gem::KNoError )
+            m_failedStartIds.insert( startId );
+
+        completeFunc = it->second.completeFunc;
+        m_active.erase( it );
+
+        // the freed slot is filled on the next Tick, not from the notification
+    }
+
+    if ( completeFunc )
+        completeFunc( itemId, reason );
+}
+
+void DownloadScheduler::OnDownloadProgress( gem::LargeInteger itemId, size_t startId, int progress )
+{
+    DownloadProgressFunc progressFunc;
+
+    {
+        std::lock_guard<std::recursive_mutex> guard( m_sync );
+
+        auto it = m_active.find( itemId );
+        if ( it == m_active.end() || it->second.startId != startId )
+            return;
+
+        progressFunc = m_progressFunc;
+    }
+
+    if ( progressFunc )
+        progressFunc( itemId, progress );
+}
+
+void DownloadScheduler::RunBackendCalls()
+{
+    // a call may queue more (a download stopped before it was started)
+    for ( ;; )
+    {
+        std::vector<std::function<void()>> backendCalls;
+
+        {
+            std::lock_guard<std::recursive_mutex> guard( m_sync );
+
+            backendCalls.swap( m_backendCalls );
+        }
+
+        if ( backendCalls.empty() )
+            break;
+
+        for ( auto& call : backendCalls )
+            call();
+    }
+}
+
+void DownloadScheduler::OnStarted( const Download& download, int error )
+{
+    std::lock_guard<std::recursive_mutex> guard( m_sync );
+
+    auto it = m_active.find( download.itemId );
+    if ( it != m_active.end() && it->second.startId == download.startId )
+    {
+        if ( error == gem::KNoError )
+        {
+            it->second.bStarted = true;
+        }
+        else
+        {
+            if ( it->second.completeFunc )
+                m_failedDownloads.push_back( std::bind( it->second.completeFunc, download.itemId, error ) );
+
+            m_failedStartIds.insert( download.startId );
+
+            m_active.erase( it );
+        }
+
+        return;
+    }
+
+    // paused, requeued or canceled before the start was made (e.g. from another thread)
+    auto stoppedIt = m_stoppedBeforeStart.find( download.startId );
+    if ( stoppedIt == m_stoppedBeforeStart.end() )
+        return;
+
+    bool bCancel = stoppedIt->second;
+    m_stoppedBeforeStart.erase( stoppedIt );
+
+    // not if it was started again meanwhile, the newer start is kept
+    if ( error != gem::KNoError || it != m_active.end() )
+        return;
+
+    Download stopped = download;
+    stopped.bStarted = true;
+
+    StopDownload( stopped, bCancel );
+}
+
+void DownloadScheduler::StopDownload( const Download& download, bool bCancel )
+{
+    if ( !download.bStarted )
+    {
+        // stopped by OnStarted, once the start is made
+        m_stoppedBeforeStart[download.startId] = bCancel;
+        return;
+    }
+
+    gem::LargeInteger itemId = download.itemId;
+    gem::ContentStoreItem item = download.item;
+    auto listener = download.listener;
+
+    if ( bCancel )
+        m_backendCalls.push_back( [this, itemId, listener]() { m_backend->CancelDownload( itemId, listener ); } );
+    else
+        m_backendCalls.push_back( [this, itemId, item]() mutable { m_backend->PauseDownload( itemId, item ); } );
+}
+
+void DownloadScheduler::StartQueued()
+{
+    while ( !m_bQueuePaused && !m_bThrottled && m_active.size() < m_allowedSlots && !m_queue.empty() )
+    {
+        // empty queues are erased, the first one has the highest priority
+        auto queueIt = m_queue.begin();
+
+        Download download = queueIt->second.front();
+        queueIt->second.pop_front();
+
+        if ( queueIt->second.empty() )
+            m_queue.erase( queueIt );
+
+        gem::LargeInteger itemId = download.itemId;
+        size_t startId = ++m_startCount;
+
+        std::weak_ptr<bool> alive = m_bAlive;
+        auto completeFunc = [this, alive, itemId, startId]( int reason )
+        {
+            if ( alive.lock() )
+                OnDownloadComplete( itemId, startId, reason );
+        };
+        auto progressFunc = [this, alive, itemId, startId]( int progress )
+        {
+            if ( alive.lock() )
+                OnDownloadProgress( itemId, startId, progress );
+        };
+
+        download.listener = gem::StrongPointerFactory<DownloadListener>( completeFunc, progressFunc );
+        download.startId = startId;
+        download.bStarted = false;
+        download.downloadedBytes = m_backend->GetDownloadedBytes( itemId, download.item );
+
+        // registered before the start, the completion may be notified from within it
+        m_active[itemId] = download;
+
+        m_backendCalls.push_back( [this, download]() mutable
+        {
+            OnStarted( download, m_backend->StartDownload( download.itemId, download.item, download.listener ) );
+        } );
+    }
+}
+
+void DownloadScheduler::Requeue( gem::LargeInteger itemId )
+{
+    auto it = m_active.find( itemId );
+    if ( it == m_active.end() )
+        return;
+
+    Download download = it->second;
+    m_active.erase( it );
+
+    StopDownload( download, false );
+
+    // resumed before the other downloads of its priority
+    download.listener = gem::StrongPointer<gem::IProgressListener>();
+    m_queue[download.priority].push_front( download );
+}
+
+void DownloadScheduler::UpdateRate( std::chrono::steady_clock::time_point now )
+{
+    // nothing runs during the duty cycle pause
+    if ( m_bThrottled )
+        return;
+
+    auto elapsed = now - m_rateTime;
+
+    if ( elapsed < RATE_WINDOW )
+        return;
+
+    m_rateTime = now;
+
+    gem::LargeInteger bytes = 0;
+
+    for ( auto& it : m_active )
+    {
+        gem::LargeInteger downloadedBytes = m_backend->GetDownloadedBytes( it.first, it.second.item );
+
+        if ( downloadedBytes > it.second.downloadedBytes )
+            bytes += downloadedBytes - it.second.downloadedBytes;
+
+        it.second.downloadedBytes = downloadedBytes;
+    }
+
+    double seconds = std::chrono::duration<double>( elapsed ).count();
+    double bytesPerSecond = bytes / seconds;
+
+    if ( m_maxBytesPerSecond > 0 && bytesPerSecond > m_maxBytesPerSecond && m_active.size() == 1 )
+    {
+        // fewer downloads won't help: paused for as long as it takes the window's average to be the cap
+        double pauseSeconds = seconds * ( bytesPerSecond / m_maxBytesPerSecond - 1 );
+
+        m_bThrottled = true;
+        m_throttledUntil = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( pauseSeconds ) );
+
+        Requeue( m_active.begin()->first );
+
+        bytesPerSecond = m_maxBytesPerSecond;
+    }
+
+    m_bytesPerSecond = ( m_bytesPerSecond + bytesPerSecond ) / 2;
+
+    if ( m_maxBytesPerSecond <= 0 )
+        return;
+
+    // one download less while over the cap, one more once well below it (never less than one)
+    if ( m_bytesPerSecond > m_maxBytesPerSecond && m_allowedSlots > 1 )
+        m_allowedSlots--;
+    else if ( m_bytesPerSecond < m_maxBytesPerSecond * RATE_CAP_LOW_WATERMARK && m_allowedSlots < m_maxParallelDownloads )
+        m_allowedSlots++;
+
+    while ( m_active.size() > m_allowedSlots )
+    {
+        // the lowest priority one, the most recently started of them
+        auto victim = m_active.begin();
+
+        for ( auto it = m_active.begin(); it != m_active.end(); ++it )
+            if ( std::tie( it->second.priority, it->second.startId ) > std::tie( victim->second.priority, victim->second.startId ) )
+                victim = it;
+
+        Requeue( victim->first );
+    }
+}
+
+bool DownloadScheduler::RemoveQueued( gem::LargeInteger itemId, Download* download /* = nullptr */ )
+{
+    for ( auto queueIt = m_queue.begin(); queueIt != m_queue.end(); ++queueIt )
+    {
+        auto& queue = queueIt->second;
+
+        for ( auto it = queue.begin(); it != queue.end(); ++it )
+        {
+            if ( it->itemId != itemId )
+                continue;
+
+            if ( download )
+                *download = *it;
+
+            queue.erase( it );
+
+            if ( queue.empty() )
+                m_queue.erase( queueIt );
+
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,203 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include <API/GEM_ContentStoreItem.h>
+#include <API/GEM_ProgressListener.h>
+
+#include <map>
+#include <set>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <functional>
+
+// higher priority first
+enum class EDownloadPriority
+{
+    UserInitiated,
+    RouteCorridor,
+    BackgroundUpdate
+};
+
+// outcome of DownloadScheduler::Enqueue
+enum class EEnqueueResult
+{
+    Started,    // running (or already running)
+    Queued,     // waiting for a download slot, the rate cap or the queue resume
+    Refused     // the start failed, the error is also notified to the completion func (from Tick)
+};
+
+// ( item id, reason ), called when a started download completes, fails or is canceled
+// (never under the scheduler lock; start failures are reported from Tick)
+using DownloadCompleteFunc = std::function<void( gem::LargeInteger, int )>;
+
+// ( item id, progress % ), called from the SDK notifications for each progress change
+using DownloadProgressFunc = std::function<void( gem::LargeInteger, int )>;
+
+// The content store operations used by the scheduler (a fake store can simulate latency & throughput).
+// The item id is passed apart, the items of a fake store aren't backed by the SDK. Start, pause
+// and cancel are never called under the scheduler lock: the completion may be notified from within.
+class IDownloadBackend
+{
+public:
+    virtual int StartDownload( gem::LargeInteger itemId, gem::ContentStoreItem& item, gem::StrongPointer<gem::IProgressListener> listener ) = 0;
+    virtual void PauseDownload( gem::LargeInteger itemId, gem::ContentStoreItem& item ) = 0;
+    virtual void CancelDownload( gem::LargeInteger itemId, gem::StrongPointer<gem::IProgressListener> listener ) = 0;
+
+    virtual gem::LargeInteger GetDownloadedBytes( gem::LargeInteger itemId, const gem::ContentStoreItem& item ) const = 0;
+
+    virtual ~IDownloadBackend() = default;
+};
+
+// gem::ContentStore downloads
+class ContentStoreDownloadBackend : public IDownloadBackend
+{
+public:
+    int StartDownload( gem::LargeInteger itemId, gem::ContentStoreItem& item, gem::StrongPointer<gem::IProgressListener> listener ) override;
+    void PauseDownload( gem::LargeInteger itemId, gem::ContentStoreItem& item ) override;
+    void CancelDownload( gem::LargeInteger itemId, gem::StrongPointer<gem::IProgressListener> listener ) override;
+
+    gem::LargeInteger GetDownloadedBytes( gem::LargeInteger itemId, const gem::ContentStoreItem& item ) const override;
+};
+
+struct DownloadSchedulerStats
+{
+    DownloadSchedulerStats()
+        : queued( 0 )
+        , active( 0 )
+        , allowedSlots( 0 )
+        , bytesPerSecond( 0 )
+        , bThrottled( false )
+    {}
+
+    size_t queued;
+    size_t active;
+    size_t allowedSlots;        // lowered while over the byte rate cap
+    double bytesPerSecond;      // measured, smoothed
+    bool bThrottled;            // the downloads are paused by the rate cap duty cycle
+};
+
+// Queue of content store downloads: a limited number run in parallel, the rest wait in
+// priority order (FIFO within a priority). A byte rate cap is enforced by lowering the
+// number of running downloads while the measured rate is over it; a single download over
+// the cap is paused and resumed on a duty cycle, so that its average rate is the cap.
+class DownloadScheduler
+{
+public:
+    DownloadScheduler( std::unique_ptr<IDownloadBackend> backend = std::make_unique<ContentStoreDownloadBackend>() );
+    ~DownloadScheduler();
+
+    // an item already queued is moved to the higher of the two priorities
+    EEnqueueResult Enqueue( const gem::ContentStoreItem& item, EDownloadPriority priority, DownloadCompleteFunc completeFunc = nullptr );
+    EEnqueueResult Enqueue( gem::LargeInteger itemId, const gem::ContentStoreItem& item, EDownloadPriority priority, DownloadCompleteFunc completeFunc = nullptr );
+
+    // pauses a running download or removes a queued one
+    void Pause( gem::LargeInteger itemId );
+
+    bool IsScheduled( gem::LargeInteger itemId ) const;
+
+    void SetMaxParallelDownloads( size_t maxParallelDownloads );
+
+    // 0 = no cap
+    void SetMaxBytesPerSecond( double maxBytesPerSecond );
+
+    // the running downloads are paused and queued again
+    void PauseQueue();
+    void ResumeQueue();
+    bool IsQueuePaused() const;
+
+    void CancelAll();
+
+    DownloadSchedulerStats GetStats() const;
+
+    // for all the downloads, set before the first one is enqueued
+    void SetProgressFunc( DownloadProgressFunc progressFunc );
+
+    // measures the rate & starts the queued downloads; called once per frame
+    void Tick();
+    void Tick( std::chrono::steady_clock::time_point now );
+
+private:
+    struct Download
+    {
+        Download()
+            : itemId( 0 )
+            , priority( EDownloadPriority::UserInitiated )
+            , startId( 0 )
+            , downloadedBytes( 0 )
+            , bStarted( false )
+        {}
+
+        gem::LargeInteger itemId;
+        gem::ContentStoreItem item;
+        EDownloadPriority priority;
+        DownloadCompleteFunc completeFunc;
+
+        // running downloads only
+        gem::StrongPointer<gem::IProgressListener> listener;
+        size_t startId;                     // tells the notifications of a restarted download apart
+        gem::LargeInteger downloadedBytes;
+        bool bStarted;                      // the backend start call was made
+    };
+
+    void OnDownloadComplete( gem::LargeInteger itemId, size_t startId, int reason );
+    void OnDownloadProgress( gem::LargeInteger itemId, size_t startId, int progress );
+    void OnStarted( const Download& download, int error );
+
+    // the backend calls queued under the lock; lock not held
+    void RunBackendCalls();
+
+    // lock held
+    void StopDownload( const Download& download, bool bCancel );
+    void StartQueued();
+    void Requeue( gem::LargeInteger itemId );
+    void UpdateRate( std::chrono::steady_clock::time_point now );
+    bool RemoveQueued( gem::LargeInteger itemId, Download* download = nullptr );
+
+private:
+    std::unique_ptr<IDownloadBackend> m_backend;
+
+    std::map<EDownloadPriority, std::deque<Download>> m_queue;
+    std::map<gem::LargeInteger, Download> m_active;
+
+    // start / pause / cancel of the downloads, made once the lock is released
+    std::vector<std::function<void()>> m_backendCalls;
+
+    // start id -> canceled (or paused), for the downloads stopped before their start was made
+    std::map<size_t, bool> m_stoppedBeforeStart;
+
+    size_t m_maxParallelDownloads;
+    size_t m_allowedSlots;
+
+    double m_maxBytesPerSecond;
+    double m_bytesPerSecond;
+    std::chrono::steady_clock::time_point m_rateTime;
+
+    // paused by the rate cap duty cycle until then
+    bool m_bThrottled;
+    std::chrono::steady_clock::time_point m_throttledUntil;
+
+    bool m_bQueuePaused;
+    size_t m_startCount;
+
+    DownloadProgressFunc m_progressFunc;
+
+    // completion of the downloads which failed to start, notified from Tick
+    std::vector<std::function<void()>> m_failedDownloads;
+    // their start ids, checked by Enqueue (cleared by Tick)
+    std::set<size_t> m_failedStartIds;
+
+    // shared with the listeners, which may outlive the scheduler
+    std::shared_ptr<bool> m_bAlive;
+
+    mutable std::recursive_mutex m_sync;
+};
@@ -0,0 +1,162 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "FlagAtlas.h"
+
+#include "BitmapImpl.h"
+
+#include <algorithm>
+#include <cstring>
+
+// max width / height of an atlas page (well below GL_MAX_TEXTURE_SIZE on any target)
+const int ATLAS_PAGE_SIZE = 1024;
+
+// transparent gap between flags, so that linear filtering doesn't bleed neighbours
+const int ATLAS_CELL_PADDING = 1;
+
+FlagAtlas::FlagAtlas()
+    : m_flagWidth( 0 )
+    , m_flagHeight( 0 )
+{
+
+}
+
+bool FlagAtlas::IsBuilt( int flagWidth, int flagHeight ) const
+{
+    return !m_pages.empty() && m_flagWidth == flagWidth && m_flagHeight == flagHeight;
+}
+
+void FlagAtlas::Layout( const std::map<int, unsigned int>& isoToImageUids, int flagWidth, int flagHeight )
+{
+    m_regions.clear();
+    m_pages.clear();
+    m_pageTextures.clear();
+
+    m_flagWidth = flagWidth;
+    m_flagHeight = flagHeight;
+
+    if ( isoToImageUids.empty() || flagWidth <= 0 || flagHeight <= 0 )
+        return;
+
+    const int cellWidth = flagWidth + ATLAS_CELL_PADDING;
+    const int cellHeight = flagHeight + ATLAS_CELL_PADDING;
+
+    const int columns = std::max( 1, ATLAS_PAGE_SIZE / cellWidth );
+    const int rowsPerPage = std::max( 1, ATLAS_PAGE_SIZE / cellHeight );
+    const int cellsPerPage = columns * rowsPerPage;
+
+    // (iso, image uid) in atlas order
+    std::vector<std::pair<int, unsigned int>> flags( isoToImageUids.begin(), isoToImageUids.end() );
+
+    const int flagCount = int( flags.size() );
+
+    for ( int first = 0; first < flagCount; first += cellsPerPage )
+    {
+        // shrink the last page to the rows it actually needs
+        int cells = std::min( flagCount - first, cellsPerPage );
+
+        FlagAtlasPage page;
+        page.width = std::min( cells, columns ) * cellWidth;
+        page.height = ( ( cells + columns - 1 ) / columns ) * cellHeight;
+        page.columns = columns;
+        page.flagWidth = flagWidth;
+        page.flagHeight = flagHeight;
+
+        for ( int cellIndex = 0; cellIndex < cells; cellIndex++ )
+        {
+            int x = ( cellIndex % columns ) * cellWidth;
+            int y = ( cellIndex / columns ) * cellHeight;
+
+            TextureRegion region;
+            region.u0 = float( x ) / page.width;
+            region.v0 = float( y ) / page.height;
+            region.u1 = float( x + flagWidth ) / page.width;
+            region.v1 = float( y + flagHeight ) / page.height;
+
+            m_regions[flags[first + cellIndex].first] = std::make_pair( m_pages.size(), region );
+
+            page.imageUids.push_back( flags[first + cellIndex].second );
+        }
+
+        m_pages.push_back( page );
+    }
+
+    m_pageTextures.assign( m_pages.size(), INVALID_TEXTURE_ID );
+}
+
+void FlagAtlas::Release( ReleaseAtlasPageFunc releaseFunc )
+{
+    for ( auto& textureId : m_pageTextures )
+        releaseFunc( textureId );
+
+    m_pages.clear();
+    m_pageTextures.clear();
+    m_regions.clear();
+
+    m_flagWidth = 0;
+    m_flagHeight = 0;
+}
+
+size_t FlagAtlas::GetPageCount() const
+{
+    return m_pages.size();
+}
+
+const FlagAtlasPage& FlagAtlas::GetPage( size_t page ) const
+{
+    return m_pages[page];
+}
+
+size_t FlagAtlas::GetFlagCount() const
+{
+    return m_regions.size();
+}
+
+void FlagAtlas::SetPageTexture( size_t page, unsigned int textureId )
+{
+    m_pageTextures[page] = textureId;
+}
+
+TextureRegion FlagAtlas::GetRegion( int iso ) const
+{
+    auto it = m_regions.find( iso );
+    if ( it == m_regions.end() )
+        return TextureRegion();
+
+    TextureRegion region = it->second.second;
+    region.textureId = m_pageTextures[it->second.first];
+
+    return region;
+}
+
+void FlagAtlas::RenderPage( const FlagAtlasPage& page, std::vector<unsigned char>& pixels )
+{
+    const int cellWidth = page.flagWidth + ATLAS_CELL_PADDING;
+    const int cellHeight = page.flagHeight + ATLAS_CELL_PADDING;
+
+    pixels.assign( (size_t)page.width * (size_t)page.height * 4, 0 );
+
+    // one bitmap reused for rendering every flag (cleared before each one)
+    BitmapImpl flagBitmap( page.flagWidth, page.flagHeight, false );
+
+    for ( size_t cellIndex = 0; cellIndex < page.imageUids.size(); cellIndex++ )
+    {
+        flagBitmap.clear();
+        gem::Image( page.imageUids[cellIndex] ).render( flagBitmap );
+
+        const unsigned char* src = (const unsigned char*)flagBitmap.begin();
+        int x = ( int( cellIndex ) % page.columns ) * cellWidth;
+        int y = ( int( cellIndex ) / page.columns ) * cellHeight;
+
+        for ( int row = 0; row < page.flagHeight; row++ )
+        {
+            unsigned char* dst = pixels.data() + ( ( (size_t)( y + row ) * page.width + x ) * 4 );
+            memcpy( dst, src + (size_t)row * page.flagWidth * 4, (size_t)page.flagWidth * 4 );
+        }
+    }
+}
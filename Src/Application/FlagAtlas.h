@@ -0,0 +1,77 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include "ITextureRepository.h"
+
+#include <map>
+#include <vector>
+#include <functional>
+
+using ReleaseAtlasPageFunc = std::function<void( unsigned int& )>;
+
+// The flags of one atlas texture, in cell order (row by row)
+struct FlagAtlasPage
+{
+    FlagAtlasPage()
+        : width( 0 )
+        , height( 0 )
+        , columns( 0 )
+        , flagWidth( 0 )
+        , flagHeight( 0 )
+    {}
+
+    int width;
+    int height;
+    int columns;
+    int flagWidth;
+    int flagHeight;
+
+    std::vector<unsigned int> imageUids;
+};
+
+// Packs all country flags (of one size) into a few big textures, so that a
+// list of flags can be drawn with a single texture bind. The layout is done
+// up front, the pages are rendered separately (any thread) and their textures
+// set as they are uploaded.
+class FlagAtlas
+{
+public:
+    FlagAtlas();
+
+    // laid out for the flag size, the pages may not be uploaded yet
+    bool IsBuilt( int flagWidth, int flagHeight ) const;
+
+    // the layout only depends on the flags & their size, so a page can be loaded from a previous build
+    void Layout( const std::map<int, unsigned int>& isoToImageUids, int flagWidth, int flagHeight );
+    void Release( ReleaseAtlasPageFunc releaseFunc );
+
+    size_t GetPageCount() const;
+    const FlagAtlasPage& GetPage( size_t page ) const;
+
+    size_t GetFlagCount() const;
+
+    void SetPageTexture( size_t page, unsigned int textureId );
+
+    // returns a region with textureId == INVALID_TEXTURE_ID if the flag is not in the atlas or its page is not uploaded yet
+    TextureRegion GetRegion( int iso ) const;
+
+    // RGBA pixels of the page (ABGR_8888 as rendered); doesn't touch the atlas, safe on the workers
+    static void RenderPage( const FlagAtlasPage& page, std::vector<unsigned char>& pixels );
+
+private:
+    std::vector<FlagAtlasPage> m_pages;
+    std::vector<unsigned int> m_pageTextures;
+
+    // iso -> ( page, region without texture )
+    std::map<int, std::pair<size_t, TextureRegion>> m_regions;
+
+    int m_flagWidth;
+    int m_flagHeight;
+};
@@ -16,6 +16,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 #include <functional>
 
 class ITextureRepository;
@@ -24,8 +25,155 @@ class IResourceRepository;
 using IMapServicePtr = std::shared_ptr<class IMapService>;
 
 using ComputeRoutesCallback = std::function<void( int, gem::String, gem::RouteList )>;
+using RouteOperationId = unsigned int;
+const RouteOperationId KInvalidRouteOperationId = 0;
+
+// Computed routes cache counters
+struct RouteCacheStats
+{
+    RouteCacheStats()
+        : entryCount( 0 )
+        , hitCount( 0 )
+        , missCount( 0 )
+        , savedSeconds( 0 )
+    {}
+
+    size_t entryCount;
+    size_t hitCount;
+    size_t missCount;
+    double savedSeconds;    // computation time of the routes served from the cache
+};
 using DestinationReachedCallback = std::function<void( void )>;
 
+// Travel time / distance of the fastest route of each ( origin, destination ) pair, by origin
+struct RouteMatrix
+{
+    RouteMatrix()
+        : originCount( 0 )
+        , destinationCount( 0 )
+        , failedCount( 0 )
+        , elapsedSeconds( 0 )
+    {}
+
+    size_t GetCell( size_t origin, size_t destination ) const { return origin * destinationCount + destination; }
+
+    size_t originCount;
+    size_t destinationCount;
+
+    std::vector<int> timeSeconds;       // -1 = no route
+    std::vector<int> distanceMeters;    // -1 = no route
+
+    size_t failedCount;
+    double elapsedSeconds;              // cells / elapsedSeconds = throughput
+};
+
+// Latency of the route computations of a transport mode with some waypoints (cache hits not counted)
+struct RouteLatencyStats
+{
+    RouteLatencyStats()
+        : mode( ETransportMode::Car )
+        , minWaypoints( 0 )
+        , maxWaypoints( 0 )
+        , count( 0 )
+        , failedCount( 0 )
+        , p50Ms( 0 )
+        , p95Ms( 0 )
+        , p99Ms( 0 )
+        , maxMs( 0 )
+    {}
+
+    ETransportMode mode;
+    size_t minWaypoints;
+    size_t maxWaypoints;    // 0 = no upper bound
+
+    size_t count;       // completed computations, the failed ones included
+    size_t failedCount;
+
+    // percentiles are the upper bound of their histogram bucket (+19% at most)
+    double p50Ms;
+    double p95Ms;
+    double p99Ms;
+    double maxMs;
+};
+
+using RouteMatrixId = unsigned int;
+
+// ( matrix id, origin, destination, reason, time seconds, distance meters ), called as each cell completes
+using RouteMatrixCellCallback = std::function<void( RouteMatrixId, size_t, size_t, int, int, int )>;
+// ( matrix id, reason, matrix ), KNoError once all the cells were tried, KCancel if cancelled
+using RouteMatrixCallback = std::function<void( RouteMatrixId, int, const RouteMatrix& )>;
+
+// Result of an OptimizeWaypointOrder
+struct WaypointOrderReport
+{
+    WaypointOrderReport()
+        : inputSeconds( 0 )
+        , optimizedSeconds( 0 )
+        , matrixSeconds( 0 )
+        , optimizeSeconds( 0 )
+    {}
+
+    std::vector<size_t> order;      // the input index of each waypoint, in the optimised order
+    long long inputSeconds;         // travel time in the input order
+    long long optimizedSeconds;     // travel time in the optimised order
+    double matrixSeconds;           // the travel times matrix computation
+    double optimizeSeconds;         // the order search
+};
+
+using WaypointOrderId = unsigned int;
+const WaypointOrderId KInvalidWaypointOrderId = 0;
+
+// ( reason, the reordered waypoints, report ), KCancel if cancelled
+using OptimizeWaypointsCallback = std::function<void( int, gem::LandmarkList, const WaypointOrderReport& )>;
+
+// A turn of a stored route
+struct StoredRouteInstruction
+{
+    StoredRouteInstruction()
+        : timeSeconds( 0 )
+        , distanceMeters( 0 )
+    {}
+
+    gem::Coordinates coordinates;
+    int timeSeconds;        // traveled from the departure
+    int distanceMeters;     // traveled from the departure
+    std::string text;
+};
+
+struct StoredRoute
+{
+    StoredRoute()
+        : timeSeconds( 0 )
+        , distanceMeters( 0 )
+    {}
+
+    std::vector<gem::Coordinates> polyline;
+    std::vector<StoredRouteInstruction> instructions;
+    int timeSeconds;
+    int distanceMeters;
+};
+
+// Routes written by SaveRoutes, as read back by LoadRoutes (coordinates rounded to 1e-6 degrees)
+struct StoredRoutes
+{
+    StoredRoutes()
+        : mode( ETransportMode::Car )
+        , mapVersion( 0 )
+        , bOutdated( false )
+        , fileSize( 0 )
+        , loadSeconds( 0 )
+    {}
+
+    ETransportMode mode;
+    unsigned long long mapVersion;  // of the maps the routes were computed on
+    gem::LandmarkList waypoints;
+    std::vector<StoredRoute> routes;
+
+    bool bOutdated;         // the maps were updated since, the routes must be computed again
+    size_t fileSize;
+    double loadSeconds;     // file mapping & decoding
+};
+
 class IMapService
 {
 public:
@@ -50,6 +198,9 @@ public:
     virtual ITextureRepository* GetTextureRepository() = 0;
     virtual IResourceRepository* GetResourceRepository() = 0;
 
+    // fileName in the SDK cache dir, where the app keeps its own files (empty if the path is too long)
+    virtual std::string GetCacheFilePath( const std::string& fileName ) const = 0;
+
     virtual void UpdateMaps() = 0;
 
     // Render fps
@@ -60,8 +211,41 @@ public:
     virtual void Tick() = 0;
 
     // operations
-    virtual int ComputeRoutes( gem::LandmarkList waypoints, ComputeRoutesCallback callback, ETransportMode mode = ETransportMode::Car ) = 0;
-    virtual void CancelComputeRoutes() = 0;
+    // several computations may run at the same time, each one identified by its operationId
+    virtual int ComputeRoutes( gem::LandmarkList waypoints, ComputeRoutesCallback callback, ETransportMode mode = ETransportMode::Car, RouteOperationId* operationId = nullptr ) = 0;
+    virtual void CancelComputeRoutes( RouteOperationId operationId ) = 0;
+    virtual void CancelComputeRoutes() = 0; // all of them
+    virtual size_t GetComputeRoutesCount() const = 0;
+
+    // Routes every origin to every destination, at most maxParallelRoutes at a time per matrix
+    // (see SetRouteMatrixLimits); the callbacks are called from Tick / the routing completions.
+    virtual int ComputeRouteMatrix( gem::LandmarkList origins, gem::LandmarkList destinations, RouteMatrixCallback callback, RouteMatrixCellCallback cellCallback = nullptr, ETransportMode mode = ETransportMode::Car, RouteMatrixId* matrixId = nullptr ) = 0;
+    virtual void CancelRouteMatrix( RouteMatrixId matrixId ) = 0;
+    virtual void SetRouteMatrixLimits( size_t maxParallelRoutes ) = 0;
+
+    // Reorders the intermediate waypoints (the first and the last stay in place) for the shortest
+    // travel time, from the routes between near waypoints (the other legs estimated from the
+    // straight line distances); the result is meant for ComputeRoutes.
+    virtual int OptimizeWaypointOrder( gem::LandmarkList waypoints, OptimizeWaypointsCallback callback, ETransportMode mode = ETransportMode::Car, WaypointOrderId* orderId = nullptr ) = 0;
+    // the route matrix is cancelled, the callback is called (KCancel) from the next Ticks
+    virtual void CancelWaypointOrder( WaypointOrderId orderId ) = 0;
+
+    // Computed routes are reused for the same waypoints (quantised to precisionDegrees) and
+    // transport mode until they expire; flushed when the maps are updated. capacity = 0 disables it.
+    virtual void SetRouteCacheLimits( size_t capacity, double timeToLiveSeconds, double precisionDegrees ) = 0;
+    virtual RouteCacheStats GetRouteCacheStats() const = 0;
+    virtual void ClearRouteCache() = 0;
+
+    // From the calculateRoute call to its completion, by transport mode and waypoint count
+    virtual std::vector<RouteLatencyStats> GetRouteLatencyStats() const = 0;
+    // the histograms buckets: mode,min_waypoints,max_waypoints,bucket_upper_ms,count
+    virtual std::string GetRouteLatencyCsv() const = 0;
+    virtual void ClearRouteLatencyStats() = 0;
+
+    // Computed routes kept in a compact file (the polylines are delta encoded) which is memory
+    // mapped by LoadRoutes, to show them at once; the waypoints are meant for ComputeRoutes.
+    virtual int SaveRoutes( const std::string& filePath, const gem::RouteList& routes, ETransportMode mode = ETransportMode::Car ) = 0;
+    virtual int LoadRoutes( const std::string& filePath, StoredRoutes& routes ) = 0;
 
     virtual int StartNavigation( gem::Route route, DestinationReachedCallback callback ) = 0;
     virtual void StopNavigation() = 0;
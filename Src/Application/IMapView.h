@@ -11,6 +11,7 @@
 #include "Entities.h"
 
 #include <memory>
+#include <vector>
 
 #include "API/GEM_RoutingService.h"
 #include "API/GEM_Landmark.h"
@@ -42,6 +43,8 @@ public:
     virtual gem::Route SelectRoute( gem::Xy xy ) = 0;
 
     virtual void DisplayRoutes( gem::RouteList routes ) = 0;
+    // stored routes geometry, shown until DisplayRoutes / ClearRoutes (the first one is the main route)
+    virtual void DisplayRoutePreview( const std::vector<std::vector<gem::Coordinates>>& polylines ) = 0;
     virtual void DisplayLandmarks( gem::LandmarkList landmarks, bool center ) = 0;
 
     virtual gem::Route KeepOnlyMainRoute() = 0;
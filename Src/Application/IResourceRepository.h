@@ -10,6 +10,13 @@
 
 #include "API/GEM_ApiLists.h"
 
+#include "ContentCatalog.h"
+#include "DownloadScheduler.h"
+
+#include <memory>
+#include <vector>
+#include <functional>
+
 enum class EResourceType
 {
     Map,
@@ -25,11 +32,88 @@ enum class EItemState
     Other
 };
 
+// Immutable content store list, published by the repository and rebuilt only when
+// the list or the items states change (the version changes with each rebuild)
+struct ContentSnapshot
+{
+    ContentSnapshot( ContentCatalog&& catalog, size_t version )
+        : catalog( std::move( catalog ) )
+        , version( version )
+    {}
+
+    const ContentCatalog catalog; // items, in list order, with their states
+    const size_t version;
+};
+using ContentSnapshotPtr = std::shared_ptr<const ContentSnapshot>;
+
+// Combined progress of the items downloaded by a bulk download (updated twice a second)
+struct BulkDownloadProgress
+{
+    BulkDownloadProgress()
+        : itemCount( 0 )
+        , completedCount( 0 )
+        , failedCount( 0 )
+        , totalBytes( 0 )
+        , downloadedBytes( 0 )
+        , bytesPerSecond( 0 )
+        , etaSeconds( -1 )
+    {}
+
+    size_t itemCount;
+    size_t completedCount;
+    size_t failedCount;
+
+    gem::LargeInteger totalBytes;       // the failed items are taken out
+    gem::LargeInteger downloadedBytes;
+    double bytesPerSecond;              // smoothed
+    double etaSeconds;                  // -1 while unknown
+};
+
+using BulkDownloadId = size_t;
+
+// A content update applied by the repository
+struct UpdateApplyReport
+{
+    UpdateApplyReport( EResourceType type, double applySeconds )
+        : type( type )
+        , applySeconds( applySeconds )
+    {}
+
+    EResourceType type;
+    double applySeconds;    // how long the apply took (on a worker)
+};
+
+// Disk usage of the road maps
+struct StorageUsage
+{
+    StorageUsage()
+        : usedBytes( 0 )
+        , quotaBytes( 0 )
+        , mapCount( 0 )
+    {}
+
+    gem::LargeInteger usedBytes;    // downloaded + reserved by the running / paused downloads
+    gem::LargeInteger quotaBytes;   // 0 = no quota
+    size_t mapCount;                // downloaded
+};
+
+// ( bulk download id, reason ), KNoError if all the items were downloaded, else the first failure reason
+using BulkDownloadCompleteFunc = std::function<void( BulkDownloadId, int )>;
+
 class IResourceRepositoryListener
 {
 public:
     virtual void OnResourceUpdated ( EResourceType resType ) = 0;
 
+    // Progress events are delivered from the repository Tick (UI thread), coalesced to at most
+    // SetProgressEventsRate events per second for each item / update; the last value is never dropped
+    // while the download runs.
+    virtual void OnDownloadProgress( gem::LargeInteger itemId, int progress ) {}
+
+    // the download completed (KNoError), failed or was paused (KCancel), delivered from Tick after its progress
+    virtual void OnDownloadFinished( gem::LargeInteger itemId, int reason ) {}
+    virtual void OnUpdateProgress( EResourceType resType, int progress ) {}
+
     virtual ~IResourceRepositoryListener () = default;
 };
 
@@ -45,7 +129,44 @@ public:
     virtual gem::ContentStoreItemList GetStyles() = 0;
     virtual gem::ContentStoreItemList GetContentStoreItems( EResourceType type ) = 0;
 
-    virtual bool DownloadAsync( gem::ContentStoreItem& item ) = 0;
+    // cheap to call each frame (no lock, no list copy); empty snapshot while the resource is not available.
+    // The states of the running downloads are refreshed by Tick.
+    virtual ContentSnapshotPtr GetContentSnapshot( EResourceType type ) = 0;
+
+    // queued, started once a download slot is free; refused if the map can't fit the storage quota or the start failed
+    virtual EEnqueueResult DownloadAsync( gem::ContentStoreItem& item, EDownloadPriority priority = EDownloadPriority::UserInitiated ) = 0;
+    virtual void PauseDownload( gem::ContentStoreItem& item ) = 0;
+
+    // the running downloads are paused and queued again, nothing starts until resumed (e.g. while an update is applied)
+    virtual void PauseDownloadQueue() = 0;
+    virtual void ResumeDownloadQueue() = 0;
+    virtual bool IsDownloadQueuePaused() const = 0;
+
+    // The map items are downloaded as one job with a single completion callback (called from Tick).
+    // Items already downloaded are skipped; returns 0 if there is nothing to download.
+    virtual BulkDownloadId DownloadItems( const std::vector<gem::LargeInteger>& itemIds, BulkDownloadCompleteFunc completeFunc = nullptr, EDownloadPriority priority = EDownloadPriority::UserInitiated ) = 0;
+    // all the maps of the countries, e.g. a region
+    virtual BulkDownloadId DownloadCountries( const std::vector<gem::String>& isos, BulkDownloadCompleteFunc completeFunc = nullptr, EDownloadPriority priority = EDownloadPriority::UserInitiated ) = 0;
+
+    // false once the bulk download completed
+    virtual bool GetBulkDownloadProgress( BulkDownloadId id, BulkDownloadProgress& progress ) const = 0;
+
+    // the remaining items are paused, the bulk download completes with KCancel
+    virtual void CancelBulkDownload( BulkDownloadId id ) = 0;
+
+    // per item / update
+    virtual void SetProgressEventsRate( double eventsPerSecond ) = 0;
+
+    // Road maps budget (0 = no quota): the least recently used maps are deleted to make room for
+    // a new download, which is refused if it can't fit
+    virtual void SetStorageQuota( gem::LargeInteger quotaBytes ) = 0;
+    virtual StorageUsage GetStorageUsage() = 0;
+
+    // the maps of these countries are in use (e.g. on the active route): marked as used, never deleted
+    virtual void SetActiveCountries( const std::vector<gem::String>& isos ) = 0;
+
+    // maxBytesPerSecond = 0 means no cap
+    virtual void SetDownloadLimits( size_t maxParallelDownloads, double maxBytesPerSecond ) = 0;
 
     virtual EItemState GetItemState( const gem::ContentStoreItem& item ) const = 0;
 
@@ -54,12 +175,21 @@ public:
     virtual void UpdateMaps() = 0;
     virtual void UpdateStyles() = 0;
 
+    // Ready updates are staged and applied from Tick once updates could be applied for a
+    // while (idle window); set to false while a route is computed or a navigation runs.
     virtual void SetCanApplyMapUpdate( bool canApplyMapUpdate ) = 0;
+    virtual bool HasStagedUpdates() const = 0;
+
+    // the last applied updates, oldest first
+    virtual std::vector<UpdateApplyReport> GetUpdateApplyReports() const = 0;
 
     virtual void SetConnected( bool connected ) = 0;
 
     virtual gem::Image GetFlagImage( const gem::String& iso ) = 0;
 
+    // called once per frame
+    virtual void Tick() = 0;
+
     virtual ~IResourceRepository() = default;
 };
 using IResourceRepositoryPtr = std::shared_ptr<IResourceRepository>;
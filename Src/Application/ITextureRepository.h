@@ -10,12 +10,92 @@
 
 #include "API/GEM_Images.h"
 
+#include <future>
+#include <chrono>
+#include <vector>
+
 enum class EIconType
 {
     MenuButton,
     CurrentPosition
 };
 
+enum class ETextureUploadMode
+{
+    Direct,         // glTexImage2D from client memory
+    PixelBuffer     // staged through pixel buffer objects (GL / GLES 3.0 only)
+};
+
+enum class ETexturePriority
+{
+    Low,            // e.g. near visible
+    Normal,
+    High            // visible
+};
+
+enum class ETextureFormat
+{
+    RGBA8888,
+    RGB565          // half the memory, no alpha (low memory targets)
+};
+
+// no texture (not loaded, dropped request, unknown image)
+const unsigned int INVALID_TEXTURE_ID = ~0u;
+
+// part of a (possibly shared) texture, in normalized texture coordinates
+struct TextureRegion
+{
+    TextureRegion( unsigned int textureId = INVALID_TEXTURE_ID, float u0 = 0.f, float v0 = 0.f, float u1 = 1.f, float v1 = 1.f )
+        : textureId( textureId )
+        , u0( u0 )
+        , v0( v0 )
+        , u1( u1 )
+        , v1( v1 )
+    {}
+
+    unsigned int textureId;
+    float u0, v0;
+    float u1, v1;
+};
+
+struct TextureCacheStats
+{
+    TextureCacheStats()
+        : hits( 0 )
+        , misses( 0 )
+        , evictions( 0 )
+        , entries( 0 )
+        , bytes( 0 )
+        , budgetBytes( 0 )
+        , bitmapLeases( 0 )
+        , bitmapReuses( 0 )
+        , pooledBitmapBytes( 0 )
+    {}
+
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t entries;
+    size_t bytes;       // GPU memory used by the cached textures
+    size_t budgetBytes;
+
+    // pixel buffers of the rendered bitmaps (BitmapBufferPool)
+    size_t bitmapLeases;
+    size_t bitmapReuses;        // leases served from the pool
+    size_t pooledBitmapBytes;   // free buffers kept for reuse
+};
+
+// texture id, available once the texture is uploaded (INVALID_TEXTURE_ID if the request was dropped)
+using TextureFuture = std::shared_future<unsigned int>;
+
+inline bool IsTextureReady( const TextureFuture& future )
+{
+    return future.valid() && future.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready;
+}
+
+// number of prefetched textures, available once the whole batch is uploaded or dropped
+using PrefetchFuture = std::shared_future<size_t>;
+
 class ITextureRepository
 {
 public:
@@ -26,9 +106,45 @@ public:
     virtual unsigned int GetTexture( gem::Image image, int w, int h, bool bSync = true ) = 0;
     virtual unsigned int GetTexture( const gem::AbstractGeometryImage& image, const gem::AbstractGeometryImageRenderSettings& settings, int w, int h, bool bSync = true ) = 0;
 
+    // never blocks: the image is rendered on a worker and uploaded by Tick()
+    virtual TextureFuture RequestTexture( gem::Image image, int w, int h ) = 0;
+    virtual TextureFuture RequestTexture( const gem::AbstractGeometryImage& image, const gem::AbstractGeometryImageRenderSettings& settings, int w, int h ) = 0;
+
+    // renders the batch on all the workers, the textures are uploaded incrementally by Tick()
+    virtual PrefetchFuture PrefetchTextures( const std::vector<gem::Image>& images, int w, int h, ETexturePriority priority = ETexturePriority::Normal ) = 0;
+
+    // country flag from the flags atlas (all flags of a size share the same texture); the atlas is
+    // rendered on the workers, the region has no texture until the flag's page is uploaded by Tick()
+    virtual TextureRegion GetFlagTexture( const gem::String& iso, int w, int h ) = 0;
+
     virtual void UnloadAllTextures() = 0;
     virtual void UnloadTexture( unsigned int textureId ) = 0;
 
+    // textures cache (least recently used textures are unloaded once over budget)
+    virtual void SetCacheBudget( size_t budgetBytes ) = 0;
+    virtual TextureCacheStats GetCacheStats() const = 0;
+
+    // free pixel buffers kept for rendering the next bitmaps
+    virtual void SetBitmapPoolLimit( size_t maxPooledBytes ) = 0;
+
+    // bytes of rendered textures uploaded to the GPU per frame (at least one texture)
+    virtual void SetUploadBudget( size_t bytesPerFrame ) = 0;
+
+    // pixel buffers fall back to direct uploads on GLES2
+    virtual void SetUploadMode( ETextureUploadMode mode ) = 0;
+    virtual ETextureUploadMode GetUploadMode() const = 0;
+
+    // format of the image textures (the flags atlas is always RGBA); changing it unloads the cached textures
+    virtual void SetTextureFormat( ETextureFormat format ) = 0;
+    virtual ETextureFormat GetTextureFormat() const = 0;
+
+    // premultiplied alpha textures (for a premultiplied blend function); changing it unloads the cached textures
+    virtual void SetPremultipliedAlpha( bool bPremultiplied ) = 0;
+    virtual bool IsPremultipliedAlpha() const = 0;
+
+    // called once per frame, from the render thread (uploads the rendered textures)
+    virtual void Tick() = 0;
+
     virtual ~ITextureRepository() = default;
 };
 
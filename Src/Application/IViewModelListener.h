@@ -5,7 +5,8 @@ enum class EVmEvent
     Generic_ChangedConnection, 
     Generic_AppClose,
     Generic_NewMaps,
-    Generic_MapsExpired
+    Generic_MapsExpired,
+    Routes_ComputeFailed
 };
 
 class IViewModelListener
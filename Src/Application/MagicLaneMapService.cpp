@@ -13,11 +13,25 @@
 #include "ResourceRepository.h"
 
 #include "MapView.h"
+#include "RouteArchive.h"
 
 #include "SDKUtils.h"
 
 #include "API/GEM_NavigationService.h"
 #include "API/GEM_OperationScheduler.h"
+#include "API/GEM_Debug.h"
+
+#include <algorithm>
+
+// route computations of a route matrix running at the same time (the route operations allow 8,
+// the last one is kept for the user)
+const size_t MAX_PARALLEL_MATRIX_ROUTES = 4;
+
+// the nearest waypoints whose legs are routed for a waypoints reordering, the others are estimated
+const size_t WAYPOINT_ORDER_NEIGHBOURS = 5;
+
+// below the texture renders, which share the worker pool
+const int WAYPOINT_ORDER_PRIORITY = -1;
 
 IMapServicePtr IMapService::Produce( const std::string& logFile )
 {
@@ -38,9 +52,23 @@ MagicLaneMapService::MagicLaneMapService( SDKUtils* sdkUtils )
     , m_bHasToken( false )
     , m_bRenderFps( false )
     , m_activeOperation( EOperation::None )
+    , m_nextRouteMatrixId( 1 )
+    , m_maxParallelMatrixRoutes( MAX_PARALLEL_MATRIX_ROUTES )
+    , m_nextWaypointOrderId( 1 )
+    , m_workerPool( nullptr )
 {
-    m_textureRepository = new TextureRepository();
-    m_resourceRepository = new ResourceRepository();
+    // read once, on first use
+    auto countries = std::make_shared<CountryMetadata>();
+
+    auto textureRepository = new TextureRepository( m_sdkUtils->GetCachePath(), countries );
+    m_workerPool = &textureRepository->GetWorkerPool();
+    m_resourceRepository = new ResourceRepository( m_workerPool, m_sdkUtils->GetCachePath(), countries );
+
+    // the textures disk cache is invalidated by the content updates
+    m_resourceRepository->AddListener( textureRepository );
+    m_textureRepository = textureRepository;
+
+    m_resourceRepository->AddListener( this );
 
     const char* token = std::getenv( "GEM_TOKEN" );
     if ( token )
@@ -54,8 +82,15 @@ MagicLaneMapService::MagicLaneMapService( SDKUtils* sdkUtils )
 
 MagicLaneMapService::~MagicLaneMapService()
 {
+    // while the SDK is still alive, before the callbacks owners go away
+    m_routeOperations.Reset();
+    m_routeMatrices.clear();
+
     m_textureRepository->UnloadAllTextures();
 
+    m_resourceRepository->RemoveListener( static_cast<TextureRepository*>( m_textureRepository ) );
+    m_resourceRepository->RemoveListener( this );
+
     if ( m_textureRepository )
         delete m_textureRepository;
 
@@ -140,6 +175,11 @@ IResourceRepository* MagicLaneMapService::GetResourceRepository()
     return m_resourceRepository;
 }
 
+std::string MagicLaneMapService::GetCacheFilePath( const std::string& fileName ) const
+{
+    return SDKUtils::CombinePath( m_sdkUtils->GetCachePath(), fileName );
+}
+
 void MagicLaneMapService::UpdateMaps()
 {
 	GetResourceRepository()->UpdateMaps();
@@ -159,40 +199,23 @@ void MagicLaneMapService::Tick ()
 {
     m_sdkUtils->Tick ();
 
-    m_screen->render();
-}
-
-// Progress listener
-using ProgressCompleteFunc = std::function<void( int, gem::String )>;
-
-class ProgressListenerImpl : public gem::IProgressListener
-{
-public:
-    ProgressListenerImpl( ProgressCompleteFunc func )
-        : m_func( func )
-    {
+    // content updates are applied only while no route is computed and no navigation runs
+    m_resourceRepository->SetCanApplyMapUpdate( m_activeOperation == EOperation::None && m_routeOperations.GetCount() == 0 );
+    m_resourceRepository->Tick();
 
-    }
+    m_textureRepository->Tick();
 
-    virtual void notifyStart( bool hasProgress ) override
-    {
+    TickRouteMatrices();
+    TickWaypointOrders();
 
-    }
-
-    virtual void notifyComplete( int reason, gem::String hint = gem::String() ) override
-    {
-        m_func( reason, hint );
-    }
-
-private:
-    ProgressCompleteFunc m_func;
-};
-// end progress listener
+    m_screen->render();
+}
 
-int MagicLaneMapService::ComputeRoutes( gem::LandmarkList waypoints, ComputeRoutesCallback callback, ETransportMode mode /*= ETransportMode::Car*/ )
+// the SDK route preferences of the transport mode
+static gem::RoutePreferences GetRoutePreferences( ETransportMode mode, gem::EBikeProfile& bikeProfile )
 {
     gem::ERouteTransportMode transportMode = gem::RTM_Car;
-    gem::EBikeProfile bikeProfile = gem::EBikeProfile::BP_Road;
+    bikeProfile = gem::EBikeProfile::BP_Road;
     bool isSpecific = false;
 
     switch ( mode )
@@ -231,56 +254,312 @@ int MagicLaneMapService::ComputeRoutes( gem::LandmarkList waypoints, ComputeRout
         break;
     }
 
-    if ( m_activeOperation != EOperation::None )
-        return gem::error::KBusy;
+    gem::RoutePreferences preferences;
+    preferences.setTransportMode( transportMode );
+    if ( isSpecific )
+        preferences.setBikeProfile( bikeProfile );
+
+    return preferences;
+}
+
+int MagicLaneMapService::ComputeRoutes( gem::LandmarkList waypoints, ComputeRoutesCallback callback, ETransportMode mode /*= ETransportMode::Car*/, RouteOperationId* operationId /*= nullptr*/ )
+{
+    gem::EBikeProfile bikeProfile;
+    gem::RoutePreferences preferences = GetRoutePreferences( mode, bikeProfile );
+
+    // flipping the transport mode back and forth reuses the routes
+    std::string cacheKey = m_routeOperations.GetCache().MakeKey( waypoints, mode, bikeProfile );
+
+    RouteOperationId newOperationId;
+
+    int err = m_routeOperations.Start( waypoints, preferences, mode, cacheKey, callback, newOperationId );
+
+    if ( operationId )
+        *operationId = newOperationId;
+
+    return err;
+}
+
+void MagicLaneMapService::CancelComputeRoutes( RouteOperationId operationId )
+{
+    m_routeOperations.Cancel( operationId );
+}
 
-    m_routes.clear();
+void MagicLaneMapService::CancelComputeRoutes()
+{
+    m_routeOperations.CancelAll();
+}
 
-    m_computeRoutesCallback = callback;
+size_t MagicLaneMapService::GetComputeRoutesCount() const
+{
+    return m_routeOperations.GetCount();
+}
 
-    auto func = [&]( int reason, gem::String hint )
+int MagicLaneMapService::ComputeRouteMatrix( gem::LandmarkList origins, gem::LandmarkList destinations, RouteMatrixCallback callback, RouteMatrixCellCallback cellCallback /*= nullptr*/, ETransportMode mode /*= ETransportMode::Car*/, RouteMatrixId* matrixId /*= nullptr*/ )
+{
+    return StartRouteMatrix( origins, destinations, std::vector<size_t>(), callback, cellCallback, mode, matrixId );
+}
+
+int MagicLaneMapService::StartRouteMatrix( const gem::LandmarkList& origins, const gem::LandmarkList& destinations, const std::vector<size_t>& cells, RouteMatrixCallback callback, RouteMatrixCellCallback cellCallback, ETransportMode mode, RouteMatrixId* matrixId )
+{
+    if ( origins.empty() || destinations.empty() )
+        return gem::error::KInvalidInput;
+
+    gem::EBikeProfile bikeProfile;
+    gem::RoutePreferences preferences = GetRoutePreferences( mode, bikeProfile );
+
+    RouteMatrixId newMatrixId = m_nextRouteMatrixId++;
+
+    m_routeMatrices[newMatrixId] = std::make_shared<RouteMatrixOperation>( newMatrixId, m_routeOperations, origins, destinations,
+        preferences, mode, m_maxParallelMatrixRoutes, callback, cellCallback, cells );
+
+    if ( matrixId )
+        *matrixId = newMatrixId;
+
+    // the first cells are started by the next Tick
+    return gem::KNoError;
+}
+
+void MagicLaneMapService::CancelRouteMatrix( RouteMatrixId matrixId )
+{
+    auto it = m_routeMatrices.find( matrixId );
+    if ( it != m_routeMatrices.end() )
+        it->second->Cancel();
+}
+
+void MagicLaneMapService::SetRouteMatrixLimits( size_t maxParallelRoutes )
+{
+    // for the next matrices
+    m_maxParallelMatrixRoutes = maxParallelRoutes;
+}
+
+int MagicLaneMapService::OptimizeWaypointOrder( gem::LandmarkList waypoints, OptimizeWaypointsCallback callback, ETransportMode mode /*= ETransportMode::Car*/, WaypointOrderId* orderId /*= nullptr*/ )
+{
+    if ( waypoints.size() < 3 )
+        return gem::error::KInvalidInput;
+
+    auto request = std::make_shared<WaypointOrderRequest>( m_nextWaypointOrderId++, waypoints, callback );
+
+    // n x n routes are too many for a long list of stops: only the legs between near waypoints are
+    // routed, the estimates of the others are scaled to match them
+    auto estimate = std::make_shared<RouteMatrix>( WaypointOrderOptimizer::EstimateMatrix( waypoints, mode ) );
+    auto cells = std::make_shared<std::vector<size_t>>( WaypointOrderOptimizer::GetCandidateCells( *estimate, WAYPOINT_ORDER_NEIGHBOURS ) );
+
+    auto matrixFunc = [this, request, estimate, cells]( RouteMatrixId, int reason, const RouteMatrix& matrix )
     {
-        m_operationListener.reset();
+        request->matrixSeconds = matrix.elapsedSeconds;
 
-        if ( m_computeRoutesCallback )
+        if ( reason != gem::KNoError )
         {
-            m_computeRoutesCallback( reason, hint, m_routes );
-            m_routes.clear();
-            m_computeRoutesCallback = nullptr;
+            m_waypointOrderRequests.erase( std::remove( m_waypointOrderRequests.begin(), m_waypointOrderRequests.end(), request ), m_waypointOrderRequests.end() );
+
+            WaypointOrderReport report;
+            report.matrixSeconds = request->matrixSeconds;
+
+            if ( request->callback )
+                request->callback( reason, request->waypoints, report );
+
+            return;
         }
 
-        m_activeOperation = EOperation::None;
+        // a search per worker thread, each from a different start order
+        request->optimizer = std::make_shared<WaypointOrderOptimizer>( WaypointOrderOptimizer::MergeMatrix( *estimate, matrix, *cells ) );
+        request->optimizer->Start( *m_workerPool, m_workerPool->GetThreadCount(), WAYPOINT_ORDER_PRIORITY );
     };
 
-    m_operationListener = gem::StrongPointerFactory<ProgressListenerImpl>( func );
+    int err = StartRouteMatrix( waypoints, waypoints, *cells, matrixFunc, nullptr, mode, &request->matrixId );
+    if ( err != gem::KNoError )
+        return err;
 
-    gem::RoutePreferences preferences;
-    preferences.setTransportMode( transportMode );
-    if ( isSpecific )
-        preferences.setBikeProfile( bikeProfile );
+    m_waypointOrderRequests.push_back( request );
+
+    if ( orderId )
+        *orderId = request->orderId;
+
+    return gem::KNoError;
+}
+
+void MagicLaneMapService::CancelWaypointOrder( WaypointOrderId orderId )
+{
+    for ( const auto& request : m_waypointOrderRequests )
+    {
+        if ( request->orderId != orderId )
+            continue;
+
+        // the matrix callback completes the request
+        if ( !request->optimizer )
+            CancelRouteMatrix( request->matrixId );
+        else
+            request->bCancelled = true;
+
+        return;
+    }
+}
+
+void MagicLaneMapService::TickWaypointOrders()
+{
+    // a callback may request another order
+    auto requests = m_waypointOrderRequests;
+
+    for ( const auto& request : requests )
+    {
+        if ( request->bCancelled )
+        {
+            // the searches keep the optimizer alive until they complete
+            m_waypointOrderRequests.erase( std::remove( m_waypointOrderRequests.begin(), m_waypointOrderRequests.end(), request ), m_waypointOrderRequests.end() );
+
+            WaypointOrderReport report;
+            report.matrixSeconds = request->matrixSeconds;
+
+            if ( request->callback )
+                request->callback( gem::error::KCancel, request->waypoints, report );
+
+            continue;
+        }
+
+        if ( !request->optimizer || !request->optimizer->IsDone() )
+            continue;
+
+        m_waypointOrderRequests.erase( std::remove( m_waypointOrderRequests.begin(), m_waypointOrderRequests.end(), request ), m_waypointOrderRequests.end() );
+
+        WaypointOrderReport report = request->optimizer->GetReport();
+        report.matrixSeconds = request->matrixSeconds;
+
+        gem::LandmarkList waypoints;
+        for ( auto index : report.order )
+            waypoints.push_back( request->waypoints.toStd()[index] );
+
+        gem::Debug().log( gem::LogInfo, "MagicLaneMapService", __FUNCTION__, __FILE__, __LINE__, "%d waypoints reordered, %lld s -> %lld s (matrix %.2f s, search %.2f s)",
+            int( waypoints.size() ), report.inputSeconds, report.optimizedSeconds, report.matrixSeconds, report.optimizeSeconds );
+
+        if ( request->callback )
+            request->callback( gem::KNoError, waypoints, report );
+    }
+}
+
+void MagicLaneMapService::TickRouteMatrices()
+{
+    // a callback may request another matrix
+    auto routeMatrices = m_routeMatrices;
+
+    for ( const auto& it : routeMatrices )
+        if ( !it.second->Tick() )
+            m_routeMatrices.erase( it.first );
+}
+
+void MagicLaneMapService::SetRouteCacheLimits( size_t capacity, double timeToLiveSeconds, double precisionDegrees )
+{
+    m_routeOperations.GetCache().SetLimits( capacity, timeToLiveSeconds, precisionDegrees );
+}
+
+RouteCacheStats MagicLaneMapService::GetRouteCacheStats() const
+{
+    return m_routeOperations.GetCache().GetStats();
+}
+
+void MagicLaneMapService::ClearRouteCache()
+{
+    m_routeOperations.GetCache().Clear();
+}
+
+std::vector<RouteLatencyStats> MagicLaneMapService::GetRouteLatencyStats() const
+{
+    return m_routeOperations.GetLatencies().GetStats();
+}
+
+std::string MagicLaneMapService::GetRouteLatencyCsv() const
+{
+    return m_routeOperations.GetLatencies().GetCsv();
+}
+
+void MagicLaneMapService::ClearRouteLatencyStats()
+{
+    m_routeOperations.GetLatencies().Clear();
+}
+
+// identifies the road maps the routes are computed on
+static StoredRoute GetStoredRoute( const gem::Route& route )
+{
+    StoredRoute storedRoute;
+
+    auto timeDistance = route.getTimeDistance();
+    storedRoute.timeSeconds = timeDistance.getTotalTime();
+    storedRoute.distanceMeters = timeDistance.getTotalDistance();
+
+    for ( const auto& coordinates : route.getPath().getCoordinates() )
+        storedRoute.polyline.push_back( coordinates );
 
-    m_activeOperation = EOperation::ComputeRoute;
+    for ( const auto& segment : route.getSegments() )
+    {
+        for ( const auto& instruction : segment.getInstructions() )
+        {
+            auto traveled = instruction.getTraveledTimeDistance();
+
+            StoredRouteInstruction storedInstruction;
+            storedInstruction.coordinates = instruction.getCoordinates();
+            storedInstruction.timeSeconds = traveled.getTotalTime();
+            storedInstruction.distanceMeters = traveled.getTotalDistance();
+            storedInstruction.text = instruction.getTurnInstruction().toStdString();
+
+            storedRoute.instructions.push_back( storedInstruction );
+        }
+    }
+
+    return storedRoute;
+}
+
+int MagicLaneMapService::SaveRoutes( const std::string& filePath, const gem::RouteList& routes, ETransportMode mode /*= ETransportMode::Car*/ )
+{
+    if ( routes.empty() )
+        return gem::error::KInvalidInput;
 
-    int err = gem::RoutingService().calculateRoute( m_routes, waypoints, preferences, m_operationListener );
+    StoredRoutes storedRoutes;
+    storedRoutes.mode = mode;
+    storedRoutes.mapVersion = SDKUtils::GetMapVersion();
+    storedRoutes.waypoints = routes[0].getWaypoints();
 
+    for ( const auto& route : routes )
+        storedRoutes.routes.push_back( GetStoredRoute( route ) );
+
+    return RouteArchive::Write( filePath, storedRoutes );
+}
+
+int MagicLaneMapService::LoadRoutes( const std::string& filePath, StoredRoutes& routes )
+{
+    int err = RouteArchive::Read( filePath, routes );
     if ( err != gem::KNoError )
+        return err;
+
+    routes.bOutdated = routes.mapVersion != SDKUtils::GetMapVersion();
+
+    // compared to computing the routes again for these waypoints
+    double computeMs = 0;
+
+    for ( const auto& stats : GetRouteLatencyStats() )
     {
-        m_activeOperation = EOperation::None;
-        m_computeRoutesCallback = nullptr;
+        if ( stats.mode == routes.mode && routes.waypoints.size() >= stats.minWaypoints && ( stats.maxWaypoints == 0 || routes.waypoints.size() <= stats.maxWaypoints ) )
+            computeMs = stats.p50Ms;
     }
 
-    return err;
+    gem::Debug().log( gem::LogInfo, "MagicLaneMapService", __FUNCTION__, __FILE__, __LINE__, "%d routes loaded from %d bytes in %.3f ms (computation p50 %.1f ms)%s",
+        int( routes.routes.size() ), int( routes.fileSize ), routes.loadSeconds * 1000, computeMs, routes.bOutdated ? ", maps updated since" : "" );
+
+    return gem::KNoError;
 }
 
-void MagicLaneMapService::CancelComputeRoutes()
+// the countries of the route waypoints (their maps are kept while the route is active)
+static std::vector<gem::String> GetRouteCountries( const gem::Route& route )
 {
-    if ( m_activeOperation == EOperation::ComputeRoute && m_operationListener )
+    std::vector<gem::String> isos;
+
+    for ( const auto& waypoint : route.getWaypoints() )
     {
-        gem::RoutingService().cancelRoute( m_operationListener );
-        m_operationListener.reset();
-        m_routes.clear();
-        m_activeOperation = EOperation::None;
+        gem::String iso = waypoint.getAddress().getField( gem::EAddressField::CountryCode );
+        if ( !iso.empty() && std::find( isos.begin(), isos.end(), iso ) == isos.end() )
+            isos.push_back( iso );
     }
+
+    return isos;
 }
 
 int MagicLaneMapService::StartNavigation( gem::Route route, DestinationReachedCallback callback )
@@ -304,6 +583,10 @@ int MagicLaneMapService::StartNavigation( gem::Route route, DestinationReachedCa
 		m_destinationReachedCallback = nullptr;
 		m_navigationHandler = {};
 	}
+	else
+	{
+		m_resourceRepository->SetActiveCountries( GetRouteCountries( route ) );
+	}
 
 	return err;
 }
@@ -324,6 +607,8 @@ void MagicLaneMapService::StopNavigation()
         m_navigationHandler = {};
 
         m_activeOperation = EOperation::None;
+
+        m_resourceRepository->SetActiveCountries( {} );
     }
 }
 
@@ -369,6 +654,13 @@ void MagicLaneMapService::onAvailableContentUpdate( int type, EStatus state )
         it->OnMapServiceEvent( EMapServiceEvent::NewStyles );
 }
 
+void MagicLaneMapService::OnResourceUpdated( EResourceType resType )
+{
+    // the routes computed on the old maps
+    if ( resType == EResourceType::Map )
+        m_routeOperations.GetCache().Clear();
+}
+
 NavigationHandler::NavigationHandler( MagicLaneMapService* mapService, DestinationReachedCallback callback )
     : m_mapService( mapService )
     , m_callback( callback )
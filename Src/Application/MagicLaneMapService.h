@@ -14,6 +14,10 @@
 #include "IResourceRepository.h"
 #include "IOpenGLContext.h"
 #include "IMapServiceListener.h"
+#include "RouteOperationManager.h"
+#include "RouteMatrixOperation.h"
+#include "WaypointOrderOptimizer.h"
+#include "WorkerPool.h"
 
 #include <API/GEM_Canvas.h>
 #include <API/GEM_SdkSettings.h>
@@ -26,7 +30,6 @@ class SDKUtils;
 enum class EOperation
 {
     None,
-    ComputeRoute,
     Navigate,
     Simulate,
     Search
@@ -34,7 +37,7 @@ enum class EOperation
 
 using NavigationHandlerPtr = std::shared_ptr<class NavigationHandler>;
 
-class MagicLaneMapService : public IMapService, public gem::IOffboardListener
+class MagicLaneMapService : public IMapService, public gem::IOffboardListener, public IResourceRepositoryListener
 {
 public:
     MagicLaneMapService( SDKUtils* sdkUtils );
@@ -56,6 +59,8 @@ public:
     ITextureRepository* GetTextureRepository() override;
     IResourceRepository* GetResourceRepository() override;
 
+    std::string GetCacheFilePath( const std::string& fileName ) const override;
+
     void UpdateMaps() override;
 
     bool IsRenderFps() const override;
@@ -64,8 +69,28 @@ public:
     void Tick() override;
 
     // different operations
-    int ComputeRoutes( gem::LandmarkList waypoints, ComputeRoutesCallback callback, ETransportMode mode = ETransportMode::Car ) override;
+    int ComputeRoutes( gem::LandmarkList waypoints, ComputeRoutesCallback callback, ETransportMode mode = ETransportMode::Car, RouteOperationId* operationId = nullptr ) override;
+    void CancelComputeRoutes( RouteOperationId operationId ) override;
     void CancelComputeRoutes() override;
+    size_t GetComputeRoutesCount() const override;
+
+    int ComputeRouteMatrix( gem::LandmarkList origins, gem::LandmarkList destinations, RouteMatrixCallback callback, RouteMatrixCellCallback cellCallback = nullptr, ETransportMode mode = ETransportMode::Car, RouteMatrixId* matrixId = nullptr ) override;
+    void CancelRouteMatrix( RouteMatrixId matrixId ) override;
+    void SetRouteMatrixLimits( size_t maxParallelRoutes ) override;
+
+    int OptimizeWaypointOrder( gem::LandmarkList waypoints, OptimizeWaypointsCallback callback, ETransportMode mode = ETransportMode::Car, WaypointOrderId* orderId = nullptr ) override;
+    void CancelWaypointOrder( WaypointOrderId orderId ) override;
+
+    void SetRouteCacheLimits( size_t capacity, double timeToLiveSeconds, double precisionDegrees ) override;
+    RouteCacheStats GetRouteCacheStats() const override;
+    void ClearRouteCache() override;
+
+    std::vector<RouteLatencyStats> GetRouteLatencyStats() const override;
+    std::string GetRouteLatencyCsv() const override;
+    void ClearRouteLatencyStats() override;
+
+    int SaveRoutes( const std::string& filePath, const gem::RouteList& routes, ETransportMode mode = ETransportMode::Car ) override;
+    int LoadRoutes( const std::string& filePath, StoredRoutes& routes ) override;
 
     int StartNavigation( gem::Route route, DestinationReachedCallback callback );
     void StopNavigation();
@@ -76,6 +101,12 @@ public:
 
 
 private:
+    // cells empty = all of them
+    int StartRouteMatrix( const gem::LandmarkList& origins, const gem::LandmarkList& destinations, const std::vector<size_t>& cells, RouteMatrixCallback callback, RouteMatrixCellCallback cellCallback, ETransportMode mode, RouteMatrixId* matrixId );
+
+    void TickRouteMatrices();
+    void TickWaypointOrders();
+
     // gem::IOffboardListener implementation (for connection status)
     void onConnectionStatusUpdated( bool connected ) override;
     void onWorldwideRoadMapSupportDisabled( EReason reason ) override {}
@@ -85,6 +116,9 @@ private:
     // some content, other than maps got updated (e.g. styles) after a CheckForUpdate call
     void onAvailableContentUpdate( int type, EStatus state ) override;
 
+    // IResourceRepositoryListener implementation (the cached routes are flushed by a maps update)
+    void OnResourceUpdated( EResourceType resType ) override;
+
 private:
     ITextureRepository* m_textureRepository;
     IResourceRepository* m_resourceRepository;
@@ -104,12 +138,41 @@ private:
 
     bool m_bRenderFps;
 
+    // navigation / search, the route computations are counted by m_routeOperations
     EOperation m_activeOperation;
 
     // Routes
-    gem::StrongPointer<gem::IProgressListener> m_operationListener;
-    ComputeRoutesCallback m_computeRoutesCallback;
-    gem::RouteList m_routes;
+    RouteOperationManager m_routeOperations;
+
+    std::map<RouteMatrixId, RouteMatrixOperationPtr> m_routeMatrices;
+    RouteMatrixId m_nextRouteMatrixId;
+    size_t m_maxParallelMatrixRoutes;
+
+    // waypoints reordering, the matrix of the candidate legs first then the order search
+    struct WaypointOrderRequest
+    {
+        WaypointOrderRequest( WaypointOrderId orderId_, const gem::LandmarkList& waypoints_, OptimizeWaypointsCallback callback_ )
+            : orderId( orderId_ )
+            , waypoints( waypoints_ )
+            , callback( callback_ )
+            , matrixId( 0 )
+            , bCancelled( false )
+            , matrixSeconds( 0 )
+        {}
+
+        WaypointOrderId orderId;
+        gem::LandmarkList waypoints;
+        OptimizeWaypointsCallback callback;
+        RouteMatrixId matrixId;
+        bool bCancelled;                        // during the order search, which is left to complete
+        double matrixSeconds;
+        WaypointOrderOptimizerPtr optimizer;    // set once the matrix is computed
+    };
+    using WaypointOrderRequestPtr = std::shared_ptr<WaypointOrderRequest>;
+
+    std::vector<WaypointOrderRequestPtr> m_waypointOrderRequests;
+    WaypointOrderId m_nextWaypointOrderId;
+    WorkerPool* m_workerPool;   // the texture repository's, shared with the other background work
 
     // Navigation
     gem::NavigationInstruction m_instruction;
@@ -12,6 +12,11 @@
 // (std::int64_t(gem::CT_ViewStyleHighRes) << 32) | 2538
 const LargeInteger DEFAULT_MAP_STYLE_ID = 0;
 
+// stored routes shown until they are computed again
+const gem::Rgba ROUTE_PREVIEW_BORDER_COLOR( 255, 255, 255, 255 );
+const gem::Rgba MAIN_ROUTE_PREVIEW_COLOR( 80, 140, 230, 255 );
+const gem::Rgba ALTERNATIVE_ROUTE_PREVIEW_COLOR( 150, 170, 200, 255 );
+
 MapView::MapView( gem::StrongPointer<gem::Screen> screen, RectF area, float dpi )
     : m_bRenderFps( false )
     , m_dpi( 1 )
@@ -127,6 +132,7 @@ void MapView::DisplayRoutes( gem::RouteList routes )
     m_pView->deactivateAllHighlights();
 
     m_pView->preferences().routes().clear();
+    m_pView->preferences().paths().clear();
     m_pView->preferences().routes().add( routes[0], true );
 
     for ( int i = 1; i < routes.size(); i++ )
@@ -143,6 +149,25 @@ void MapView::DisplayRoutes( gem::RouteList routes )
     m_pView->centerOnRoutes( routes, gem::ERouteDisplayMode::RDM_Full, routesRect );
 }
 
+void MapView::DisplayRoutePreview( const std::vector<std::vector<gem::Coordinates>>& polylines )
+{
+    m_pView->preferences().routes().clear();
+    m_pView->preferences().paths().clear();
+
+    // the main route last, drawn over the alternatives
+    for ( size_t i = polylines.size(); i-- > 0; )
+    {
+        gem::CoordinatesList coordinates;
+
+        for ( const auto& point : polylines[i] )
+            coordinates.push_back( point );
+
+        const gem::Rgba& innerColor = i == 0 ? MAIN_ROUTE_PREVIEW_COLOR : ALTERNATIVE_ROUTE_PREVIEW_COLOR;
+
+        m_pView->preferences().paths().add( gem::Path( coordinates ), ROUTE_PREVIEW_BORDER_COLOR, innerColor, 0.5, 1.0 );
+    }
+}
+
 void MapView::DisplayLandmarks( gem::LandmarkList landmarks, bool center )
 {
     m_pView->deactivateAllHighlights();
@@ -233,6 +258,7 @@ gem::Landmark* MapView::SelectWaypoint( gem::LandmarkList waypoints, gem::Xy xy
 void MapView::ClearRoutes()
 {
     m_pView->preferences().routes().clear();
+    m_pView->preferences().paths().clear();
 }
 
 void MapView::DeactivateAllHighlights()
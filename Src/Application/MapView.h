@@ -38,6 +38,7 @@ public:
     void HandleScroll( int delta, Xy xy ) override;
 
     void DisplayRoutes( gem::RouteList routes );
+    void DisplayRoutePreview( const std::vector<std::vector<gem::Coordinates>>& polylines ) override;
     void DisplayLandmarks( gem::LandmarkList landmarks, bool center ) override;
     void DisplayLandmark( gem::Landmark landmark, bool center );
 
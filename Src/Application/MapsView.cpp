@@ -12,6 +12,8 @@ MapsView::MapsView( IMainWindow* parent )
     : BaseView( parent )
     , m_viewModel( nullptr )
     , m_mapFilterIndex( 0 )
+    , m_bulkDownloadId( 0 )
+    , m_rowsVersion( 0 )
 {
 
 }
@@ -50,7 +52,27 @@ void MapsView::Render()
     }
     else
     {
-        gem::ContentStoreItemList contentStoreItems = resourceRepository->GetMaps();
+        ContentSnapshotPtr snapshot = resourceRepository->GetContentSnapshot( EResourceType::Map );
+        const ContentCatalog& catalog = snapshot->catalog;
+
+        if ( snapshot->version != m_rowsVersion )
+        {
+            m_rowNames.clear();
+            m_rowSizes.clear();
+
+            for ( size_t index = 0; index < catalog.GetItemCount(); index++ )
+            {
+                const auto& item = catalog.GetItem( index );
+
+                gem::String itemName = item.getName();
+                itemName.fallbackToLegacyUnicode(); // needed to fix some Romanian legacy unicodes
+
+                m_rowNames.push_back( itemName.toStdString() );
+                m_rowSizes.push_back( FormatFileSize( item.getTotalSize() ).toStdString() );
+            }
+
+            m_rowsVersion = snapshot->version;
+        }
 
         ImGui::SetNextWindowBgAlpha( 0.8f );
 
@@ -60,6 +82,91 @@ void MapsView::Render()
         static const char* contentStoreFilter[5] = { "All", "Downloaded", "Not downloaded", "In progress", "Paused" };
         m_parentWindow->Combo( "##filtermapscombo", contentStoreFilter, IM_ARRAYSIZE( contentStoreFilter ), m_mapFilterIndex, []() {} );
 
+        StorageUsage storageUsage = resourceRepository->GetStorageUsage();
+
+        std::string storageText = "Storage: " + FormatFileSize( storageUsage.usedBytes ).toStdString();
+        if (storageUsage.quotaBytes > 0)
+            storageText += " of " + FormatFileSize( storageUsage.quotaBytes ).toStdString();
+        storageText += gem::String::formatString( u" (%d maps)", int( storageUsage.mapCount ) ).toStdString();
+
+        ImGui::TextUnformatted( storageText.c_str() );
+
+        BulkDownloadProgress bulkProgress;
+        if (m_bulkDownloadId != 0 && resourceRepository->GetBulkDownloadProgress( m_bulkDownloadId, bulkProgress ))
+        {
+            std::string progressText = gem::String::formatString( u"%d/%d maps, ", int( bulkProgress.completedCount ), int( bulkProgress.itemCount ) ).toStdString()
+                + FormatFileSize( bulkProgress.downloadedBytes ).toStdString() + " / " + FormatFileSize( bulkProgress.totalBytes ).toStdString()
+                + ", " + FormatFileSize( gem::LargeInteger( bulkProgress.bytesPerSecond ) ).toStdString() + "/s";
+
+            if (bulkProgress.etaSeconds >= 0)
+                progressText += gem::String::formatString( u", %d:%02d left", int( bulkProgress.etaSeconds ) / 60, int( bulkProgress.etaSeconds ) % 60 ).toStdString();
+
+            float fraction = bulkProgress.totalBytes > 0 ? float( double( bulkProgress.downloadedBytes ) / bulkProgress.totalBytes ) : 0.f;
+            ImGui::ProgressBar( fraction, ImVec2( ImGui::GetWindowWidth() - SCROLL_BAR_SIZE - DPI( 100 ), 0 ), progressText.c_str() );
+
+            ImGui::SameLine();
+            if (ImGui::Button( "Cancel##bulkdownload" ))
+                resourceRepository->CancelBulkDownload( m_bulkDownloadId );
+        }
+        else
+        {
+            m_bulkDownloadId = 0;
+
+            ImGui::BeginDisabled( !m_viewModel->IsConnected() );
+
+            // the listed maps (current filter) as a single download, confirmed first with the size
+            // to download (the unfiltered list is the whole world)
+            if (ImGui::Button( "Download listed maps" ))
+            {
+                std::vector<gem::LargeInteger> itemIds;
+                gem::LargeInteger downloadBytes = 0;
+
+                auto addRow = [&]( size_t rowIndex )
+                {
+                    if (catalog.GetItemState( rowIndex ) == EItemState::Completed)
+                        return;
+
+                    const auto& item = catalog.GetItem( rowIndex );
+
+                    itemIds.push_back( item.getId() );
+                    downloadBytes += item.getTotalSize();
+                };
+
+                if (m_mapFilterIndex == 0)
+                {
+                    for (size_t rowIndex = 0; rowIndex < catalog.GetItemCount(); rowIndex++)
+                        addRow( rowIndex );
+                }
+                else
+                {
+                    for (auto rowIndex : catalog.GetItemsByState( EItemState( m_mapFilterIndex ) ))
+                        addRow( rowIndex );
+                }
+
+                if (itemIds.empty())
+                {
+                    m_parentWindow->ShowMessage( "Info", "The listed maps are already downloaded." );
+                }
+                else
+                {
+                    auto yesFunc = [this, resourceRepository, itemIds]() { m_bulkDownloadId = resourceRepository->DownloadItems( itemIds ); };
+                    auto noFunc = ButtonAction();
+
+                    ButtonActionItemList items = {
+                        { "Yes", yesFunc },
+                        { "No", noFunc }
+                    };
+
+                    std::string question = gem::String::formatString( u"Download %d maps, ", int( itemIds.size() ) ).toStdString()
+                        + FormatFileSize( downloadBytes ).toStdString() + "?";
+
+                    m_parentWindow->ShowMessage( "Question", question.c_str(), items );
+                }
+            }
+
+            ImGui::EndDisabled();
+        }
+
         if (ImGui::BeginTable( "##table_maps", 3, ImGuiTableFlags_ScrollY ))
         {
             static float COLUMN2_SIZE = 0;
@@ -76,30 +183,29 @@ void MapsView::Render()
 
             ImGui::TableHeadersRow();
 
-            for (auto item : contentStoreItems)
+            auto renderRow = [&]( size_t rowIndex )
             {
-                auto itemState = resourceRepository->GetItemState( item );
-
-                if (m_mapFilterIndex != 0 && m_mapFilterIndex != (int)itemState)
-                    continue;
+                const auto& snapshotItem = catalog.GetItem( rowIndex );
+                auto itemState = catalog.GetItemState( rowIndex );
 
-                gem::String itemName = item.getName();
-                itemName.fallbackToLegacyUnicode(); // needed to fix some Romanian legacy unicodes
+                // the download progress is the only live part of the row (pushed by the repository)
+                std::string itemName = m_rowNames[rowIndex];
 
                 if (itemState == EItemState::Paused)
-                    itemName = gem::String::formatString( u"[PAUSED %d%%] %s", item.getDownloadProgress(), itemName );
+                    itemName = gem::String::formatString( u"[PAUSED %d%%] ", m_viewModel->GetDownloadProgress( snapshotItem ) ).toStdString() + itemName;
 
                 if (itemState == EItemState::InProgress)
-                    itemName = gem::String::formatString( u"[%02d%%] %s", item.getDownloadProgress(), itemName );
+                    itemName = gem::String::formatString( u"[%02d%%] ", m_viewModel->GetDownloadProgress( snapshotItem ) ).toStdString() + itemName;
 
                 ImGui::TableNextRow();
 
                 ImGui::TableSetColumnIndex( 0 );
 
                 const ImVec2 COUNTRY_ICON_SIZE( DPI( 20 ), DPI( 20 ) );
-                gem::String countryCode = item.getCountryCodes()[0];
-                unsigned int textureId = textureRepository->GetTexture( resourceRepository->GetFlagImage( countryCode ), COUNTRY_ICON_SIZE.x, COUNTRY_ICON_SIZE.y );
-                ImGui::Image( (void*)textureId, COUNTRY_ICON_SIZE );
+                gem::String countryCode = snapshotItem.getCountryCodes()[0];
+                TextureRegion flag = textureRepository->GetFlagTexture( countryCode, COUNTRY_ICON_SIZE.x, COUNTRY_ICON_SIZE.y );
+                if (flag.textureId != INVALID_TEXTURE_ID)
+                    ImGui::Image( (void*)flag.textureId, COUNTRY_ICON_SIZE, ImVec2( flag.u0, flag.v0 ), ImVec2( flag.u1, flag.v1 ) );
 
                 ImGui::TableSetColumnIndex( 1 );
 
@@ -111,8 +217,12 @@ void MapsView::Render()
                     ImGui::PushStyleColor( ImGuiCol_Button, ImGuiColor_Black );
                     ImGui::BeginDisabled( !m_viewModel->IsConnected() && itemState == EItemState::Paused );
 
-                    if (ImGui::Button( itemName.toStdString().c_str() ))
-                        resourceRepository->DownloadAsync( item );
+                    if (ImGui::Button( itemName.c_str() ))
+                    {
+                        gem::ContentStoreItem item = snapshotItem;
+                        if ( resourceRepository->DownloadAsync( item ) == EEnqueueResult::Refused )
+                            m_parentWindow->ShowMessage( "Error", "The map could not be downloaded (storage quota or download error)." );
+                    }
 
                     ImGui::EndDisabled();
                     ImGui::PopStyleColor();
@@ -124,7 +234,7 @@ void MapsView::Render()
                     ImGui::PushStyleColor( ImGuiCol_Text, ImGuiColor_Green );
                     ImGui::BeginDisabled( true );
 
-                    ImGui::Button( itemName.toStdString().c_str() );
+                    ImGui::Button( itemName.c_str() );
 
                     ImGui::EndDisabled();
                     ImGui::PopStyleColor();
@@ -135,8 +245,11 @@ void MapsView::Render()
                 {
                     ImGui::PushStyleColor( ImGuiCol_Button, ImGuiColor_Black );
 
-                    if (ImGui::Button( itemName.toStdString().c_str() ))
-                        item.pauseDownload();
+                    if (ImGui::Button( itemName.c_str() ))
+                    {
+                        gem::ContentStoreItem item = snapshotItem;
+                        resourceRepository->PauseDownload( item );
+                    }
 
                     ImGui::PopStyleColor();
                     break;
@@ -145,7 +258,19 @@ void MapsView::Render()
 
                 ImGui::TableSetColumnIndex( 2 );
 
-                ImGui::TextUnformatted( FormatFileSize( item.getTotalSize() ).toStdString().c_str() );
+                ImGui::TextUnformatted( m_rowSizes[rowIndex].c_str() );
+            };
+
+            // the filtered rows come from the catalog state groups, not from a scan of the whole list
+            if (m_mapFilterIndex == 0)
+            {
+                for (size_t rowIndex = 0; rowIndex < catalog.GetItemCount(); rowIndex++)
+                    renderRow( rowIndex );
+            }
+            else
+            {
+                for (auto rowIndex : catalog.GetItemsByState( EItemState( m_mapFilterIndex ) ))
+                    renderRow( rowIndex );
             }
 
             ImGui::EndTable();
@@ -2,6 +2,11 @@
 
 #include "BaseView.h"
 
+#include "IResourceRepository.h"
+
+#include <string>
+#include <vector>
+
 class IMainWindow;
 class MapsViewModel;
 
@@ -23,4 +28,12 @@ private:
     MapsViewModel* m_viewModel;
 
     int m_mapFilterIndex;
+
+    // the "Download listed maps" job, 0 when none is running
+    BulkDownloadId m_bulkDownloadId;
+
+    // per row texts of the maps snapshot with this version (rebuilt when the snapshot changes)
+    size_t m_rowsVersion;
+    std::vector<std::string> m_rowNames;
+    std::vector<std::string> m_rowSizes;
 };
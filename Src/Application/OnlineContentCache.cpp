@@ -0,0 +1,130 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "OnlineContentCache.h"
+
+#include <fstream>
+#include <functional>
+#include <unordered_map>
+
+OnlineContentCache::OnlineContentCache()
+{
+
+}
+
+OnlineContentCache::~OnlineContentCache()
+{
+
+}
+
+void OnlineContentCache::Open( const std::string& filePath )
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    m_filePath = filePath;
+    m_lists.clear();
+
+    // per list a "content type, stamp, item count" line followed by an "item id, size" line per item
+    std::ifstream file( m_filePath );
+
+    int contentType;
+    size_t stamp, count;
+
+    while ( file >> contentType >> stamp >> count )
+    {
+        StoredList list;
+        list.stamp = stamp;
+
+        OnlineContentEntry entry;
+        for ( size_t index = 0; index < count && file >> entry.itemId >> entry.sizeBytes; index++ )
+            list.entries.push_back( entry );
+
+        // a truncated file is not the last good list
+        if ( list.entries.size() != count || GetStamp( list.entries ) != stamp )
+            break;
+
+        m_lists[contentType] = std::move( list );
+    }
+}
+
+bool OnlineContentCache::GetStamp( int contentType, size_t& stamp ) const
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    auto it = m_lists.find( contentType );
+    if ( it == m_lists.end() )
+        return false;
+
+    stamp = it->second.stamp;
+    return true;
+}
+
+void OnlineContentCache::Store( int contentType, const OnlineContentEntries& entries )
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    StoredList& list = m_lists[contentType];
+    list.stamp = GetStamp( entries );
+    list.entries = entries;
+
+    Save();
+}
+
+size_t OnlineContentCache::GetStamp( const OnlineContentEntries& entries )
+{
+    size_t stamp = entries.size();
+
+    for ( const auto& entry : entries )
+    {
+        stamp = stamp * 31 + std::hash<gem::LargeInteger>()( entry.itemId );
+        stamp = stamp * 31 + std::hash<gem::LargeInteger>()( entry.sizeBytes );
+    }
+
+    return stamp;
+}
+
+OnlineContentDiff OnlineContentCache::Diff( const OnlineContentEntries& oldEntries, const OnlineContentEntries& newEntries )
+{
+    std::unordered_map<gem::LargeInteger, gem::LargeInteger> oldSizes;
+    for ( const auto& entry : oldEntries )
+        oldSizes[entry.itemId] = entry.sizeBytes;
+
+    OnlineContentDiff diff;
+    size_t keptCount = 0;
+
+    for ( size_t index = 0; index < newEntries.size(); index++ )
+    {
+        auto it = oldSizes.find( newEntries[index].itemId );
+
+        if ( it == oldSizes.end() || it->second != newEntries[index].sizeBytes )
+            diff.changedItems.push_back( index );
+
+        if ( it != oldSizes.end() )
+            keptCount++;
+    }
+
+    diff.removedCount = oldSizes.size() - keptCount;
+
+    return diff;
+}
+
+void OnlineContentCache::Save()
+{
+    if ( m_filePath.empty() )
+        return;
+
+    std::ofstream file( m_filePath, std::ios::trunc );
+
+    for ( const auto& it : m_lists )
+    {
+        file << it.first << ' ' << it.second.stamp << ' ' << it.second.entries.size() << '\n';
+
+        for ( const auto& entry : it.second.entries )
+            file << entry.itemId << ' ' << entry.sizeBytes << '\n';
+    }
+}
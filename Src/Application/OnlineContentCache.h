@@ -0,0 +1,95 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include "API/GEM_Types.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// An item of an online list, as far as its version is concerned
+struct OnlineContentEntry
+{
+    OnlineContentEntry( gem::LargeInteger itemId = 0, gem::LargeInteger sizeBytes = 0 )
+        : itemId( itemId )
+        , sizeBytes( sizeBytes )
+    {}
+
+    bool operator==( const OnlineContentEntry& other ) const
+    {
+        return itemId == other.itemId && sizeBytes == other.sizeBytes;
+    }
+
+    gem::LargeInteger itemId;
+    gem::LargeInteger sizeBytes;
+};
+
+using OnlineContentEntries = std::vector<OnlineContentEntry>;
+
+// Differences between two versions of a list
+struct OnlineContentDiff
+{
+    OnlineContentDiff()
+        : removedCount( 0 )
+    {}
+
+    bool IsEmpty() const
+    {
+        return changedItems.empty() && removedCount == 0;
+    }
+
+    std::vector<size_t> changedItems;   // indexes in the new list of the added / resized items, ascending
+    size_t removedCount;
+};
+
+// The last good online list of each content type (items ids & sizes) and its version stamp. The
+// file is rewritten on each change, so that after a restart the list cached by the SDK can be
+// recognized as the last good one and served before the store confirms it.
+class OnlineContentCache
+{
+public:
+    OnlineContentCache();
+    ~OnlineContentCache();
+
+    // loads the lists saved in the file
+    void Open( const std::string& filePath );
+
+    // false if no list was stored for the content type
+    bool GetStamp( int contentType, size_t& stamp ) const;
+
+    void Store( int contentType, const OnlineContentEntries& entries );
+
+    // identifies the version of a list (items ids & sizes, in order)
+    static size_t GetStamp( const OnlineContentEntries& entries );
+
+    static OnlineContentDiff Diff( const OnlineContentEntries& oldEntries, const OnlineContentEntries& newEntries );
+
+private:
+    // lock held
+    void Save();
+
+private:
+    std::string m_filePath;
+
+    struct StoredList
+    {
+        StoredList()
+            : stamp( 0 )
+        {}
+
+        size_t stamp;
+        OnlineContentEntries entries;
+    };
+
+    std::map<int, StoredList> m_lists;
+
+    mutable std::mutex m_sync;
+};
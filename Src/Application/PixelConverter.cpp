@@ -0,0 +1,414 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "PixelConverter.h"
+
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __x86_64__ ) || defined( __i386__ )
+#define PIXEL_CONVERTER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PIXEL_CONVERTER_AVX2
+#else
+#define PIXEL_CONVERTER_AVX2 __attribute__( ( target( "avx2" ) ) )
+#endif
+#endif
+
+//
+// scalar
+//
+
+static inline uint8_t Premultiply( uint32_t c, uint32_t a )
+{
+    // exact round( c * a / 255 )
+    uint32_t t = c * a + 128;
+    return uint8_t( ( t + ( t >> 8 ) ) >> 8 );
+}
+
+static inline uint8_t Unpremultiply( uint32_t c, float scale )
+{
+    return uint8_t( std::min( 255.f, float( c ) * scale + 0.5f ) );
+}
+
+static void SwizzleAbgrRgbaScalar( uint8_t* p, size_t count )
+{
+    for ( size_t i = 0; i < count; i++, p += 4 )
+    {
+        std::swap( p[0], p[3] );
+        std::swap( p[1], p[2] );
+    }
+}
+
+static void PremultiplyAlphaScalar( uint8_t* p, size_t count )
+{
+    for ( size_t i = 0; i < count; i++, p += 4 )
+    {
+        uint32_t a = p[3];
+        p[0] = Premultiply( p[0], a );
+        p[1] = Premultiply( p[1], a );
+        p[2] = Premultiply( p[2], a );
+    }
+}
+
+static void UnpremultiplyAlphaScalar( uint8_t* p, size_t count )
+{
+    for ( size_t i = 0; i < count; i++, p += 4 )
+    {
+        float scale = p[3] ? 255.f / p[3] : 0.f;
+        p[0] = Unpremultiply( p[0], scale );
+        p[1] = Unpremultiply( p[1], scale );
+        p[2] = Unpremultiply( p[2], scale );
+    }
+}
+
+static void RgbaToRgb565Scalar( const uint8_t* src, uint16_t* dst, size_t count )
+{
+    for ( size_t i = 0; i < count; i++, src += 4 )
+        dst[i] = uint16_t( ( ( src[0] & 0xF8 ) << 8 ) | ( ( src[1] & 0xFC ) << 3 ) | ( src[2] >> 3 ) );
+}
+
+#ifdef PIXEL_CONVERTER_X86
+
+//
+// SSE2 (4 pixels per register)
+//
+
+static inline __m128i PremultiplySSE2( __m128i c, __m128i alphaMask, __m128i opaque, __m128i half )
+{
+    // broadcast the alpha of each pixel, 255 in the alpha lane so that alpha is kept
+    __m128i a = _mm_shufflehi_epi16( _mm_shufflelo_epi16( c, _MM_SHUFFLE( 3, 3, 3, 3 ) ), _MM_SHUFFLE( 3, 3, 3, 3 ) );
+    a = _mm_or_si128( _mm_andnot_si128( alphaMask, a ), opaque );
+
+    __m128i t = _mm_add_epi16( _mm_mullo_epi16( c, a ), half );
+    return _mm_srli_epi16( _mm_add_epi16( t, _mm_srli_epi16( t, 8 ) ), 8 );
+}
+
+static size_t SwizzleAbgrRgbaSSE2( uint8_t* p, size_t count )
+{
+    const __m128i mask = _mm_set1_epi32( 0x00FF00FF );
+
+    size_t i = 0;
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        __m128i v = _mm_loadu_si128( (const __m128i*)( p + i * 4 ) );
+
+        // swap bytes inside the 16 bit halves, then swap the halves
+        v = _mm_or_si128( _mm_and_si128( _mm_srli_epi16( v, 8 ), mask ), _mm_slli_epi16( _mm_and_si128( v, mask ), 8 ) );
+        v = _mm_shufflehi_epi16( _mm_shufflelo_epi16( v, _MM_SHUFFLE( 2, 3, 0, 1 ) ), _MM_SHUFFLE( 2, 3, 0, 1 ) );
+
+        _mm_storeu_si128( (__m128i*)( p + i * 4 ), v );
+    }
+
+    return i;
+}
+
+static size_t PremultiplyAlphaSSE2( uint8_t* p, size_t count )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set_epi16( -1, 0, 0, 0, -1, 0, 0, 0 );
+    const __m128i opaque = _mm_set_epi16( 255, 0, 0, 0, 255, 0, 0, 0 );
+    const __m128i half = _mm_set1_epi16( 128 );
+
+    size_t i = 0;
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        __m128i v = _mm_loadu_si128( (const __m128i*)( p + i * 4 ) );
+
+        __m128i lo = PremultiplySSE2( _mm_unpacklo_epi8( v, zero ), alphaMask, opaque, half );
+        __m128i hi = PremultiplySSE2( _mm_unpackhi_epi8( v, zero ), alphaMask, opaque, half );
+
+        _mm_storeu_si128( (__m128i*)( p + i * 4 ), _mm_packus_epi16( lo, hi ) );
+    }
+
+    return i;
+}
+
+static inline __m128i UnpremultiplySSE2( __m128i c )
+{
+    const __m128 max = _mm_set1_ps( 255.f );
+    const __m128 half = _mm_set1_ps( 0.5f );
+    const __m128 alphaMask = _mm_castsi128_ps( _mm_set_epi32( -1, 0, 0, 0 ) );
+
+    __m128 f = _mm_cvtepi32_ps( c );
+    __m128 a = _mm_shuffle_ps( f, f, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+
+    // 255 / a, 0 when a == 0 (the division result is masked out)
+    __m128 scale = _mm_and_ps( _mm_div_ps( max, a ), _mm_cmpgt_ps( a, _mm_setzero_ps() ) );
+    __m128 r = _mm_min_ps( max, _mm_add_ps( _mm_mul_ps( f, scale ), half ) );
+
+    // keep alpha as it is
+    r = _mm_or_ps( _mm_andnot_ps( alphaMask, r ), _mm_and_ps( alphaMask, f ) );
+
+    return _mm_cvttps_epi32( r );
+}
+
+static size_t UnpremultiplyAlphaSSE2( uint8_t* p, size_t count )
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        __m128i v = _mm_loadu_si128( (const __m128i*)( p + i * 4 ) );
+        __m128i lo = _mm_unpacklo_epi8( v, zero );
+        __m128i hi = _mm_unpackhi_epi8( v, zero );
+
+        __m128i p0 = UnpremultiplySSE2( _mm_unpacklo_epi16( lo, zero ) );
+        __m128i p1 = UnpremultiplySSE2( _mm_unpackhi_epi16( lo, zero ) );
+        __m128i p2 = UnpremultiplySSE2( _mm_unpacklo_epi16( hi, zero ) );
+        __m128i p3 = UnpremultiplySSE2( _mm_unpackhi_epi16( hi, zero ) );
+
+        __m128i r = _mm_packus_epi16( _mm_packs_epi32( p0, p1 ), _mm_packs_epi32( p2, p3 ) );
+        _mm_storeu_si128( (__m128i*)( p + i * 4 ), r );
+    }
+
+    return i;
+}
+
+static inline __m128i Rgb565SSE2( __m128i v )
+{
+    __m128i r = _mm_slli_epi32( _mm_and_si128( v, _mm_set1_epi32( 0xF8 ) ), 8 );
+    __m128i g = _mm_and_si128( _mm_srli_epi32( v, 5 ), _mm_set1_epi32( 0x7E0 ) );
+    __m128i b = _mm_and_si128( _mm_srli_epi32( v, 19 ), _mm_set1_epi32( 0x1F ) );
+
+    // sign extend the 16 bit result, so that the signed saturating pack keeps it as it is
+    return _mm_srai_epi32( _mm_slli_epi32( _mm_or_si128( _mm_or_si128( r, g ), b ), 16 ), 16 );
+}
+
+static size_t RgbaToRgb565SSE2( const uint8_t* src, uint16_t* dst, size_t count )
+{
+    size_t i = 0;
+    for ( ; i + 8 <= count; i += 8 )
+    {
+        // both loads happen before the store, so converting in place is fine
+        __m128i lo = Rgb565SSE2( _mm_loadu_si128( (const __m128i*)( src + i * 4 ) ) );
+        __m128i hi = Rgb565SSE2( _mm_loadu_si128( (const __m128i*)( src + i * 4 + 16 ) ) );
+
+        _mm_storeu_si128( (__m128i*)( dst + i ), _mm_packs_epi32( lo, hi ) );
+    }
+
+    return i;
+}
+
+//
+// AVX2 (8 pixels per register)
+//
+
+PIXEL_CONVERTER_AVX2 static inline __m256i PremultiplyAVX2( __m256i c, __m256i alphaMask, __m256i opaque, __m256i half )
+{
+    __m256i a = _mm256_shufflehi_epi16( _mm256_shufflelo_epi16( c, _MM_SHUFFLE( 3, 3, 3, 3 ) ), _MM_SHUFFLE( 3, 3, 3, 3 ) );
+    a = _mm256_or_si256( _mm256_andnot_si256( alphaMask, a ), opaque );
+
+    __m256i t = _mm256_add_epi16( _mm256_mullo_epi16( c, a ), half );
+    return _mm256_srli_epi16( _mm256_add_epi16( t, _mm256_srli_epi16( t, 8 ) ), 8 );
+}
+
+PIXEL_CONVERTER_AVX2 static size_t SwizzleAbgrRgbaAVX2( uint8_t* p, size_t count )
+{
+    const __m256i shuffle = _mm256_setr_epi8(
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 );
+
+    size_t i = 0;
+    for ( ; i + 8 <= count; i += 8 )
+    {
+        __m256i v = _mm256_loadu_si256( (const __m256i*)( p + i * 4 ) );
+        _mm256_storeu_si256( (__m256i*)( p + i * 4 ), _mm256_shuffle_epi8( v, shuffle ) );
+    }
+
+    return i;
+}
+
+PIXEL_CONVERTER_AVX2 static size_t PremultiplyAlphaAVX2( uint8_t* p, size_t count )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_set_epi16( -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0 );
+    const __m256i opaque = _mm256_set_epi16( 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0 );
+    const __m256i half = _mm256_set1_epi16( 128 );
+
+    size_t i = 0;
+    for ( ; i + 8 <= count; i += 8 )
+    {
+        __m256i v = _mm256_loadu_si256( (const __m256i*)( p + i * 4 ) );
+
+        // unpack and pack both work inside the 128 bit lanes, so the pixel order is preserved
+        __m256i lo = PremultiplyAVX2( _mm256_unpacklo_epi8( v, zero ), alphaMask, opaque, half );
+        __m256i hi = PremultiplyAVX2( _mm256_unpackhi_epi8( v, zero ), alphaMask, opaque, half );
+
+        _mm256_storeu_si256( (__m256i*)( p + i * 4 ), _mm256_packus_epi16( lo, hi ) );
+    }
+
+    return i;
+}
+
+PIXEL_CONVERTER_AVX2 static inline __m256i Rgb565AVX2( __m256i v )
+{
+    __m256i r = _mm256_slli_epi32( _mm256_and_si256( v, _mm256_set1_epi32( 0xF8 ) ), 8 );
+    __m256i g = _mm256_and_si256( _mm256_srli_epi32( v, 5 ), _mm256_set1_epi32( 0x7E0 ) );
+    __m256i b = _mm256_and_si256( _mm256_srli_epi32( v, 19 ), _mm256_set1_epi32( 0x1F ) );
+
+    return _mm256_srai_epi32( _mm256_slli_epi32( _mm256_or_si256( _mm256_or_si256( r, g ), b ), 16 ), 16 );
+}
+
+PIXEL_CONVERTER_AVX2 static size_t RgbaToRgb565AVX2( const uint8_t* src, uint16_t* dst, size_t count )
+{
+    size_t i = 0;
+    for ( ; i + 16 <= count; i += 16 )
+    {
+        __m256i lo = Rgb565AVX2( _mm256_loadu_si256( (const __m256i*)( src + i * 4 ) ) );
+        __m256i hi = Rgb565AVX2( _mm256_loadu_si256( (const __m256i*)( src + i * 4 + 32 ) ) );
+
+        // the pack interleaves the 128 bit lanes: lo0 hi0 lo1 hi1 -> lo0 lo1 hi0 hi1
+        __m256i r = _mm256_permute4x64_epi64( _mm256_packs_epi32( lo, hi ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+        _mm256_storeu_si256( (__m256i*)( dst + i ), r );
+    }
+
+    return i;
+}
+
+static ESimdLevel DetectSimdLevel()
+{
+#ifdef _MSC_VER
+    int info[4];
+
+    __cpuid( info, 0 );
+    int maxLeaf = info[0];
+
+    __cpuid( info, 1 );
+    bool bSSE2 = ( info[3] & ( 1 << 26 ) ) != 0;
+    bool bOSXSave = ( info[2] & ( 1 << 27 ) ) != 0;
+    bool bAVX = ( info[2] & ( 1 << 28 ) ) != 0;
+
+    if ( !bSSE2 )
+        return ESimdLevel::Scalar;
+
+    // the OS must save the YMM registers
+    if ( maxLeaf >= 7 && bOSXSave && bAVX && ( _xgetbv( 0 ) & 6 ) == 6 )
+    {
+        __cpuidex( info, 7, 0 );
+        if ( info[1] & ( 1 << 5 ) )
+            return ESimdLevel::AVX2;
+    }
+
+    return ESimdLevel::SSE2;
+#else
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports( "avx2" ) )
+        return ESimdLevel::AVX2;
+
+    if ( __builtin_cpu_supports( "sse2" ) )
+        return ESimdLevel::SSE2;
+
+    return ESimdLevel::Scalar;
+#endif
+}
+
+#else
+
+static ESimdLevel DetectSimdLevel()
+{
+    return ESimdLevel::Scalar;
+}
+
+#endif
+
+static const ESimdLevel s_supportedLevel = DetectSimdLevel();
+static std::atomic<ESimdLevel> s_level( s_supportedLevel );
+
+//
+// PixelConverter
+//
+
+void PixelConverter::SwizzleAbgrRgba( void* pixels, size_t count )
+{
+    uint8_t* p = (uint8_t*)pixels;
+    size_t done = 0;
+
+#ifdef PIXEL_CONVERTER_X86
+    switch ( s_level.load() )
+    {
+    case ESimdLevel::AVX2: done = SwizzleAbgrRgbaAVX2( p, count ); break;
+    case ESimdLevel::SSE2: done = SwizzleAbgrRgbaSSE2( p, count ); break;
+    default: break;
+    }
+#endif
+
+    SwizzleAbgrRgbaScalar( p + done * 4, count - done );
+}
+
+void PixelConverter::PremultiplyAlpha( void* pixels, size_t count )
+{
+    uint8_t* p = (uint8_t*)pixels;
+    size_t done = 0;
+
+#ifdef PIXEL_CONVERTER_X86
+    switch ( s_level.load() )
+    {
+    case ESimdLevel::AVX2: done = PremultiplyAlphaAVX2( p, count ); break;
+    case ESimdLevel::SSE2: done = PremultiplyAlphaSSE2( p, count ); break;
+    default: break;
+    }
+#endif
+
+    PremultiplyAlphaScalar( p + done * 4, count - done );
+}
+
+void PixelConverter::UnpremultiplyAlpha( void* pixels, size_t count )
+{
+    uint8_t* p = (uint8_t*)pixels;
+    size_t done = 0;
+
+#ifdef PIXEL_CONVERTER_X86
+    // bound by the division, the SSE2 kernel is used for AVX2 as well
+    if ( s_level.load() != ESimdLevel::Scalar )
+        done = UnpremultiplyAlphaSSE2( p, count );
+#endif
+
+    UnpremultiplyAlphaScalar( p + done * 4, count - done );
+}
+
+void PixelConverter::RgbaToRgb565( const void* src, uint16_t* dst, size_t count )
+{
+    const uint8_t* s = (const uint8_t*)src;
+    size_t done = 0;
+
+#ifdef PIXEL_CONVERTER_X86
+    switch ( s_level.load() )
+    {
+    case ESimdLevel::AVX2: done = RgbaToRgb565AVX2( s, dst, count ); break;
+    case ESimdLevel::SSE2: done = RgbaToRgb565SSE2( s, dst, count ); break;
+    default: break;
+    }
+#endif
+
+    RgbaToRgb565Scalar( s + done * 4, dst + done, count - done );
+}
+
+ESimdLevel PixelConverter::GetSimdLevel()
+{
+    return s_level.load();
+}
+
+void PixelConverter::SetSimdLevel( ESimdLevel level )
+{
+    s_level = std::min( level, s_supportedLevel );
+}
+
+bool PixelConverter::IsLittleEndian()
+{
+    const uint32_t value = 1;
+    uint8_t first;
+    memcpy( &first, &value, 1 );
+
+    return first == 1;
+}
@@ -0,0 +1,45 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class ESimdLevel
+{
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// Pixel format conversion kernels applied to bitmaps before the GPU upload.
+// Vectorized (SSE2 / AVX2, picked at runtime from the CPU features) with a scalar fallback.
+// 'count' is in pixels; 32 bit pixels are in RGBA byte order unless stated otherwise.
+class PixelConverter
+{
+public:
+    // reverses the bytes of every pixel: ABGR <-> RGBA (in place, self inverse)
+    static void SwizzleAbgrRgba( void* pixels, size_t count );
+
+    // c = c * a / 255 for R, G, B
+    static void PremultiplyAlpha( void* pixels, size_t count );
+
+    // c = min( 255, c * 255 / a ) for R, G, B; fully transparent pixels become 0
+    static void UnpremultiplyAlpha( void* pixels, size_t count );
+
+    // 16 bit R5 G6 B5, alpha dropped; dst may be the same buffer as src
+    static void RgbaToRgb565( const void* src, uint16_t* dst, size_t count );
+
+    static ESimdLevel GetSimdLevel();
+
+    // forces a lower level (e.g. for benchmarks); a level not supported by the CPU is ignored
+    static void SetSimdLevel( ESimdLevel level );
+
+    static bool IsLittleEndian();
+};
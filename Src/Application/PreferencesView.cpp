@@ -3,6 +3,9 @@
 #include "PreferencesViewModel.h"
 #include "IMainWindow.h"
 
+// the latency histograms export, in the cache dir
+static const char* const ROUTE_LATENCY_FILE = "RouteLatency.csv";
+
 PreferencesView::PreferencesView( IMainWindow* parent )
     : BaseView( parent )
     , m_viewModel( nullptr )
@@ -55,9 +58,93 @@ void PreferencesView::Render()
         ImGui::EndTable();
     }
 
+    RenderRouteLatency();
+
     m_parentWindow->EndView();
 }
 
+void PreferencesView::RenderRouteLatency()
+{
+    if ( !ImGui::CollapsingHeader( "Routing latency" ) )
+        return;
+
+    static const char* transportModes[] = { "Car", "Truck", "Bike", "Pedestrian", "Road bike", "Cross bike", "City bike", "Mountain bike" };
+
+    auto statsList = m_viewModel->GetRouteLatencyStats();
+
+    if ( statsList.empty() )
+        ImGui::TextUnformatted( "No route computed yet" );
+
+    if ( !statsList.empty() && ImGui::BeginTable( "##table_route_latency", 8, ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollX ) )
+    {
+        ImGui::TableSetupColumn( "Mode" );
+        ImGui::TableSetupColumn( "Waypoints" );
+        ImGui::TableSetupColumn( "Count" );
+        ImGui::TableSetupColumn( "Failed" );
+        ImGui::TableSetupColumn( "p50 ms" );
+        ImGui::TableSetupColumn( "p95 ms" );
+        ImGui::TableSetupColumn( "p99 ms" );
+        ImGui::TableSetupColumn( "Max ms" );
+        ImGui::TableHeadersRow();
+
+        for ( const auto& stats : statsList )
+        {
+            ImGui::TableNextRow();
+
+            int modeIndex = int( stats.mode );
+
+            ImGui::TableSetColumnIndex( 0 );
+            ImGui::TextUnformatted( modeIndex >= 0 && modeIndex < IM_ARRAYSIZE( transportModes ) ? transportModes[modeIndex] : "?" );
+
+            ImGui::TableSetColumnIndex( 1 );
+            if ( stats.maxWaypoints == 0 )
+                ImGui::Text( "%d+", int( stats.minWaypoints ) );
+            else
+                ImGui::Text( "%d-%d", int( stats.minWaypoints ), int( stats.maxWaypoints ) );
+
+            ImGui::TableSetColumnIndex( 2 );
+            ImGui::Text( "%d", int( stats.count ) );
+
+            ImGui::TableSetColumnIndex( 3 );
+            ImGui::Text( "%d", int( stats.failedCount ) );
+
+            ImGui::TableSetColumnIndex( 4 );
+            ImGui::Text( "%.0f", stats.p50Ms );
+
+            ImGui::TableSetColumnIndex( 5 );
+            ImGui::Text( "%.0f", stats.p95Ms );
+
+            ImGui::TableSetColumnIndex( 6 );
+            ImGui::Text( "%.0f", stats.p99Ms );
+
+            ImGui::TableSetColumnIndex( 7 );
+            ImGui::Text( "%.0f", stats.maxMs );
+        }
+
+        ImGui::EndTable();
+    }
+
+    if ( ImGui::Button( "Export CSV##route_latency" ) )
+    {
+        std::string filePath = m_viewModel->ExportRouteLatency( ROUTE_LATENCY_FILE );
+
+        m_latencyExportStatus = !filePath.empty()
+            ? "Saved to " + filePath
+            : std::string( "Could not write " ) + ROUTE_LATENCY_FILE;
+    }
+
+    ImGui::SameLine();
+
+    if ( ImGui::Button( "Clear##route_latency" ) )
+    {
+        m_viewModel->ClearRouteLatencyStats();
+        m_latencyExportStatus.clear();
+    }
+
+    if ( !m_latencyExportStatus.empty() )
+        ImGui::TextUnformatted( m_latencyExportStatus.c_str() );
+}
+
 void PreferencesView::OnEvent( EVmEvent event )
 {
     switch ( event )
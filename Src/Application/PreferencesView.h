@@ -2,6 +2,8 @@
 
 #include "BaseView.h"
 
+#include <string>
+
 class IMainWindow;
 class PreferencesViewModel;
 
@@ -19,8 +21,14 @@ public:
     // IViewModelListener methods
     void OnEvent( EVmEvent event ) override;
 
+private:
+    // route computation latencies, by transport mode and waypoint count
+    void RenderRouteLatency();
+
 private:
     PreferencesViewModel* m_viewModel;
 
     bool m_bRenderFps;
+
+    std::string m_latencyExportStatus;
 };
@@ -2,6 +2,8 @@
 
 #include "PreferencesView.h"
 
+#include <fstream>
+
 PreferencesViewModel::PreferencesViewModel( IMapService* mapService, INavigationService* navigationService, IViewModelListener* listener )
     : BaseViewModel( mapService, navigationService, listener )
 {
@@ -21,3 +23,28 @@ void PreferencesViewModel::SetRenderFps( bool renderFps )
     if (m_mapView)
         m_mapView->SetRenderFps( renderFps );
 }
+
+std::vector<RouteLatencyStats> PreferencesViewModel::GetRouteLatencyStats() const
+{
+    return m_mapService->GetRouteLatencyStats();
+}
+
+std::string PreferencesViewModel::ExportRouteLatency( const std::string& fileName ) const
+{
+    std::string filePath = m_mapService->GetCacheFilePath( fileName );
+    if ( filePath.empty() )
+        return std::string();
+
+    std::ofstream file( filePath, std::ios::trunc );
+    if ( !file )
+        return std::string();
+
+    file << m_mapService->GetRouteLatencyCsv();
+
+    return file ? filePath : std::string();
+}
+
+void PreferencesViewModel::ClearRouteLatencyStats()
+{
+    m_mapService->ClearRouteLatencyStats();
+}
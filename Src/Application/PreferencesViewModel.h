@@ -12,4 +12,10 @@ public:
     // specific methods
     bool IsRenderFps() const;
     void SetRenderFps( bool renderFps );
+
+    // Diagnostics
+    std::vector<RouteLatencyStats> GetRouteLatencyStats() const;
+    // written in the cache dir, returns the file path (empty if the file can't be written)
+    std::string ExportRouteLatency( const std::string& fileName ) const;
+    void ClearRouteLatencyStats();
 };
@@ -9,43 +9,96 @@
 #include "ResourceRepository.h"
 
 #include "ProgressListenerImpl.h"
+#include "SDKUtils.h"
 
 #include <API/GEM_Debug.h>
-#include <API/GEM_MapDetails.h>
 
 #include <functional>
 
-using ContentStoreCompleteFunc = std::function<void( int, const gem::LargeInteger )>;
+// item states are rechecked this often while downloads are running (their status changes are not all notified)
+const std::chrono::milliseconds ITEM_STATES_CHECK_INTERVAL( 500 );
 
-class ContentStoreItemListener : public gem::IProgressListener
+// the progress of the bulk downloads is recomputed this often
+const std::chrono::milliseconds BULK_PROGRESS_INTERVAL( 500 );
+
+// the staged updates are applied once updates could be applied for this long
+const std::chrono::seconds UPDATE_APPLY_IDLE_DELAY( 3 );
+
+// apply reports kept
+const size_t MAX_UPDATE_APPLY_REPORTS = 16;
+
+// below the texture renders, which share the worker pool
+const int UPDATE_APPLY_PRIORITY = -1;
+
+// in the SDK cache dir
+static const char* const STORAGE_USAGE_FILE_NAME = "MapUsage.txt";
+static const char* const ONLINE_CONTENT_FILE_NAME = "OnlineContent.txt";
+
+// progress events per second, for each item / update
+const double DEFAULT_PROGRESS_EVENTS_RATE = 4;
+
+//
+// ContentStoreBackend
+//
+
+gem::ContentStoreItemList ContentStoreBackend::GetLocalContentList( gem::EContentType type )
 {
-public:
-    ContentStoreItemListener( ContentStoreCompleteFunc func, gem::LargeInteger id )
-        : m_func( func )
-        , m_id( id )
-    {
-    }
+    return gem::ContentStore().getLocalContentList( type );
+}
 
-private:
-    void notifyStart( bool hasProgress ) override {}
-    void notifyComplete( int reason, gem::String ) override
-    {
-        m_func( reason, m_id );
-    }
+std::pair<gem::ContentStoreItemList, bool> ContentStoreBackend::GetStoreContentList( gem::EContentType type )
+{
+    return gem::ContentStore().getStoreContentList( type );
+}
+
+void ContentStoreBackend::AsyncGetStoreContentList( gem::EContentType type, gem::StrongPointer<gem::IProgressListener> listener )
+{
+    gem::ContentStore().asyncGetStoreContentList( type, listener );
+}
 
-private:
-    ContentStoreCompleteFunc m_func;
-    gem::LargeInteger m_id;
-};
+gem::StrongPointer<gem::ContentUpdater> ContentStoreBackend::CreateContentUpdater( gem::EContentType type )
+{
+    return gem::ContentStore().createContentUpdater( type ).first;
+}
+
+//
+// ResourceRepository
+//
 
-ResourceRepository::ResourceRepository()
-    : m_bConnected( false )
+ResourceRepository::ResourceRepository( WorkerPool* workerPool, const std::string& cachePath /* = std::string() */, CountryMetadataPtr countries /* = std::make_shared<CountryMetadata>() */,
+    std::unique_ptr<IContentStoreBackend> contentStore /* = std::make_unique<ContentStoreBackend>() */ )
+    : m_contentVersion( 0 )
+    , m_itemStatesCheckTime( std::chrono::steady_clock::now() )
+    , m_lastBulkDownloadId( 0 )
+    , m_contentStore( std::move( contentStore ) )
+    , m_canApplyUpdateTime( std::chrono::steady_clock::now() )
+    , m_bApplyingUpdates( false )
+    , m_bClosing( false )
+    , m_bQueuePausedForApply( false )
+    , m_workerPool( workerPool )
     , m_bCanApplyMapUpdate ( true )
+    , m_countries( countries )
 {
+    m_contentSnapshots[EResourceType::Map];
+    m_contentSnapshots[EResourceType::Style];
+
+    // disconnected, nothing available yet
+    m_contentState.Replace( nullptr, std::make_shared<const ContentState>() );
+
     SetConnected( false );
 
+    SetProgressEventsRate( DEFAULT_PROGRESS_EVENTS_RATE );
+
+    if ( !cachePath.empty() )
+    {
+        m_storageManager.Open( SDKUtils::CombinePath( cachePath, STORAGE_USAGE_FILE_NAME ) );
+        m_onlineContentCache.Open( SDKUtils::CombinePath( cachePath, ONLINE_CONTENT_FILE_NAME ) );
+    }
+
+    m_downloadScheduler.SetProgressFunc( [this]( gem::LargeInteger itemId, int progress ) { QueueDownloadProgress( itemId, progress ); } );
+
     // handle map styles update
-    m_mapStylesUpdater = gem::ContentStore().createContentUpdater( STYLE_TYPE ).first;
+    m_mapStylesUpdater = m_contentStore->CreateContentUpdater( STYLE_TYPE );
 
     auto handleNewMapStylesStatus = [ &, upd = gem::WeakPointer<gem::ContentUpdater>(m_mapStylesUpdater) ]( int status )
     {
@@ -55,23 +108,16 @@ ResourceRepository::ResourceRepository()
         case gem::EContentUpdaterStatus::PartiallyReady:
         {
             if( auto updater = upd.lock() )
-            {
-                updater->apply();
-
-                UpdateOnlineResource( STYLE_TYPE );
-
-                for ( auto it : m_listeners )
-                    it->OnResourceUpdated( EResourceType::Style );
-            }
+                StageUpdate( EResourceType::Style, updater );
             break;
         }
         }
     };
 
-    m_mapStylesUpdateListener = gem::StrongPointerFactory<ContentUpdateListener>( handleNewMapStylesStatus );
+    m_mapStylesUpdateListener = gem::StrongPointerFactory<ContentUpdateListener>( handleNewMapStylesStatus, [this]( int progress ) { QueueUpdateProgress( EResourceType::Style, progress ); } );
 
     // handle maps update
-    m_mapUpdater = gem::ContentStore().createContentUpdater( MAP_TYPE ).first;
+    m_mapUpdater = m_contentStore->CreateContentUpdater( MAP_TYPE );
 
     auto handleNewMapStatus = [ &, upd = gem::WeakPointer<gem::ContentUpdater>( m_mapUpdater ) ](int status)
         {
@@ -81,35 +127,30 @@ ResourceRepository::ResourceRepository()
             case gem::EContentUpdaterStatus::PartiallyReady:
             {
                 if( auto updater = upd.lock() )
-                {
-                    if( m_bCanApplyMapUpdate )
-                    {
-                        updater->apply();
-
-                        UpdateOnlineResource( MAP_TYPE );
-
-                        for(auto it : m_listeners )
-                            it->OnResourceUpdated(EResourceType::Map);
-                    }
-                }
+                    StageUpdate( EResourceType::Map, updater );
                 break;
             }
             }
         };
 
-    m_mapUpdateListener = gem::StrongPointerFactory<ContentUpdateListener>( handleNewMapStatus );
-
-    FillCountriesIsoToImageUids();
+    m_mapUpdateListener = gem::StrongPointerFactory<ContentUpdateListener>( handleNewMapStatus, [this]( int progress ) { QueueUpdateProgress( EResourceType::Map, progress ); } );
 }
 
 ResourceRepository::~ResourceRepository()
 {
-    std::lock_guard<std::mutex> guard( m_contentUpdatersSync );
+    // a queued apply is skipped, a running one is waited for
+    {
+        std::lock_guard<std::mutex> guard( m_contentUpdatersSync );
+
+        m_bClosing = true;
+    }
 
-    for( auto it : m_downloads )
-        gem::ContentStore().cancel( it.second );
+    if ( m_updatesApplied.valid() )
+        m_updatesApplied.wait();
 
-    m_downloads.clear();
+    std::lock_guard<std::mutex> guard( m_contentUpdatersSync );
+
+    m_downloadScheduler.CancelAll();
 
     m_mapUpdateListener.reset();
     m_mapUpdater.reset();
@@ -162,28 +203,287 @@ gem::ContentStoreItemList ResourceRepository::GetStyles ()
     return GetContentStoreItems ( EResourceType::Style );
 }
 
-bool ResourceRepository::DownloadAsync( gem::ContentStoreItem& item )
+ContentSnapshotPtr ResourceRepository::GetContentSnapshot( EResourceType type )
 {
-    std::lock_guard<std::mutex> guard( m_contentUpdatersSync );
+    // a single atomic load while the snapshot is valid
+    return m_contentSnapshots.at( type ).Get( [&]()
+    {
+        gem::ContentStoreItemList items = GetContentStoreItems( type );
+
+        return std::make_shared<const ContentSnapshot>( ContentCatalog( items, GetItemStates( items ) ), ++m_contentVersion );
+    } );
+}
 
-    auto func = [&]( int reason, gem::LargeInteger itemId )
+EEnqueueResult ResourceRepository::DownloadAsync( gem::ContentStoreItem& item, EDownloadPriority priority /* = EDownloadPriority::UserInitiated */ )
+{
+    ContentSnapshotPtr snapshot = GetContentSnapshot( EResourceType::Map );
+
+    size_t index = snapshot->catalog.FindItem( item.getId() );
+    if ( index != size_t( -1 ) && !MakeStorageRoom( GetRequiredStorage( snapshot->catalog, index ) ) )
+        return EEnqueueResult::Refused;
+
+    auto func = [this]( gem::LargeInteger itemId, int reason )
     {
-        m_downloads.erase( itemId );
+        OnItemDownloaded( itemId, reason );
     };
 
-    gem::StrongPointer<ContentStoreItemListener> listenerPtr = gem::StrongPointerFactory<ContentStoreItemListener>( func, item.getId() );
+    // a start failure is also reported through func
+    EEnqueueResult result = m_downloadScheduler.Enqueue( item, priority, func );
+
+    InvalidateContentSnapshots();
+    return result;
+}
+
+void ResourceRepository::PauseDownload( gem::ContentStoreItem& item )
+{
+    m_downloadScheduler.Pause( item.getId() );
+
+    QueueDownloadFinished( item.getId(), gem::error::KCancel );
+
+    InvalidateContentSnapshots();
+}
+
+void ResourceRepository::PauseDownloadQueue()
+{
+    m_downloadScheduler.PauseQueue();
+
+    InvalidateContentSnapshots();
+}
+
+void ResourceRepository::ResumeDownloadQueue()
+{
+    m_downloadScheduler.ResumeQueue();
+
+    InvalidateContentSnapshots();
+}
+
+bool ResourceRepository::IsDownloadQueuePaused() const
+{
+    return m_downloadScheduler.IsQueuePaused();
+}
+
+BulkDownloadId ResourceRepository::DownloadItems( const std::vector<gem::LargeInteger>& itemIds, BulkDownloadCompleteFunc completeFunc /* = nullptr */, EDownloadPriority priority /* = EDownloadPriority::UserInitiated */ )
+{
+    ContentSnapshotPtr snapshot = GetContentSnapshot( EResourceType::Map );
+    const ContentCatalog& catalog = snapshot->catalog;
+
+    BulkDownload download;
+    gem::LargeInteger requiredBytes = 0;
+
+    for ( auto itemId : itemIds )
+    {
+        size_t index = catalog.FindItem( itemId );
+        if ( index == size_t( -1 ) || catalog.GetItemState( index ) == EItemState::Completed )
+            continue;
+
+        const auto& item = catalog.GetItem( index );
+        requiredBytes += GetRequiredStorage( catalog, index );
+
+        // paused items resume from where they were
+        download.pendingItems.push_back( item );
+        download.progress.totalBytes += item.getTotalSize();
+        download.progress.downloadedBytes += item.getTotalSize() * item.getDownloadProgress() / 100;
+    }
+
+    // all or nothing
+    if ( download.pendingItems.empty() || !MakeStorageRoom( requiredBytes ) )
+        return 0;
+
+    download.progress.itemCount = download.pendingItems.size();
+    download.progressTime = std::chrono::steady_clock::now();
+    download.completeFunc = completeFunc;
+
+    std::vector<gem::ContentStoreItem> items = download.pendingItems;
+    BulkDownloadId id;
+
+    {
+        std::lock_guard<std::mutex> guard( m_bulkDownloadsSync );
+
+        id = ++m_lastBulkDownloadId;
+        m_bulkDownloads[id] = std::move( download );
+    }
+
+    auto func = [this, id]( gem::LargeInteger itemId, int reason )
+    {
+        {
+            std::lock_guard<std::mutex> guard( m_bulkDownloadsSync );
+
+            auto it = m_bulkDownloads.find( id );
+            if ( it != m_bulkDownloads.end() )
+                it->second.itemResults[itemId] = reason;
+        }
+
+        OnItemDownloaded( itemId, reason );
+    };
+
+    for ( const auto& item : items )
+        m_downloadScheduler.Enqueue( item, priority, func );
+
+    InvalidateContentSnapshots();
+    return id;
+}
+
+BulkDownloadId ResourceRepository::DownloadCountries( const std::vector<gem::String>& isos, BulkDownloadCompleteFunc completeFunc /* = nullptr */, EDownloadPriority priority /* = EDownloadPriority::UserInitiated */ )
+{
+    ContentSnapshotPtr snapshot = GetContentSnapshot( EResourceType::Map );
+    const ContentCatalog& catalog = snapshot->catalog;
+
+    std::vector<gem::LargeInteger> itemIds;
 
-    if (item.asyncDownload( listenerPtr ) == gem::KNoError)
+    for ( const auto& iso : isos )
+        for ( auto index : catalog.GetItemsByIso( iso ) )
+            itemIds.push_back( catalog.GetItem( index ).getId() );
+
+    return DownloadItems( itemIds, completeFunc, priority );
+}
+
+bool ResourceRepository::GetBulkDownloadProgress( BulkDownloadId id, BulkDownloadProgress& progress ) const
+{
+    std::lock_guard<std::mutex> guard( m_bulkDownloadsSync );
+
+    auto it = m_bulkDownloads.find( id );
+    if ( it == m_bulkDownloads.end() )
+        return false;
+
+    progress = it->second.progress;
+    return true;
+}
+
+void ResourceRepository::CancelBulkDownload( BulkDownloadId id )
+{
+    std::vector<gem::ContentStoreItem> items;
+
+    {
+        std::lock_guard<std::mutex> guard( m_bulkDownloadsSync );
+
+        auto it = m_bulkDownloads.find( id );
+        if ( it == m_bulkDownloads.end() )
+            return;
+
+        items = it->second.pendingItems;
+    }
+
+    // the paused items are no longer scheduled, they are counted as canceled on the next update
+    for ( const auto& item : items )
+    {
+        m_downloadScheduler.Pause( item.getId() );
+
+        QueueDownloadFinished( item.getId(), gem::error::KCancel );
+    }
+
+    InvalidateContentSnapshots();
+}
+
+void ResourceRepository::SetProgressEventsRate( double eventsPerSecond )
+{
+    std::lock_guard<std::mutex> guard( m_progressEventsSync );
+
+    m_progressEventsInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( 1 / std::max( eventsPerSecond, 0.1 ) ) );
+}
+
+void ResourceRepository::SetStorageQuota( gem::LargeInteger quotaBytes )
+{
+    m_storageManager.SetQuota( quotaBytes );
+}
+
+StorageUsage ResourceRepository::GetStorageUsage()
+{
+    ContentSnapshotPtr snapshot = GetContentSnapshot( EResourceType::Map );
+
+    StorageUsage usage;
+    usage.usedBytes = StorageManager::GetUsedBytes( snapshot->catalog );
+    usage.quotaBytes = m_storageManager.GetQuota();
+    usage.mapCount = snapshot->catalog.GetItemsByState( EItemState::Completed ).size();
+
+    return usage;
+}
+
+void ResourceRepository::SetActiveCountries( const std::vector<gem::String>& isos )
+{
+    ContentSnapshotPtr snapshot = GetContentSnapshot( EResourceType::Map );
+
+    m_storageManager.MarkCountriesUsed( snapshot->catalog, isos );
+    m_storageManager.SetProtectedCountries( isos );
+}
+
+bool ResourceRepository::MakeStorageRoom( gem::LargeInteger requiredBytes )
+{
+    ContentSnapshotPtr snapshot = GetContentSnapshot( EResourceType::Map );
+    const ContentCatalog& catalog = snapshot->catalog;
+
+    std::vector<size_t> evictions;
+    if ( !m_storageManager.SelectEvictions( catalog, requiredBytes, evictions ) )
     {
-        m_downloads.insert( std::make_pair<>( gem::LargeInteger( item.getId() ), listenerPtr ) );
+        gem::Debug().log( gem::LogInfo, "ResourceRepository", __FUNCTION__, __FILE__, __LINE__, "Download of %lld bytes refused, over the storage quota", (long long)requiredBytes );
+        return false;
+    }
+
+    if ( evictions.empty() )
         return true;
+
+    for ( auto index : evictions )
+    {
+        gem::ContentStoreItem item = catalog.GetItem( index );
+
+        gem::Debug().log( gem::LogInfo, "ResourceRepository", __FUNCTION__, __FILE__, __LINE__, "Evict map %s", item.getName().toStdString().c_str() );
+
+        item.deleteContent();
+        m_storageManager.Forget( item.getId() );
     }
 
-    return false;
+    InvalidateContentSnapshots();
+    return true;
+}
+
+gem::LargeInteger ResourceRepository::GetRequiredStorage( const ContentCatalog& catalog, size_t index )
+{
+    switch ( catalog.GetItemState( index ) )
+    {
+    case EItemState::Completed:
+    case EItemState::InProgress:
+    case EItemState::Paused:
+        return 0;
+    default:
+        return catalog.GetItem( index ).getTotalSize();
+    }
+}
+
+void ResourceRepository::OnItemDownloaded( gem::LargeInteger itemId, int reason )
+{
+    // a new map counts as just used
+    if ( reason == gem::KNoError )
+        m_storageManager.MarkItemUsed( itemId );
+
+    QueueDownloadFinished( itemId, reason );
+
+    InvalidateContentSnapshots();
+}
+
+void ResourceRepository::SetDownloadLimits( size_t maxParallelDownloads, double maxBytesPerSecond )
+{
+    m_downloadScheduler.SetMaxParallelDownloads( maxParallelDownloads );
+    m_downloadScheduler.SetMaxBytesPerSecond( maxBytesPerSecond );
+}
+
+void ResourceRepository::Tick()
+{
+    m_downloadScheduler.Tick();
+
+    UpdateItemStates();
+
+    UpdateBulkDownloads();
+
+    DeliverProgressEvents();
+
+    ApplyStagedUpdates();
 }
 
 EItemState ResourceRepository::GetItemState( const gem::ContentStoreItem& item ) const
 {
+    // waiting for a download slot
+    if ( item.getStatus() != gem::EContentStoreItemStatus::CIS_Completed && m_downloadScheduler.IsScheduled( item.getId() ) )
+        return EItemState::InProgress;
+
     switch (item.getStatus())
     {
     case gem::EContentStoreItemStatus::CIS_Completed:
@@ -205,48 +505,199 @@ EItemState ResourceRepository::GetItemState( const gem::ContentStoreItem& item )
 
 bool ResourceRepository::IsMapUpdateRunning() const
 {
-    return m_mapUpdater->isStarted();
+    return m_mapUpdater && m_mapUpdater->isStarted();
 }
 
 void ResourceRepository::SetCanApplyMapUpdate( bool canApplyMapUpdate )
 {
+    std::lock_guard<std::mutex> guard( m_contentUpdatersSync );
+
+    // the idle window starts now
+    if ( canApplyMapUpdate && !m_bCanApplyMapUpdate )
+        m_canApplyUpdateTime = std::chrono::steady_clock::now();
+
     m_bCanApplyMapUpdate = canApplyMapUpdate;
 }
 
+bool ResourceRepository::HasStagedUpdates() const
+{
+    std::lock_guard<std::mutex> guard( m_contentUpdatersSync );
+
+    return !m_stagedUpdates.empty() || m_bApplyingUpdates;
+}
+
+std::vector<UpdateApplyReport> ResourceRepository::GetUpdateApplyReports() const
+{
+    std::lock_guard<std::mutex> guard( m_contentUpdatersSync );
+
+    return std::vector<UpdateApplyReport>( m_updateApplyReports.begin(), m_updateApplyReports.end() );
+}
+
+void ResourceRepository::StageUpdate( EResourceType type, const gem::StrongPointer<gem::ContentUpdater>& updater )
+{
+    std::lock_guard<std::mutex> guard( m_contentUpdatersSync );
+
+    gem::Debug().log( gem::LogInfo, "ResourceRepository", __FUNCTION__, __FILE__, __LINE__, "Update staged(%d)", int( type ) );
+
+    m_stagedUpdates[type] = updater;
+}
+
+void ResourceRepository::ApplyStagedUpdates()
+{
+    if ( m_updatesApplied.valid() )
+    {
+        if ( m_updatesApplied.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+            return;
+
+        m_updatesApplied = std::future<void>();
+
+        PublishAppliedUpdates();
+    }
+
+    StagedUpdates stagedUpdates;
+
+    {
+        std::lock_guard<std::mutex> guard( m_contentUpdatersSync );
+
+        if ( m_stagedUpdates.empty() || !m_bCanApplyMapUpdate || std::chrono::steady_clock::now() - m_canApplyUpdateTime < UPDATE_APPLY_IDLE_DELAY )
+            return;
+
+        stagedUpdates.swap( m_stagedUpdates );
+        m_bApplyingUpdates = true;
+    }
+
+    // no download starts while the data files are swapped (unless the queue was paused already)
+    if ( !m_downloadScheduler.IsQueuePaused() )
+    {
+        m_downloadScheduler.PauseQueue();
+        m_bQueuePausedForApply = true;
+    }
+
+    auto applyTask = std::make_shared<std::packaged_task<void()>>( [this, stagedUpdates]() { ApplyUpdates( stagedUpdates ); } );
+    m_updatesApplied = applyTask->get_future();
+
+    // a task dropped by the stopped pool leaves the future ready, with nothing applied
+    m_workerPool->Execute( [applyTask]() { ( *applyTask )(); }, UPDATE_APPLY_PRIORITY );
+}
+
+void ResourceRepository::ApplyUpdates( const StagedUpdates& stagedUpdates )
+{
+    for ( const auto& staged : stagedUpdates )
+    {
+        {
+            std::lock_guard<std::mutex> guard( m_contentUpdatersSync );
+
+            if ( m_bClosing )
+                return;
+        }
+
+        auto updater = staged.second.lock();
+        if ( !updater )
+            continue;
+
+        // verified again, the staged data may have been dropped meanwhile (e.g. update restarted)
+        auto status = updater->getStatus();
+        if ( status != gem::EContentUpdaterStatus::FullyReady && status != gem::EContentUpdaterStatus::PartiallyReady )
+        {
+            gem::Debug().log( gem::LogInfo, "ResourceRepository", __FUNCTION__, __FILE__, __LINE__, "Staged update(%d) no longer ready (%d)", int( staged.first ), int( status ) );
+            continue;
+        }
+
+        auto applyStart = std::chrono::steady_clock::now();
+        updater->apply();
+        double applySeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - applyStart ).count();
+
+        gem::Debug().log( gem::LogInfo, "ResourceRepository", __FUNCTION__, __FILE__, __LINE__, "Update applied(%d) in %.3lf s", int( staged.first ), applySeconds );
+
+        std::lock_guard<std::mutex> guard( m_contentUpdatersSync );
+
+        m_appliedUpdates.emplace_back( staged.first, applySeconds );
+    }
+}
+
+void ResourceRepository::PublishAppliedUpdates()
+{
+    std::vector<UpdateApplyReport> appliedUpdates;
+
+    {
+        std::lock_guard<std::mutex> guard( m_contentUpdatersSync );
+
+        appliedUpdates.swap( m_appliedUpdates );
+        m_bApplyingUpdates = false;
+
+        for ( const auto& applied : appliedUpdates )
+        {
+            m_updateApplyReports.push_back( applied );
+            if ( m_updateApplyReports.size() > MAX_UPDATE_APPLY_REPORTS )
+                m_updateApplyReports.pop_front();
+        }
+    }
+
+    if ( m_bQueuePausedForApply )
+    {
+        m_downloadScheduler.ResumeQueue();
+        m_bQueuePausedForApply = false;
+    }
+
+    for ( const auto& applied : appliedUpdates )
+    {
+        UpdateOnlineResource( applied.type == EResourceType::Map ? MAP_TYPE : STYLE_TYPE );
+
+        for ( auto it : m_listeners )
+            it->OnResourceUpdated( applied.type );
+    }
+
+    InvalidateContentSnapshots();
+}
+
 void ResourceRepository::UpdateMaps()
 {
-    m_mapUpdater->update( true, m_mapUpdateListener );
+    if ( m_mapUpdater )
+        m_mapUpdater->update( true, m_mapUpdateListener );
 }
 
 void ResourceRepository::UpdateStyles()
 {
-    m_mapStylesUpdater->update( true, m_mapStylesUpdateListener );
+    if ( m_mapStylesUpdater )
+        m_mapStylesUpdater->update( true, m_mapStylesUpdateListener );
 }
 
 void ResourceRepository::SetConnected( bool connected )
 {
     if ( connected )
     {
-        if ( !m_bConnected )
+        // checked in the same publication, a concurrent call doesn't connect twice
+        ContentStatePtr previous;
+        m_contentState.Modify( [&]( ContentState& state )
+        {
+            previous = m_contentState.Load();
+            state.bConnected = true;
+        } );
+
+        if ( !previous->bConnected )
         {
-            m_bConnected = connected;
-            UpdateOnlineContentStores();
+            // after the first connection the last good lists are served right away (no "Loading")
+            if ( previous->onlineContentStores.count( MAP_TYPE ) && previous->onlineContentStores.count( STYLE_TYPE ) )
+                RefreshOnlineContentStores();
+            else
+                UpdateOnlineContentStores();
         }
 
         ResumeExistingUpdates();
     }
     else
     {
-        m_bConnected = false;
+        m_contentState.Modify( []( ContentState& state ) { state.bConnected = false; } );
         UpdateOfflineContentStores();
     }
+
+    // online / offline lists
+    InvalidateContentSnapshots();
 }
 
 gem::Image ResourceRepository::GetFlagImage( const gem::String& iso )
 {
-	unsigned int imageId = GetFlagImageUid( iso );
-
-	return gem::Image( imageId );
+	return m_countries->GetFlagImage( iso );
 }
 
 gem::ContentStoreItemList ResourceRepository::GetContentStoreItems( EResourceType type )
@@ -263,18 +714,17 @@ gem::ContentStoreItemList ResourceRepository::GetContentStoreItems( EResourceTyp
         break;
     }
 
-    if ( contentType != gem::EContentType::CT_Unknown && GetContentTypeState( contentType ) == EResourceState::Available )
+    // state & lists from the same version
+    ContentStatePtr state = m_contentState.Load();
+
+    auto stateIt = state->contentTypesState.find( contentType );
+
+    if ( stateIt != state->contentTypesState.end() && stateIt->second == EResourceState::Available )
     {
-        if ( m_bConnected )
-        {
-            auto it = m_onlineContentStores.find( contentType );
-            return it == m_onlineContentStores.end() ? gem::ContentStoreItemList() : it->second;
-        }
-        else
-        {
-            auto it = m_offlineContentStores.find( contentType );
-            return it == m_offlineContentStores.end() ? gem::ContentStoreItemList() : it->second;
-        }
+        const auto& contentStores = state->bConnected ? state->onlineContentStores : state->offlineContentStores;
+
+        auto it = contentStores.find( contentType );
+        return it == contentStores.end() ? gem::ContentStoreItemList() : it->second;
     }
 
     return gem::ContentStoreItemList();
@@ -283,23 +733,31 @@ gem::ContentStoreItemList ResourceRepository::GetContentStoreItems( EResourceTyp
 void ResourceRepository::ResumeExistingUpdates()
 {
     // resume existing updates
-    if( m_mapStylesUpdater->getStatus() != gem::EContentUpdaterStatus::Idle )
+    if( m_mapStylesUpdater && m_mapStylesUpdater->getStatus() != gem::EContentUpdaterStatus::Idle )
         m_mapStylesUpdater->update( true, m_mapStylesUpdateListener );
 
-    if( m_mapUpdater->getStatus() != gem::EContentUpdaterStatus::Idle )
+    if( m_mapUpdater && m_mapUpdater->getStatus() != gem::EContentUpdaterStatus::Idle )
         m_mapUpdater->update( true, m_mapUpdateListener );
 
 }
 
 void ResourceRepository::UpdateOfflineContentStores()
 {
-    m_offlineContentStores.clear();
+    std::map<gem::EContentType, gem::ContentStoreItemList> offlineContentStores;
+
+    offlineContentStores.insert( std::make_pair<>( MAP_TYPE, m_contentStore->GetLocalContentList( MAP_TYPE ) ) );
+    offlineContentStores.insert( std::make_pair<>( STYLE_TYPE, m_contentStore->GetLocalContentList( STYLE_TYPE ) ) );
 
-    m_offlineContentStores.insert( std::make_pair<>( MAP_TYPE, gem::ContentStore().getLocalContentList( MAP_TYPE ) ) );
-    SetContentTypeState( MAP_TYPE, EResourceState::Available );
+    m_contentState.Modify( [&]( ContentState& state )
+    {
+        state.offlineContentStores = std::move( offlineContentStores );
+        state.contentTypesState[MAP_TYPE] = EResourceState::Available;
+        state.contentTypesState[STYLE_TYPE] = EResourceState::Available;
+    } );
 
-    m_offlineContentStores.insert( std::make_pair<>( STYLE_TYPE, gem::ContentStore().getLocalContentList( STYLE_TYPE ) ) );
-    SetContentTypeState( STYLE_TYPE, EResourceState::Available );
+    gem::Debug().log( gem::LogInfo, "ResourceRepository", __FUNCTION__, __FILE__, __LINE__, "Offline content stores available" );
+
+    InvalidateContentSnapshots();
 }
 
 void ResourceRepository::UpdateOnlineContentStores()
@@ -313,13 +771,60 @@ void ResourceRepository::UpdateOnlineContentStores()
     UpdateOnlineResource( MAP_TYPE );
 }
 
+void ResourceRepository::RefreshOnlineContentStores()
+{
+    gem::Debug().log( gem::LogInfo, "ResourceRepository", __FUNCTION__, __FILE__, __LINE__, "Refresh online content store" );
+
+    RefreshOnlineResource( STYLE_TYPE );
+    RefreshOnlineResource( MAP_TYPE );
+}
+
+void ResourceRepository::RefreshOnlineResource( gem::EContentType contentType )
+{
+    auto func = [this, contentType]( int reason, gem::String hint )
+    {
+        if( reason == gem::KNoError )
+            SetOnlineContentStore( contentType, m_contentStore->GetStoreContentList( contentType ).first );
+    };
+
+    auto progressListener = gem::StrongPointerFactory<ProgressListenerImpl>( func );
+    m_progressListeners[contentType] = progressListener;
+    m_contentStore->AsyncGetStoreContentList( contentType, progressListener );
+}
+
+bool ResourceRepository::IsLastOnlineContentStore( gem::EContentType contentType, const gem::ContentStoreItemList& items ) const
+{
+    size_t stamp;
+    if ( items.empty() || !m_onlineContentCache.GetStamp( int( contentType ), stamp ) )
+        return false;
+
+    return stamp == OnlineContentCache::GetStamp( GetOnlineContentEntries( items ) );
+}
+
+OnlineContentEntries ResourceRepository::GetOnlineContentEntries( const gem::ContentStoreItemList& items )
+{
+    OnlineContentEntries entries;
+    entries.reserve( items.size() );
+
+    for ( const auto& item : items )
+        entries.emplace_back( item.getId(), item.getTotalSize() );
+
+    return entries;
+}
+
 void ResourceRepository::UpdateOnlineResource( gem::EContentType contentType )
 {
-    auto res = gem::ContentStore().getStoreContentList( contentType );
+    auto res = m_contentStore->GetStoreContentList( contentType );
     if( res.second )
     {
-        m_onlineContentStores.insert( std::make_pair<>( contentType, res.first ) );
-        SetContentTypeState( contentType, EResourceState::Available );
+        // replaces the list on content updates
+        SetOnlineContentStore( contentType, res.first );
+    }
+    else if ( IsLastOnlineContentStore( contentType, res.first ) )
+    {
+        // the list kept by the SDK is the one served last time: no "Loading", the store is asked in the background
+        SetOnlineContentStore( contentType, res.first );
+        RefreshOnlineResource( contentType );
     }
     else
     {
@@ -329,25 +834,25 @@ void ResourceRepository::UpdateOnlineResource( gem::EContentType contentType )
         {
             if( reason == gem::KNoError )
             {
-                auto res = gem::ContentStore().getStoreContentList( contentType );
-
-                m_onlineContentStores[contentType] = res.first;
+                auto res = m_contentStore->GetStoreContentList( contentType );
 
-                SetContentTypeState( contentType, EResourceState::Available );
+                SetOnlineContentStore( contentType, res.first );
             }
         };
 
         auto progressListener = gem::StrongPointerFactory<ProgressListenerImpl>( func );
         m_progressListeners[contentType] = progressListener;
-        gem::ContentStore().asyncGetStoreContentList( contentType, progressListener );
+        m_contentStore->AsyncGetStoreContentList( contentType, progressListener );
     }
 }
 
 EResourceState ResourceRepository::GetContentTypeState( gem::EContentType contentType ) const
 {
-    auto it = m_contentTypesState.find( contentType );
+    ContentStatePtr state = m_contentState.Load();
 
-    return it == m_contentTypesState.end() ? EResourceState::Unavailable : it->second;
+    auto it = state->contentTypesState.find( contentType );
+
+    return it == state->contentTypesState.end() ? EResourceState::Unavailable : it->second;
 }
 
 
@@ -355,28 +860,313 @@ void ResourceRepository::SetContentTypeState( gem::EContentType contentType, ERe
 {
     gem::Debug().log( gem::LogInfo, "ResourceRepository", __FUNCTION__, __FILE__, __LINE__, "Set content type state(%d) = %d", int( contentType ), int( contentTypeState ) );
 
-    m_contentTypesState[contentType] = contentTypeState;
+    m_contentState.Modify( [&]( ContentState& state ) { state.contentTypesState[contentType] = contentTypeState; } );
+
+    // the lists are published (or changed) along with the state
+    InvalidateContentSnapshots();
 }
 
-void ResourceRepository::FillCountriesIsoToImageUids()
+void ResourceRepository::SetOnlineContentStore( gem::EContentType contentType, const gem::ContentStoreItemList& items )
 {
-    // fill the map (iso country (int), imageUid) 
-    auto collectCountries = [&]( const gem::String& name, const gem::Image& icon, const gem::String& iso )
+    OnlineContentEntries entries = GetOnlineContentEntries( items );
+    size_t stamp = OnlineContentCache::GetStamp( entries );
+
+    ContentStatePtr current = m_contentState.Load();
+
+    auto stampIt = current->onlineContentStamps.find( contentType );
+    auto stateIt = current->contentTypesState.find( contentType );
+
+    bool bAvailable = stateIt != current->contentTypesState.end() && stateIt->second == EResourceState::Available;
+
+    // the published list & snapshots stay as they are
+    if ( stampIt != current->onlineContentStamps.end() && stampIt->second == stamp && bAvailable )
     {
-        m_countriesIsoToImageUids.insert( std::make_pair<>( IsoToInt( iso ), icon.getUid() ) );
+        gem::Debug().log( gem::LogInfo, "ResourceRepository", __FUNCTION__, __FILE__, __LINE__, "Online content store(%d) unchanged", int( contentType ) );
+        return;
+    }
 
-        return true;
-    };
+    // a served list is patched: the snapshot keeps the states of the items which didn't change
+    auto listIt = current->onlineContentStores.find( contentType );
+    bool bPatch = bAvailable && current->bConnected && listIt != current->onlineContentStores.end();
+
+    OnlineContentDiff diff;
+    if ( bPatch )
+        diff = OnlineContentCache::Diff( GetOnlineContentEntries( listIt->second ), entries );
+
+    gem::Debug().log( gem::LogInfo, "ResourceRepository", __FUNCTION__, __FILE__, __LINE__, "Set online content store(%d), %d items, %d changed", int( contentType ), int( items.size() ),
+        bPatch ? int( diff.changedItems.size() + diff.removedCount ) : int( items.size() ) );
+
+    m_contentState.Modify( [&]( ContentState& state )
+    {
+        state.onlineContentStores[contentType] = items;
+        state.onlineContentStamps[contentType] = stamp;
+        state.contentTypesState[contentType] = EResourceState::Available;
+    } );
+
+    m_onlineContentCache.Store( int( contentType ), entries );
+
+    if ( bPatch )
+        PatchContentSnapshot( contentType == MAP_TYPE ? EResourceType::Map : EResourceType::Style, items, diff );
+    else
+        InvalidateContentSnapshots();
+}
+
+void ResourceRepository::InvalidateContentSnapshots()
+{
+    for ( auto& it : m_contentSnapshots )
+        it.second.Invalidate();
+}
+
+void ResourceRepository::PatchContentSnapshot( EResourceType type, const gem::ContentStoreItemList& items, const OnlineContentDiff& diff )
+{
+    SnapshotSlot<ContentSnapshot>& slot = m_contentSnapshots.at( type );
+
+    // an invalidated snapshot is rebuilt from the new list anyway
+    ContentSnapshotPtr snapshot = slot.Load();
+    if ( !snapshot )
+        return;
+
+    const ContentCatalog& catalog = snapshot->catalog;
+
+    std::vector<EItemState> states;
+    states.reserve( items.size() );
 
-    gem::MapDetails().iterateCountries( collectCountries );
+    auto changedIt = diff.changedItems.begin();
+    size_t index = 0;
+
+    for ( const auto& item : items )
+    {
+        size_t catalogIndex = size_t( -1 );
+
+        if ( changedIt != diff.changedItems.end() && *changedIt == index )
+            changedIt++;
+        else
+            catalogIndex = catalog.FindItem( item.getId() );
+
+        states.push_back( catalogIndex != size_t( -1 ) ? catalog.GetItemState( catalogIndex ) : GetItemState( item ) );
+        index++;
+    }
+
+    // dropped if invalidated meanwhile
+    slot.Replace( snapshot, std::make_shared<const ContentSnapshot>( ContentCatalog( items, states ), ++m_contentVersion ) );
 }
 
-unsigned int ResourceRepository::GetFlagImageUid( const gem::String& iso )
+void ResourceRepository::UpdateItemStates()
 {
-    return m_countriesIsoToImageUids.find( IsoToInt( iso ) )->second;
+    auto now = std::chrono::steady_clock::now();
+    if ( now - m_itemStatesCheckTime < ITEM_STATES_CHECK_INTERVAL )
+        return;
+
+    m_itemStatesCheckTime = now;
+
+    for ( auto& it : m_contentSnapshots )
+    {
+        // an invalidated snapshot is rebuilt with the current states anyway
+        ContentSnapshotPtr snapshot = it.second.Load();
+        if ( !snapshot )
+            continue;
+
+        const ContentCatalog& catalog = snapshot->catalog;
+
+        // only the running downloads can change state unnotified
+        std::vector<std::pair<size_t, EItemState>> changes;
+        for ( auto index : catalog.GetItemsByState( EItemState::InProgress ) )
+        {
+            EItemState state = GetItemState( catalog.GetItem( index ) );
+            if ( state != EItemState::InProgress )
+                changes.push_back( std::make_pair<>( index, state ) );
+        }
+
+        if ( changes.empty() )
+            continue;
+
+        // same list, new states (the groups of the changed items are updated, not rebuilt)
+        ContentCatalog newCatalog = catalog;
+        for ( const auto& change : changes )
+            newCatalog.SetItemState( change.first, change.second );
+
+        // dropped if invalidated meanwhile
+        it.second.Replace( snapshot, std::make_shared<const ContentSnapshot>( std::move( newCatalog ), ++m_contentVersion ) );
+    }
 }
 
-int ResourceRepository::IsoToInt( const gem::String& iso )
+void ResourceRepository::UpdateBulkDownloads()
 {
-    return iso[0] | (iso[1] << 8) | (iso[2] << 16);
+    std::vector<std::function<void()>> completedDownloads;
+
+    {
+        std::lock_guard<std::mutex> guard( m_bulkDownloadsSync );
+
+        auto now = std::chrono::steady_clock::now();
+
+        for ( auto it = m_bulkDownloads.begin(); it != m_bulkDownloads.end(); )
+        {
+            BulkDownload& download = it->second;
+            BulkDownloadProgress& progress = download.progress;
+
+            auto elapsed = now - download.progressTime;
+            if ( elapsed < BULK_PROGRESS_INTERVAL )
+            {
+                ++it;
+                continue;
+            }
+
+            download.progressTime = now;
+
+            gem::LargeInteger downloadedBytes = download.completedBytes;
+
+            for ( auto itemIt = download.pendingItems.begin(); itemIt != download.pendingItems.end(); )
+            {
+                gem::LargeInteger itemId = itemIt->getId();
+                gem::LargeInteger itemSize = itemIt->getTotalSize();
+
+                // an item no longer scheduled without a reported result was paused / replaced by another download
+                auto resultIt = download.itemResults.find( itemId );
+                if ( resultIt == download.itemResults.end() && m_downloadScheduler.IsScheduled( itemId ) )
+                {
+                    downloadedBytes += itemSize * itemIt->getDownloadProgress() / 100;
+                    ++itemIt;
+                    continue;
+                }
+
+                int reason = gem::KNoError;
+                if ( resultIt != download.itemResults.end() )
+                    reason = resultIt->second;
+                else if ( itemIt->getStatus() != gem::EContentStoreItemStatus::CIS_Completed )
+                    reason = gem::error::KCancel;
+
+                if ( reason == gem::KNoError )
+                {
+                    progress.completedCount++;
+                    download.completedBytes += itemSize;
+                    downloadedBytes += itemSize;
+                }
+                else
+                {
+                    progress.failedCount++;
+                    progress.totalBytes -= itemSize;
+
+                    if ( download.error == gem::KNoError )
+                        download.error = reason;
+                }
+
+                itemIt = download.pendingItems.erase( itemIt );
+            }
+
+            double seconds = std::chrono::duration<double>( elapsed ).count();
+            double bytesPerSecond = std::max<gem::LargeInteger>( 0, downloadedBytes - progress.downloadedBytes ) / seconds;
+
+            progress.bytesPerSecond = ( progress.bytesPerSecond + bytesPerSecond ) / 2;
+            progress.downloadedBytes = downloadedBytes;
+            progress.etaSeconds = progress.bytesPerSecond > 0 ? ( progress.totalBytes - downloadedBytes ) / progress.bytesPerSecond : -1;
+
+            if ( !download.pendingItems.empty() )
+            {
+                ++it;
+                continue;
+            }
+
+            if ( download.completeFunc )
+                completedDownloads.push_back( std::bind( download.completeFunc, it->first, download.error ) );
+
+            it = m_bulkDownloads.erase( it );
+        }
+    }
+
+    for ( auto& notify : completedDownloads )
+        notify();
+}
+
+void ResourceRepository::QueueDownloadProgress( gem::LargeInteger itemId, int progress )
+{
+    std::lock_guard<std::mutex> guard( m_progressEventsSync );
+
+    ProgressEvent& event = m_downloadProgressEvents[itemId];
+    event.progress = progress;
+    event.bPending = true;
+}
+
+void ResourceRepository::QueueUpdateProgress( EResourceType type, int progress )
+{
+    std::lock_guard<std::mutex> guard( m_progressEventsSync );
+
+    ProgressEvent& event = m_updateProgressEvents[type];
+    event.progress = progress;
+    event.bPending = true;
+}
+
+void ResourceRepository::QueueDownloadFinished( gem::LargeInteger itemId, int reason )
+{
+    std::lock_guard<std::mutex> guard( m_progressEventsSync );
+
+    auto it = m_downloadProgressEvents.find( itemId );
+    if ( it != m_downloadProgressEvents.end() )
+    {
+        // the last value still goes out (a completed item reports its 100%)
+        if ( it->second.bPending )
+            m_finishedDownloadProgress.emplace_back( itemId, it->second.progress );
+
+        m_downloadProgressEvents.erase( it );
+    }
+
+    m_finishedDownloadEvents.emplace_back( itemId, reason );
+}
+
+bool ResourceRepository::ProgressEvent::Take( std::chrono::steady_clock::time_point now, std::chrono::steady_clock::duration interval )
+{
+    if ( !bPending || now - deliveryTime < interval )
+        return false;
+
+    bPending = false;
+    deliveryTime = now;
+
+    return true;
+}
+
+void ResourceRepository::DeliverProgressEvents()
+{
+    std::vector<std::pair<gem::LargeInteger, int>> downloadEvents;
+    std::vector<std::pair<EResourceType, int>> updateEvents;
+    std::vector<std::pair<gem::LargeInteger, int>> finishedEvents;
+
+    {
+        std::lock_guard<std::mutex> guard( m_progressEventsSync );
+
+        auto now = std::chrono::steady_clock::now();
+
+        // finished items are no longer throttled
+        downloadEvents.swap( m_finishedDownloadProgress );
+        finishedEvents.swap( m_finishedDownloadEvents );
+
+        for ( auto& it : m_downloadProgressEvents )
+            if ( it.second.Take( now, m_progressEventsInterval ) )
+                downloadEvents.emplace_back( it.first, it.second.progress );
+
+        for ( auto& it : m_updateProgressEvents )
+            if ( it.second.Take( now, m_progressEventsInterval ) )
+                updateEvents.emplace_back( it.first, it.second.progress );
+    }
+
+    for ( const auto& event : downloadEvents )
+        for ( auto listener : m_listeners )
+            listener->OnDownloadProgress( event.first, event.second );
+
+    for ( const auto& event : updateEvents )
+        for ( auto listener : m_listeners )
+            listener->OnUpdateProgress( event.first, event.second );
+
+    for ( const auto& event : finishedEvents )
+        for ( auto listener : m_listeners )
+            listener->OnDownloadFinished( event.first, event.second );
+}
+
+std::vector<EItemState> ResourceRepository::GetItemStates( const gem::ContentStoreItemList& items ) const
+{
+    std::vector<EItemState> states;
+    states.reserve( items.size() );
+
+    for ( const auto& item : items )
+        states.push_back( GetItemState( item ) );
+
+    return states;
 }
@@ -11,13 +11,25 @@
 #include "IResourceRepository.h"
 
 #include "ContentUpdateListener.h"
+#include "DownloadScheduler.h"
+#include "StorageManager.h"
+#include "OnlineContentCache.h"
+#include "CountryMetadata.h"
+#include "SnapshotSlot.h"
+#include "WorkerPool.h"
 
 #include <API/GEM_ContentStore.h>
 
 #include <map>
+#include <deque>
 #include <set>
 #include <mutex>
+#include <atomic>
 #include <vector>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <functional>
 
 const gem::EContentType MAP_TYPE = gem::EContentType::CT_RoadMap;
 const gem::EContentType STYLE_TYPE = gem::EContentType::CT_ViewStyleHighRes;
@@ -29,10 +41,40 @@ enum class EResourceState
     Available
 };
 
+// The content store lists & updaters used by the repository (a fake store can publish lists
+// from any thread). The updaters may be null, there is then nothing to update.
+class IContentStoreBackend
+{
+public:
+    virtual gem::ContentStoreItemList GetLocalContentList( gem::EContentType type ) = 0;
+
+    // ( list, true if it is up to date )
+    virtual std::pair<gem::ContentStoreItemList, bool> GetStoreContentList( gem::EContentType type ) = 0;
+    virtual void AsyncGetStoreContentList( gem::EContentType type, gem::StrongPointer<gem::IProgressListener> listener ) = 0;
+
+    virtual gem::StrongPointer<gem::ContentUpdater> CreateContentUpdater( gem::EContentType type ) = 0;
+
+    virtual ~IContentStoreBackend() = default;
+};
+
+// gem::ContentStore lists & updaters
+class ContentStoreBackend : public IContentStoreBackend
+{
+public:
+    gem::ContentStoreItemList GetLocalContentList( gem::EContentType type ) override;
+
+    std::pair<gem::ContentStoreItemList, bool> GetStoreContentList( gem::EContentType type ) override;
+    void AsyncGetStoreContentList( gem::EContentType type, gem::StrongPointer<gem::IProgressListener> listener ) override;
+
+    gem::StrongPointer<gem::ContentUpdater> CreateContentUpdater( gem::EContentType type ) override;
+};
+
 class ResourceRepository : public IResourceRepository
 {
 public:
-    ResourceRepository();
+    // the staged updates are verified & applied on workerPool (shared with the texture repository)
+    ResourceRepository( WorkerPool* workerPool, const std::string& cachePath = std::string(), CountryMetadataPtr countries = std::make_shared<CountryMetadata>(),
+        std::unique_ptr<IContentStoreBackend> contentStore = std::make_unique<ContentStoreBackend>() );
     ~ResourceRepository();
 
     void AddListener( IResourceRepositoryListener* listener ) override;
@@ -44,12 +86,36 @@ public:
     gem::ContentStoreItemList GetMaps () override;
     gem::ContentStoreItemList GetStyles ();
 
-    bool DownloadAsync( gem::ContentStoreItem& item ) override;
+    ContentSnapshotPtr GetContentSnapshot( EResourceType type ) override;
+
+    EEnqueueResult DownloadAsync( gem::ContentStoreItem& item, EDownloadPriority priority = EDownloadPriority::UserInitiated ) override;
+    void PauseDownload( gem::ContentStoreItem& item ) override;
+
+    void PauseDownloadQueue() override;
+    void ResumeDownloadQueue() override;
+    bool IsDownloadQueuePaused() const override;
+
+    BulkDownloadId DownloadItems( const std::vector<gem::LargeInteger>& itemIds, BulkDownloadCompleteFunc completeFunc = nullptr, EDownloadPriority priority = EDownloadPriority::UserInitiated ) override;
+    BulkDownloadId DownloadCountries( const std::vector<gem::String>& isos, BulkDownloadCompleteFunc completeFunc = nullptr, EDownloadPriority priority = EDownloadPriority::UserInitiated ) override;
+
+    bool GetBulkDownloadProgress( BulkDownloadId id, BulkDownloadProgress& progress ) const override;
+    void CancelBulkDownload( BulkDownloadId id ) override;
+
+    void SetProgressEventsRate( double eventsPerSecond ) override;
+
+    void SetStorageQuota( gem::LargeInteger quotaBytes ) override;
+    StorageUsage GetStorageUsage() override;
+    void SetActiveCountries( const std::vector<gem::String>& isos ) override;
+
+    void SetDownloadLimits( size_t maxParallelDownloads, double maxBytesPerSecond ) override;
 
     EItemState GetItemState( const gem::ContentStoreItem& item ) const;
 
     bool IsMapUpdateRunning() const override;
     void SetCanApplyMapUpdate( bool canApplyMapUpdate ) override;
+    bool HasStagedUpdates() const override;
+
+    std::vector<UpdateApplyReport> GetUpdateApplyReports() const override;
 
     void UpdateMaps() override;
     void UpdateStyles() override;
@@ -58,34 +124,170 @@ public:
 
     gem::Image GetFlagImage( const gem::String& iso ) override;
 
+    void Tick() override;
+
 private:
+    // drives the content states from a fake store
+    friend class ResourceRepositoryTest;
+
     gem::ContentStoreItemList GetContentStoreItems( EResourceType type ) override;
 
     void ResumeExistingUpdates();
 
+    using StagedUpdates = std::map<EResourceType, gem::WeakPointer<gem::ContentUpdater>>;
+
+    // the ready update is applied later, in an idle window
+    void StageUpdate( EResourceType type, const gem::StrongPointer<gem::ContentUpdater>& updater );
+
+    // from Tick: starts applying the staged updates on a worker once idle, republishes the applied ones
+    void ApplyStagedUpdates();
+    // on the worker, the download queue is paused meanwhile
+    void ApplyUpdates( const StagedUpdates& stagedUpdates );
+    void PublishAppliedUpdates();
+
     void UpdateOfflineContentStores();
     void UpdateOnlineContentStores();
 
     void UpdateOnlineResource( gem::EContentType type );
 
+    // the current online lists stay available, the fetched ones replace them only if they differ
+    void RefreshOnlineContentStores();
+    void RefreshOnlineResource( gem::EContentType type );
+
+    // true if the list is the last good one published (saved in the online content cache)
+    bool IsLastOnlineContentStore( gem::EContentType contentType, const gem::ContentStoreItemList& items ) const;
+    static OnlineContentEntries GetOnlineContentEntries( const gem::ContentStoreItemList& items );
+
+    // the snapshots are rebuilt on the next GetContentSnapshot call
+    void InvalidateContentSnapshots();
+
+    // republishes the snapshot for the new version of its list: only the changed items get their state
+    // computed, the others keep the one they had
+    void PatchContentSnapshot( EResourceType type, const gem::ContentStoreItemList& items, const OnlineContentDiff& diff );
+
+    // republishes the snapshots whose running downloads changed state unnotified; from Tick
+    void UpdateItemStates();
+    std::vector<EItemState> GetItemStates( const gem::ContentStoreItemList& items ) const;
+
+    // updates the progress of the bulk downloads, completes the finished ones
+    void UpdateBulkDownloads();
+
+    // deletes the least recently used maps so that requiredBytes more fit in the quota, false if they can't
+    bool MakeStorageRoom( gem::LargeInteger requiredBytes );
+
+    // storage not yet reserved by the item (its full size unless it is already downloading / paused)
+    static gem::LargeInteger GetRequiredStorage( const ContentCatalog& catalog, size_t index );
+
+    void OnItemDownloaded( gem::LargeInteger itemId, int reason );
+
+    // the progress notifications are kept here (latest value only) until delivered from Tick
+    void QueueDownloadProgress( gem::LargeInteger itemId, int progress );
+    void QueueUpdateProgress( EResourceType type, int progress );
+    // the item's progress entry is dropped, its finish delivered after any pending progress
+    void QueueDownloadFinished( gem::LargeInteger itemId, int reason );
+    void DeliverProgressEvents();
+
     EResourceState GetContentTypeState( gem::EContentType contentType ) const;
     void SetContentTypeState( gem::EContentType contentType, EResourceState contentTypeState );
 
-    void FillCountriesIsoToImageUids();
+    // the list and the Available state are published together (nothing is published if the list is unchanged),
+    // the list is saved as the last good one
+    void SetOnlineContentStore( gem::EContentType contentType, const gem::ContentStoreItemList& items );
+
+    // State written from the SDK callbacks and read each frame. It is never modified in place:
+    // writers publish a modified copy through the slot, readers keep the version they loaded.
+    struct ContentState
+    {
+        ContentState()
+            : bConnected( false )
+        {}
+
+        std::map<gem::EContentType, EResourceState> contentTypesState;
+        std::map<gem::EContentType, gem::ContentStoreItemList> offlineContentStores;
+        std::map<gem::EContentType, gem::ContentStoreItemList> onlineContentStores;
+        std::map<gem::EContentType, size_t> onlineContentStamps;
+        bool bConnected;
+    };
+    using ContentStatePtr = SnapshotSlot<ContentState>::Ptr;
 
-    unsigned int GetFlagImageUid( const gem::String& iso );
+private:
+    SnapshotSlot<ContentState> m_contentState;
+
+    // one per resource type, all inserted by the constructor: the map itself is never modified
+    // afterwards and is read without lock
+    std::map<EResourceType, SnapshotSlot<ContentSnapshot>> m_contentSnapshots;
+    std::atomic<size_t> m_contentVersion;
+    std::chrono::steady_clock::time_point m_itemStatesCheckTime;
+
+    struct BulkDownload
+    {
+        BulkDownload()
+            : completedBytes( 0 )
+            , error( 0 )
+        {}
+
+        std::vector<gem::ContentStoreItem> pendingItems;
+        std::map<gem::LargeInteger, int> itemResults;   // reported by the scheduler, applied on update
+
+        BulkDownloadProgress progress;
+        gem::LargeInteger completedBytes;
+        std::chrono::steady_clock::time_point progressTime;
+
+        int error;
+        BulkDownloadCompleteFunc completeFunc;
+    };
+
+    struct ProgressEvent
+    {
+        ProgressEvent()
+            : progress( 0 )
+            , bPending( false )
+        {}
+
+        // true if due (pending and not delivered in the last interval)
+        bool Take( std::chrono::steady_clock::time_point now, std::chrono::steady_clock::duration interval );
+
+        int progress;
+        bool bPending;
+        std::chrono::steady_clock::time_point deliveryTime;
+    };
+
+    // declared before the scheduler, whose notifications update them
+    std::map<gem::LargeInteger, ProgressEvent> m_downloadProgressEvents;
+    std::map<EResourceType, ProgressEvent> m_updateProgressEvents;
+    // ( item id, undelivered last progress ) and ( item id, reason ) of the finished downloads
+    std::vector<std::pair<gem::LargeInteger, int>> m_finishedDownloadProgress;
+    std::vector<std::pair<gem::LargeInteger, int>> m_finishedDownloadEvents;
+    std::chrono::steady_clock::duration m_progressEventsInterval;
+    std::mutex m_progressEventsSync;
+
+    std::map<BulkDownloadId, BulkDownload> m_bulkDownloads;
+    BulkDownloadId m_lastBulkDownloadId;
+    mutable std::mutex m_bulkDownloadsSync;
+
+    StorageManager m_storageManager;
+    OnlineContentCache m_onlineContentCache;
+
+    std::unique_ptr<IContentStoreBackend> m_contentStore;
+
+    DownloadScheduler m_downloadScheduler;
+    std::map<gem::EContentType, gem::StrongPointer<gem::IProgressListener>> m_progressListeners;
 
-    int IsoToInt( const gem::String& iso );
+    mutable std::mutex m_contentUpdatersSync;
 
-private:
-    std::map<gem::EContentType, EResourceState> m_contentTypesState;
-    std::map<gem::EContentType, gem::ContentStoreItemList> m_offlineContentStores;
-    std::map<gem::EContentType, gem::ContentStoreItemList> m_onlineContentStores;
+    StagedUpdates m_stagedUpdates;
+    std::deque<UpdateApplyReport> m_updateApplyReports;
+    std::chrono::steady_clock::time_point m_canApplyUpdateTime;
 
-    std::map<gem::LargeInteger, gem::StrongPointer<gem::IProgressListener>> m_downloads;
-    std::map<gem::EContentType, gem::StrongPointer<gem::IProgressListener>> m_progressListeners;
+    // applied by the worker, not yet republished
+    std::vector<UpdateApplyReport> m_appliedUpdates;
+    bool m_bApplyingUpdates;
+    bool m_bClosing;
 
-    std::mutex m_contentUpdatersSync;
+    // the running apply (ready when done or dropped by the stopped pool); UI thread only
+    std::future<void> m_updatesApplied;
+    bool m_bQueuePausedForApply;
+    WorkerPool* m_workerPool;
 
     gem::StrongPointer<gem::ContentUpdater> m_mapUpdater;
     gem::StrongPointer<ContentUpdateListener> m_mapUpdateListener;
@@ -93,10 +295,10 @@ private:
     gem::StrongPointer<gem::ContentUpdater> m_mapStylesUpdater;
     gem::StrongPointer<ContentUpdateListener> m_mapStylesUpdateListener;
 
-    bool m_bConnected;
     bool m_bCanApplyMapUpdate;
 
     std::vector<IResourceRepositoryListener*> m_listeners;
 
-    std::map<int, unsigned int> m_countriesIsoToImageUids;
+    // shared with the texture repository
+    CountryMetadataPtr m_countries;
 };
@@ -0,0 +1,347 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "RouteArchive.h"
+
+#include <Windows.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// 'GRTA'
+const uint32_t ARCHIVE_MAGIC = 0x41545247;
+
+// bump when the layout below changes
+const uint32_t ARCHIVE_VERSION = 1;
+
+// coordinates are stored in 1e-6 degrees (about 0.1 m)
+const double DEGREES_SCALE = 1e6;
+
+struct ArchiveHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t mapVersion;
+    uint32_t mode;
+    uint32_t payloadSize;   // bytes after the header
+};
+
+static void WriteVarint( std::vector<unsigned char>& buffer, uint64_t value )
+{
+    while ( value >= 0x80 )
+    {
+        buffer.push_back( (unsigned char)( value | 0x80 ) );
+        value >>= 7;
+    }
+
+    buffer.push_back( (unsigned char)value );
+}
+
+// zigzag: the small negative values take a single byte as well
+static void WriteSigned( std::vector<unsigned char>& buffer, int64_t value )
+{
+    WriteVarint( buffer, ( uint64_t( value ) << 1 ) ^ uint64_t( value >> 63 ) );
+}
+
+static void WriteString( std::vector<unsigned char>& buffer, const std::string& text )
+{
+    WriteVarint( buffer, text.size() );
+    buffer.insert( buffer.end(), text.begin(), text.end() );
+}
+
+static int32_t QuantiseDegrees( double degrees )
+{
+    return int32_t( std::llround( degrees * DEGREES_SCALE ) );
+}
+
+// delta from the previous coordinates of the same sequence
+static void WriteCoordinates( std::vector<unsigned char>& buffer, const gem::Coordinates& coordinates, int32_t& latitude, int32_t& longitude )
+{
+    int32_t newLatitude = QuantiseDegrees( coordinates.getLatitude() );
+    int32_t newLongitude = QuantiseDegrees( coordinates.getLongitude() );
+
+    WriteSigned( buffer, int64_t( newLatitude ) - latitude );
+    WriteSigned( buffer, int64_t( newLongitude ) - longitude );
+
+    latitude = newLatitude;
+    longitude = newLongitude;
+}
+
+// Bounds checked decoding: past the end or on a malformed value every read returns 0 and bValid is
+// cleared, checked once at the end.
+struct ArchiveReader
+{
+    ArchiveReader( const unsigned char* data, size_t size )
+        : position( data )
+        , end( data + size )
+        , bValid( true )
+    {}
+
+    uint64_t ReadVarint()
+    {
+        uint64_t value = 0;
+
+        for ( int shift = 0; shift < 64; shift += 7 )
+        {
+            if ( position == end )
+                break;
+
+            unsigned char byte = *position++;
+            value |= uint64_t( byte & 0x7F ) << shift;
+
+            if ( !( byte & 0x80 ) )
+                return value;
+        }
+
+        bValid = false;
+        position = end;
+        return 0;
+    }
+
+    int64_t ReadSigned()
+    {
+        uint64_t value = ReadVarint();
+
+        return int64_t( value >> 1 ) ^ -int64_t( value & 1 );
+    }
+
+    // each element takes a byte at least, a larger count is corrupt (and would be reserved)
+    size_t ReadCount()
+    {
+        uint64_t count = ReadVarint();
+
+        if ( count > uint64_t( end - position ) )
+        {
+            bValid = false;
+            position = end;
+            return 0;
+        }
+
+        return size_t( count );
+    }
+
+    std::string ReadString()
+    {
+        size_t length = ReadCount();
+
+        std::string text( (const char*)position, length );
+        position += length;
+
+        return text;
+    }
+
+    gem::Coordinates ReadCoordinates( int32_t& latitude, int32_t& longitude )
+    {
+        latitude += int32_t( ReadSigned() );
+        longitude += int32_t( ReadSigned() );
+
+        return gem::Coordinates( latitude / DEGREES_SCALE, longitude / DEGREES_SCALE );
+    }
+
+    const unsigned char* position;
+    const unsigned char* end;
+    bool bValid;
+};
+
+int RouteArchive::Write( const std::string& filePath, const StoredRoutes& routes )
+{
+    std::vector<unsigned char> buffer;
+    Encode( routes, buffer );
+
+    std::string tempPath = filePath + ".tmp";
+
+    HANDLE file = CreateFileA( tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if ( file == INVALID_HANDLE_VALUE )
+        return gem::error::KNotFound;
+
+    DWORD written = 0;
+    bool bWritten = WriteFile( file, buffer.data(), DWORD( buffer.size() ), &written, nullptr ) && written == buffer.size();
+
+    CloseHandle( file );
+
+    if ( !bWritten || !MoveFileExA( tempPath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING ) )
+    {
+        DeleteFileA( tempPath.c_str() );
+        return gem::error::KNotFound;
+    }
+
+    return gem::KNoError;
+}
+
+int RouteArchive::Read( const std::string& filePath, StoredRoutes& routes )
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    HANDLE file = CreateFileA( filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if ( file == INVALID_HANDLE_VALUE )
+        return gem::error::KNotFound;
+
+    LARGE_INTEGER size;
+    if ( !GetFileSizeEx( file, &size ) || size.QuadPart < (LONGLONG)sizeof( ArchiveHeader ) )
+    {
+        CloseHandle( file );
+        return gem::error::KInvalidInput;
+    }
+
+    HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    const unsigned char* view = mapping ? (const unsigned char*)MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 ) : nullptr;
+
+    bool bDecoded = view && Decode( view, size_t( size.QuadPart ), routes );
+
+    if ( view )
+        UnmapViewOfFile( view );
+
+    if ( mapping )
+        CloseHandle( mapping );
+
+    CloseHandle( file );
+
+    if ( !bDecoded )
+        return gem::error::KInvalidInput;
+
+    routes.fileSize = size_t( size.QuadPart );
+    routes.loadSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - startTime ).count();
+
+    return gem::KNoError;
+}
+
+void RouteArchive::Encode( const StoredRoutes& routes, std::vector<unsigned char>& buffer )
+{
+    buffer.assign( sizeof( ArchiveHeader ), 0 );
+
+    int32_t latitude = 0, longitude = 0;
+
+    WriteVarint( buffer, routes.waypoints.size() );
+
+    for ( const auto& waypoint : routes.waypoints )
+    {
+        WriteCoordinates( buffer, waypoint.getCoordinates(), latitude, longitude );
+        WriteString( buffer, waypoint.getName().toStdString() );
+    }
+
+    WriteVarint( buffer, routes.routes.size() );
+
+    for ( const auto& route : routes.routes )
+    {
+        WriteVarint( buffer, (std::max)( route.timeSeconds, 0 ) );
+        WriteVarint( buffer, (std::max)( route.distanceMeters, 0 ) );
+
+        // each route starts over from ( 0, 0 )
+        latitude = longitude = 0;
+
+        WriteVarint( buffer, route.polyline.size() );
+
+        for ( const auto& coordinates : route.polyline )
+            WriteCoordinates( buffer, coordinates, latitude, longitude );
+
+        latitude = longitude = 0;
+        int timeSeconds = 0, distanceMeters = 0;
+
+        WriteVarint( buffer, route.instructions.size() );
+
+        for ( const auto& instruction : route.instructions )
+        {
+            WriteCoordinates( buffer, instruction.coordinates, latitude, longitude );
+
+            WriteSigned( buffer, int64_t( instruction.timeSeconds ) - timeSeconds );
+            WriteSigned( buffer, int64_t( instruction.distanceMeters ) - distanceMeters );
+            timeSeconds = instruction.timeSeconds;
+            distanceMeters = instruction.distanceMeters;
+
+            WriteString( buffer, instruction.text );
+        }
+    }
+
+    ArchiveHeader header;
+    memset( &header, 0, sizeof( header ) );
+    header.magic = ARCHIVE_MAGIC;
+    header.version = ARCHIVE_VERSION;
+    header.mapVersion = routes.mapVersion;
+    header.mode = uint32_t( routes.mode );
+    header.payloadSize = uint32_t( buffer.size() - sizeof( header ) );
+
+    memcpy( buffer.data(), &header, sizeof( header ) );
+}
+
+bool RouteArchive::Decode( const unsigned char* data, size_t size, StoredRoutes& routes )
+{
+    if ( size < sizeof( ArchiveHeader ) )
+        return false;
+
+    // the mapping is not necessarily aligned for the header
+    ArchiveHeader header;
+    memcpy( &header, data, sizeof( header ) );
+
+    if ( header.magic != ARCHIVE_MAGIC || header.version != ARCHIVE_VERSION || header.payloadSize != size - sizeof( header ) )
+        return false;
+
+    ArchiveReader reader( data + sizeof( header ), header.payloadSize );
+
+    StoredRoutes decoded;
+    decoded.mode = ETransportMode( header.mode );
+    decoded.mapVersion = header.mapVersion;
+
+    int32_t latitude = 0, longitude = 0;
+
+    size_t waypointCount = reader.ReadCount();
+
+    for ( size_t index = 0; index < waypointCount && reader.bValid; index++ )
+    {
+        gem::Coordinates coordinates = reader.ReadCoordinates( latitude, longitude );
+        std::string name = reader.ReadString();
+
+        decoded.waypoints.push_back( gem::Landmark( name.c_str(), coordinates ) );
+    }
+
+    size_t routeCount = reader.ReadCount();
+    decoded.routes.resize( routeCount );
+
+    for ( auto& route : decoded.routes )
+    {
+        route.timeSeconds = int( reader.ReadVarint() );
+        route.distanceMeters = int( reader.ReadVarint() );
+
+        latitude = longitude = 0;
+
+        route.polyline.resize( reader.ReadCount() );
+
+        for ( auto& coordinates : route.polyline )
+            coordinates = reader.ReadCoordinates( latitude, longitude );
+
+        latitude = longitude = 0;
+        int timeSeconds = 0, distanceMeters = 0;
+
+        route.instructions.resize( reader.ReadCount() );
+
+        for ( auto& instruction : route.instructions )
+        {
+            instruction.coordinates = reader.ReadCoordinates( latitude, longitude );
+
+            timeSeconds += int( reader.ReadSigned() );
+            distanceMeters += int( reader.ReadSigned() );
+            instruction.timeSeconds = timeSeconds;
+            instruction.distanceMeters = distanceMeters;
+
+            instruction.text = reader.ReadString();
+        }
+
+        if ( !reader.bValid )
+            return false;
+    }
+
+    // trailing bytes are not expected either
+    if ( !reader.bValid || reader.position != reader.end )
+        return false;
+
+    routes = std::move( decoded );
+
+    return true;
+}
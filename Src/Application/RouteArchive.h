@@ -0,0 +1,32 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include "IMapService.h"
+
+#include <string>
+#include <vector>
+
+// Binary file of StoredRoutes: a fixed header (magic, format version, maps version, transport mode)
+// followed by the waypoints and, for each route, its polyline and instruction table. Coordinates are
+// rounded to 1e-6 degrees and stored as zigzag varint deltas from the previous point, so that a
+// polyline takes 2 to 4 bytes per point. Read decodes straight from a memory mapping of the file (no
+// read buffer), into the StoredRoutes vectors.
+class RouteArchive
+{
+public:
+    // written to a temporary file first, so that a previous archive is replaced only by a complete one
+    static int Write( const std::string& filePath, const StoredRoutes& routes );
+
+    // KNotFound if there is no file, KInvalidInput if it is truncated or of another format version
+    static int Read( const std::string& filePath, StoredRoutes& routes );
+
+    static void Encode( const StoredRoutes& routes, std::vector<unsigned char>& buffer );
+    static bool Decode( const unsigned char* data, size_t size, StoredRoutes& routes );
+};
@@ -0,0 +1,168 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "RouteCache.h"
+
+#include <cmath>
+#include <sstream>
+
+// routes kept (each list holds the alternatives of one computation)
+const size_t ROUTE_CACHE_CAPACITY = 32;
+
+// traffic and closures make older routes stale
+const double ROUTE_CACHE_TTL_SECONDS = 10 * 60;
+
+// about 10 m
+const double ROUTE_CACHE_PRECISION_DEGREES = 0.0001;
+
+RouteCache::RouteCache()
+    : m_capacity( ROUTE_CACHE_CAPACITY )
+    , m_timeToLive( std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( ROUTE_CACHE_TTL_SECONDS ) ) )
+    , m_precisionDegrees( ROUTE_CACHE_PRECISION_DEGREES )
+    , m_generation( 0 )
+    , m_hitCount( 0 )
+    , m_missCount( 0 )
+    , m_savedSeconds( 0 )
+{
+
+}
+
+void RouteCache::SetLimits( size_t capacity, double timeToLiveSeconds, double precisionDegrees )
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    m_capacity = capacity;
+    m_timeToLive = std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( timeToLiveSeconds ) );
+
+    // the keys made with the old precision would never be found again
+    if ( precisionDegrees > 0 && precisionDegrees != m_precisionDegrees )
+    {
+        m_precisionDegrees = precisionDegrees;
+        m_generation++;
+        m_entries.clear();
+        m_index.clear();
+    }
+
+    Trim();
+}
+
+std::string RouteCache::MakeKey( const gem::LandmarkList& waypoints, ETransportMode mode, gem::EBikeProfile bikeProfile ) const
+{
+    double precisionDegrees;
+
+    {
+        std::lock_guard<std::mutex> guard( m_sync );
+
+        if ( m_capacity == 0 )
+            return std::string();
+
+        precisionDegrees = m_precisionDegrees;
+    }
+
+    std::ostringstream key;
+    key << int( mode ) << '/' << int( bikeProfile );
+
+    for ( const auto& waypoint : waypoints )
+    {
+        const auto coordinates = waypoint.getCoordinates();
+
+        key << ';' << std::llround( coordinates.getLatitude() / precisionDegrees )
+            << ',' << std::llround( coordinates.getLongitude() / precisionDegrees );
+    }
+
+    return key.str();
+}
+
+bool RouteCache::Find( const std::string& key, gem::RouteList& routes )
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    auto it = m_index.find( key );
+
+    if ( it != m_index.end() && std::chrono::steady_clock::now() - it->second->insertTime > m_timeToLive )
+    {
+        m_entries.erase( it->second );
+        m_index.erase( it );
+        it = m_index.end();
+    }
+
+    if ( it == m_index.end() )
+    {
+        m_missCount++;
+        return false;
+    }
+
+    // most recently used
+    m_entries.splice( m_entries.begin(), m_entries, it->second );
+
+    routes = it->second->routes;
+
+    m_hitCount++;
+    m_savedSeconds += it->second->computeSeconds;
+
+    return true;
+}
+
+size_t RouteCache::GetGeneration() const
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    return m_generation;
+}
+
+void RouteCache::Insert( const std::string& key, const gem::RouteList& routes, double computeSeconds, size_t generation )
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    if ( key.empty() || m_capacity == 0 || generation != m_generation )
+        return;
+
+    auto it = m_index.find( key );
+    if ( it != m_index.end() )
+    {
+        m_entries.erase( it->second );
+        m_index.erase( it );
+    }
+
+    m_entries.emplace_front( key, routes, computeSeconds );
+    m_index[key] = m_entries.begin();
+
+    Trim();
+}
+
+void RouteCache::Clear()
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    m_generation++;
+
+    m_entries.clear();
+    m_index.clear();
+}
+
+RouteCacheStats RouteCache::GetStats() const
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    RouteCacheStats stats;
+    stats.entryCount = m_entries.size();
+    stats.hitCount = m_hitCount;
+    stats.missCount = m_missCount;
+    stats.savedSeconds = m_savedSeconds;
+
+    return stats;
+}
+
+void RouteCache::Trim()
+{
+    while ( m_entries.size() > m_capacity )
+    {
+        m_index.erase( m_entries.back().key );
+        m_entries.pop_back();
+    }
+}
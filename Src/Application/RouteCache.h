@@ -0,0 +1,84 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include "IMapService.h"
+
+#include <API/GEM_RoutingService.h>
+
+#include <list>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+
+// LRU cache of the computed routes. The key is made of the waypoints coordinates, quantised so that
+// waypoints a few meters apart share the routes, and of the transport mode / bike profile. Entries
+// expire after a time to live and the whole cache is flushed when the maps change.
+class RouteCache
+{
+public:
+    RouteCache();
+
+    // capacity = 0 disables the cache
+    void SetLimits( size_t capacity, double timeToLiveSeconds, double precisionDegrees );
+
+    // empty if the cache is disabled
+    std::string MakeKey( const gem::LandmarkList& waypoints, ETransportMode mode, gem::EBikeProfile bikeProfile ) const;
+
+    // counted as a hit or a miss
+    bool Find( const std::string& key, gem::RouteList& routes );
+
+    // Changed by each Clear: routes computed before a flush (read when the computation started)
+    // are not inserted after it.
+    size_t GetGeneration() const;
+
+    // computeSeconds = how long the computation took, counted as saved by each hit
+    void Insert( const std::string& key, const gem::RouteList& routes, double computeSeconds, size_t generation );
+
+    void Clear();
+
+    RouteCacheStats GetStats() const;
+
+private:
+    struct Entry
+    {
+        Entry( const std::string& key_, const gem::RouteList& routes_, double computeSeconds_ )
+            : key( key_ )
+            , routes( routes_ )
+            , computeSeconds( computeSeconds_ )
+            , insertTime( std::chrono::steady_clock::now() )
+        {}
+
+        std::string key;
+        gem::RouteList routes;
+        double computeSeconds;
+        std::chrono::steady_clock::time_point insertTime;
+    };
+    using EntryList = std::list<Entry>;
+
+    // lock held
+    void Trim();
+
+private:
+    EntryList m_entries; // most recently used first
+    std::unordered_map<std::string, EntryList::iterator> m_index;
+
+    size_t m_capacity;
+    std::chrono::steady_clock::duration m_timeToLive;
+    double m_precisionDegrees;
+
+    size_t m_generation;
+
+    size_t m_hitCount;
+    size_t m_missCount;
+    double m_savedSeconds;
+
+    mutable std::mutex m_sync;
+};
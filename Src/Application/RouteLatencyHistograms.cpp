@@ -0,0 +1,163 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "RouteLatencyHistograms.h"
+
+#include <cmath>
+#include <sstream>
+#include <algorithm>
+
+// bucket i holds the latencies up to 2^(i / BUCKETS_PER_DOUBLING) ms, the last one all the longer ones
+const size_t BUCKETS_PER_DOUBLING = 4;
+const size_t BUCKET_COUNT = 18 * BUCKETS_PER_DOUBLING + 1;
+
+// the waypoint count ranges upper bounds, the last range has no upper bound
+const size_t WAYPOINTS_RANGES[] = { 2, 4, 8, 16, 32, 64 };
+const size_t WAYPOINTS_RANGE_COUNT = sizeof( WAYPOINTS_RANGES ) / sizeof( WAYPOINTS_RANGES[0] ) + 1;
+
+RouteLatencyHistograms::Histogram::Histogram()
+    : buckets( BUCKET_COUNT, 0 )
+    , count( 0 )
+    , failedCount( 0 )
+    , maxMs( 0 )
+{
+
+}
+
+double RouteLatencyHistograms::Histogram::GetPercentileMs( double percentile ) const
+{
+    if ( count == 0 )
+        return 0;
+
+    // the rank of the percentile, 1 based
+    size_t rank = std::max<size_t>( 1, size_t( std::ceil( percentile * count ) ) );
+    size_t cumulated = 0;
+
+    for ( size_t bucket = 0; bucket < buckets.size(); bucket++ )
+    {
+        cumulated += buckets[bucket];
+
+        // the bucket bound can't be above the slowest computation
+        if ( cumulated >= rank )
+            return std::min( GetBucketUpperMs( bucket ), maxMs );
+    }
+
+    return maxMs;
+}
+
+RouteLatencyHistograms::RouteLatencyHistograms()
+{
+
+}
+
+void RouteLatencyHistograms::Record( ETransportMode mode, size_t waypointCount, double seconds, bool bSucceeded )
+{
+    double ms = seconds * 1000;
+
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    Histogram& histogram = m_histograms[HistogramKey( int( mode ), GetWaypointsRange( waypointCount ) )];
+
+    histogram.buckets[GetBucket( ms )]++;
+    histogram.count++;
+    histogram.maxMs = std::max( histogram.maxMs, ms );
+
+    if ( !bSucceeded )
+        histogram.failedCount++;
+}
+
+std::vector<RouteLatencyStats> RouteLatencyHistograms::GetStats() const
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    std::vector<RouteLatencyStats> statsList;
+
+    for ( const auto& it : m_histograms )
+    {
+        const Histogram& histogram = it.second;
+
+        RouteLatencyStats stats;
+        stats.mode = ETransportMode( it.first.first );
+        GetWaypointsRangeBounds( it.first.second, stats.minWaypoints, stats.maxWaypoints );
+
+        stats.count = histogram.count;
+        stats.failedCount = histogram.failedCount;
+        stats.p50Ms = histogram.GetPercentileMs( 0.50 );
+        stats.p95Ms = histogram.GetPercentileMs( 0.95 );
+        stats.p99Ms = histogram.GetPercentileMs( 0.99 );
+        stats.maxMs = histogram.maxMs;
+
+        statsList.push_back( stats );
+    }
+
+    return statsList;
+}
+
+std::string RouteLatencyHistograms::GetCsv() const
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    std::ostringstream csv;
+    csv << "mode,min_waypoints,max_waypoints,bucket_upper_ms,count\n";
+
+    for ( const auto& it : m_histograms )
+    {
+        size_t minWaypoints, maxWaypoints;
+        GetWaypointsRangeBounds( it.first.second, minWaypoints, maxWaypoints );
+
+        const auto& buckets = it.second.buckets;
+
+        for ( size_t bucket = 0; bucket < buckets.size(); bucket++ )
+        {
+            if ( buckets[bucket] == 0 )
+                continue;
+
+            csv << it.first.first << ',' << minWaypoints << ',' << maxWaypoints << ','
+                << GetBucketUpperMs( bucket ) << ',' << buckets[bucket] << '\n';
+        }
+    }
+
+    return csv.str();
+}
+
+void RouteLatencyHistograms::Clear()
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    m_histograms.clear();
+}
+
+size_t RouteLatencyHistograms::GetBucket( double ms )
+{
+    if ( ms <= 1 )
+        return 0;
+
+    size_t bucket = size_t( std::ceil( std::log2( ms ) * BUCKETS_PER_DOUBLING ) );
+
+    return std::min( bucket, BUCKET_COUNT - 1 );
+}
+
+double RouteLatencyHistograms::GetBucketUpperMs( size_t bucket )
+{
+    return std::exp2( double( bucket ) / BUCKETS_PER_DOUBLING );
+}
+
+size_t RouteLatencyHistograms::GetWaypointsRange( size_t waypointCount )
+{
+    for ( size_t range = 0; range + 1 < WAYPOINTS_RANGE_COUNT; range++ )
+        if ( waypointCount <= WAYPOINTS_RANGES[range] )
+            return range;
+
+    return WAYPOINTS_RANGE_COUNT - 1;
+}
+
+void RouteLatencyHistograms::GetWaypointsRangeBounds( size_t range, size_t& minWaypoints, size_t& maxWaypoints )
+{
+    minWaypoints = range == 0 ? 1 : WAYPOINTS_RANGES[range - 1] + 1;
+    maxWaypoints = range + 1 < WAYPOINTS_RANGE_COUNT ? WAYPOINTS_RANGES[range] : 0;
+}
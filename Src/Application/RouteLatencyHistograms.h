@@ -0,0 +1,62 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include "IMapService.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Route computation latencies, one histogram per ( transport mode, waypoint count range ). The buckets
+// are logarithmic, 4 per doubling from 1 ms up to about 4 min, so a percentile is known within 19%
+// with a fixed memory whatever the number of computations.
+class RouteLatencyHistograms
+{
+public:
+    RouteLatencyHistograms();
+
+    void Record( ETransportMode mode, size_t waypointCount, double seconds, bool bSucceeded );
+
+    // the histograms with computations, by mode then waypoint count
+    std::vector<RouteLatencyStats> GetStats() const;
+
+    // one line per non empty bucket, after a header line
+    std::string GetCsv() const;
+
+    void Clear();
+
+private:
+    struct Histogram
+    {
+        Histogram();
+
+        double GetPercentileMs( double percentile ) const;
+
+        std::vector<size_t> buckets;
+        size_t count;
+        size_t failedCount;
+        double maxMs;
+    };
+
+    // ( mode, waypoints range index )
+    using HistogramKey = std::pair<int, size_t>;
+
+    static size_t GetBucket( double ms );
+    static double GetBucketUpperMs( size_t bucket );
+
+    static size_t GetWaypointsRange( size_t waypointCount );
+    static void GetWaypointsRangeBounds( size_t range, size_t& minWaypoints, size_t& maxWaypoints );
+
+private:
+    std::map<HistogramKey, Histogram> m_histograms;
+
+    mutable std::mutex m_sync;
+};
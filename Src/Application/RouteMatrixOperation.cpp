@@ -0,0 +1,226 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "RouteMatrixOperation.h"
+
+#include <numeric>
+
+RouteMatrixOperation::RouteMatrixOperation( RouteMatrixId matrixId, RouteOperationManager& routeOperations, const gem::LandmarkList& origins, const gem::LandmarkList& destinations,
+    const gem::RoutePreferences& preferences, ETransportMode mode, size_t maxParallelRoutes,
+    RouteMatrixCallback callback, RouteMatrixCellCallback cellCallback, const std::vector<size_t>& cells /* = std::vector<size_t>() */ )
+    : m_matrixId( matrixId )
+    , m_routeOperations( routeOperations )
+    , m_origins( origins.begin(), origins.end() )
+    , m_destinations( destinations.begin(), destinations.end() )
+    , m_preferences( preferences )
+    , m_mode( mode )
+    , m_maxParallelRoutes( maxParallelRoutes > 0 ? maxParallelRoutes : 1 )
+    , m_callback( callback )
+    , m_cellCallback( cellCallback )
+    , m_cells( cells )
+    , m_nextCell( 0 )
+    , m_completedCount( 0 )
+    , m_bCancelled( false )
+    , m_bCompleted( false )
+    , m_startTime( std::chrono::steady_clock::now() )
+{
+    m_matrix.originCount = m_origins.size();
+    m_matrix.destinationCount = m_destinations.size();
+    m_matrix.timeSeconds.assign( m_matrix.originCount * m_matrix.destinationCount, -1 );
+    m_matrix.distanceMeters.assign( m_matrix.originCount * m_matrix.destinationCount, -1 );
+
+    if ( m_cells.empty() )
+    {
+        m_cells.resize( m_matrix.timeSeconds.size() );
+        std::iota( m_cells.begin(), m_cells.end(), size_t( 0 ) );
+    }
+}
+
+RouteMatrixOperation::~RouteMatrixOperation()
+{
+
+}
+
+bool RouteMatrixOperation::Tick()
+{
+    const size_t cellCount = m_cells.size();
+
+    // the route operations are started outside the lock, a computation may complete right away
+    for ( ;; )
+    {
+        size_t cell;
+
+        {
+            std::lock_guard<std::mutex> guard( m_sync );
+
+            if ( m_bCancelled || m_nextCell >= cellCount || m_runningCells.size() >= m_maxParallelRoutes )
+                break;
+
+            cell = m_cells[m_nextCell];
+            m_runningCells[cell] = KInvalidRouteOperationId;
+        }
+
+        const auto& origin = m_origins[cell / m_matrix.destinationCount];
+        const auto& destination = m_destinations[cell % m_matrix.destinationCount];
+
+        const auto originCoordinates = origin.getCoordinates();
+        const auto destinationCoordinates = destination.getCoordinates();
+
+        // nothing to route
+        if ( originCoordinates.getLatitude() == destinationCoordinates.getLatitude() && originCoordinates.getLongitude() == destinationCoordinates.getLongitude() )
+        {
+            {
+                std::lock_guard<std::mutex> guard( m_sync );
+                m_nextCell++;
+            }
+
+            SetCell( cell, gem::KNoError, 0, 0 );
+            continue;
+        }
+
+        gem::LandmarkList waypoints;
+        waypoints.push_back( origin );
+        waypoints.push_back( destination );
+
+        auto func = [this, cell]( int reason, gem::String hint, gem::RouteList routes )
+        {
+            OnCellComplete( cell, reason, routes );
+        };
+
+        RouteOperationId operationId;
+        bool bCancelled;
+
+        int err = m_routeOperations.Start( waypoints, m_preferences, m_mode, std::string(), func, operationId, ERouteOperationKind::Background );
+
+        {
+            std::lock_guard<std::mutex> guard( m_sync );
+
+            if ( err == gem::error::KBusy )
+            {
+                // all the route operations are taken, retried on the next Tick
+                m_runningCells.erase( cell );
+                break;
+            }
+
+            m_nextCell++;
+
+            // still running (not completed during Start)
+            auto it = m_runningCells.find( cell );
+            if ( err == gem::KNoError && it != m_runningCells.end() )
+                it->second = operationId;
+
+            bCancelled = m_bCancelled;
+        }
+
+        if ( err != gem::KNoError )
+            OnCellComplete( cell, err, gem::RouteList() );
+        else if ( bCancelled )
+            m_routeOperations.Cancel( operationId );  // Cancel was called during Start
+    }
+
+    bool bCompleted = false;
+
+    {
+        std::lock_guard<std::mutex> guard( m_sync );
+
+        if ( m_bCompleted )
+            return false;
+
+        if ( m_runningCells.empty() && ( m_bCancelled || m_completedCount == cellCount ) )
+        {
+            m_matrix.elapsedSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - m_startTime ).count();
+            m_bCompleted = bCompleted = true;
+        }
+    }
+
+    if ( bCompleted )
+    {
+        int reason = gem::KNoError;
+        if ( m_bCancelled )
+            reason = gem::error::KCancel;
+
+        if ( m_callback )
+            m_callback( m_matrixId, reason, m_matrix );
+
+        return false;
+    }
+
+    return true;
+}
+
+void RouteMatrixOperation::Cancel()
+{
+    std::vector<RouteOperationId> operationIds;
+
+    {
+        std::lock_guard<std::mutex> guard( m_sync );
+
+        if ( m_bCancelled )
+            return;
+
+        m_bCancelled = true;
+
+        for ( const auto& it : m_runningCells )
+            if ( it.second != KInvalidRouteOperationId )
+                operationIds.push_back( it.second );
+    }
+
+    for ( auto operationId : operationIds )
+        m_routeOperations.Cancel( operationId );
+}
+
+void RouteMatrixOperation::OnCellComplete( size_t cell, int reason, const gem::RouteList& routes )
+{
+    int timeSeconds = -1;
+    int distanceMeters = -1;
+
+    if ( reason == gem::KNoError )
+    {
+        // the fastest of the alternatives
+        for ( const auto& route : routes )
+        {
+            auto timeDistance = route.getTimeDistance();
+
+            if ( timeSeconds < 0 || timeDistance.getTotalTime() < timeSeconds )
+            {
+                timeSeconds = timeDistance.getTotalTime();
+                distanceMeters = timeDistance.getTotalDistance();
+            }
+        }
+
+        if ( routes.empty() )
+            reason = gem::error::KNotFound;
+    }
+
+    SetCell( cell, reason, timeSeconds, distanceMeters );
+}
+
+void RouteMatrixOperation::SetCell( size_t cell, int reason, int timeSeconds, int distanceMeters )
+{
+    {
+        std::lock_guard<std::mutex> guard( m_sync );
+
+        m_runningCells.erase( cell );
+
+        // the cells cancelled with the matrix are not reported
+        if ( m_bCancelled && reason == gem::error::KCancel )
+            return;
+
+        m_matrix.timeSeconds[cell] = timeSeconds;
+        m_matrix.distanceMeters[cell] = distanceMeters;
+
+        if ( timeSeconds < 0 )
+            m_matrix.failedCount++;
+
+        m_completedCount++;
+    }
+
+    // streamed, outside the lock
+    if ( m_cellCallback )
+        m_cellCallback( m_matrixId, cell / m_matrix.destinationCount, cell % m_matrix.destinationCount, reason, timeSeconds, distanceMeters );
+}
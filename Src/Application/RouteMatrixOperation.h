@@ -0,0 +1,72 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include "IMapService.h"
+#include "RouteOperationManager.h"
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <vector>
+
+// One ComputeRouteMatrix request: a route computation per ( origin, destination ) cell, started
+// through the route operations at most maxParallelRoutes at a time. The cells neither go through
+// the route cache (n x n two point routes would evict the routes of the views) nor take the route
+// operations kept for the user (background computations). A cell refused because the route
+// operations are busy is retried on the next Tick. When cells are given only those are routed,
+// the others stay -1 (not counted as failed).
+class RouteMatrixOperation
+{
+public:
+    RouteMatrixOperation( RouteMatrixId matrixId, RouteOperationManager& routeOperations, const gem::LandmarkList& origins, const gem::LandmarkList& destinations,
+        const gem::RoutePreferences& preferences, ETransportMode mode, size_t maxParallelRoutes,
+        RouteMatrixCallback callback, RouteMatrixCellCallback cellCallback, const std::vector<size_t>& cells = std::vector<size_t>() );
+    ~RouteMatrixOperation();
+
+    // Starts the next cells, calls the callback once all the cells completed. Returns false
+    // after that (no route computation of this matrix is running anymore).
+    bool Tick();
+
+    // the running cells are cancelled, the callback is called (KCancel) from the next Ticks
+    void Cancel();
+
+private:
+    void OnCellComplete( size_t cell, int reason, const gem::RouteList& routes );
+    void SetCell( size_t cell, int reason, int timeSeconds, int distanceMeters );
+
+private:
+    RouteMatrixId m_matrixId;
+    RouteOperationManager& m_routeOperations;
+
+    std::vector<gem::Landmark> m_origins;
+    std::vector<gem::Landmark> m_destinations;
+
+    gem::RoutePreferences m_preferences;
+    ETransportMode m_mode;
+    size_t m_maxParallelRoutes;
+
+    RouteMatrixCallback m_callback;
+    RouteMatrixCellCallback m_cellCallback;
+
+    RouteMatrix m_matrix;
+    std::vector<size_t> m_cells;    // to route, in order
+
+    size_t m_nextCell;              // in m_cells
+    size_t m_completedCount;
+    std::map<size_t, RouteOperationId> m_runningCells;   // ( cell, route operation )
+
+    bool m_bCancelled;
+    bool m_bCompleted;
+
+    std::chrono::steady_clock::time_point m_startTime;
+
+    std::mutex m_sync;
+};
+using RouteMatrixOperationPtr = std::shared_ptr<RouteMatrixOperation>;
@@ -0,0 +1,274 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "RouteOperationManager.h"
+
+#include "ProgressListenerImpl.h"
+
+#include <API/GEM_OperationScheduler.h>
+
+#include <vector>
+
+// route computations running at the same time
+const size_t MAX_ROUTE_OPERATIONS = 8;
+
+// slots the background computations leave free (when more are allowed), so that they never make a
+// user request busy
+const size_t RESERVED_USER_OPERATIONS = 1;
+
+int RoutingServiceRouteBackend::CalculateRoute( gem::RouteList& routes, const gem::LandmarkList& waypoints, const gem::RoutePreferences& preferences, gem::StrongPointer<gem::IProgressListener> listener )
+{
+    return gem::RoutingService().calculateRoute( routes, waypoints, preferences, listener );
+}
+
+void RoutingServiceRouteBackend::CancelRoute( gem::StrongPointer<gem::IProgressListener> listener )
+{
+    gem::RoutingService().cancelRoute( listener );
+}
+
+//
+// RouteOperationManager
+//
+
+RouteOperationManager::RouteOperationManager( std::unique_ptr<IRouteBackend> backend /* = std::make_unique<RoutingServiceRouteBackend>() */ )
+    : m_backend( std::move( backend ) )
+    , m_nextOperationId( KInvalidRouteOperationId + 1 )
+    , m_maxOperations( MAX_ROUTE_OPERATIONS )
+{
+
+}
+
+RouteOperationManager::~RouteOperationManager()
+{
+    Reset();
+}
+
+void RouteOperationManager::SetMaxOperations( size_t maxOperations )
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    m_maxOperations = maxOperations > 0 ? maxOperations : 1;
+}
+
+size_t RouteOperationManager::GetMaxOperations() const
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    return m_maxOperations;
+}
+
+int RouteOperationManager::Start( const gem::LandmarkList& waypoints, const gem::RoutePreferences& preferences, ETransportMode mode, const std::string& cacheKey, ComputeRoutesCallback callback, RouteOperationId& operationId, ERouteOperationKind kind /* = ERouteOperationKind::User */ )
+{
+    operationId = KInvalidRouteOperationId;
+
+    auto operation = std::make_shared<Operation>( callback, mode, waypoints.size(), kind == ERouteOperationKind::User, cacheKey, m_cache.GetGeneration() );
+    RouteOperationId newOperationId;
+
+    {
+        std::lock_guard<std::mutex> guard( m_sync );
+
+        size_t maxOperations = m_maxOperations;
+        if ( kind == ERouteOperationKind::Background && maxOperations > RESERVED_USER_OPERATIONS )
+            maxOperations -= RESERVED_USER_OPERATIONS;
+
+        if ( GetRunningCount() >= maxOperations )
+            return gem::error::KBusy;
+
+        operation->bFromCache = !cacheKey.empty() && m_cache.Find( cacheKey, operation->routes );
+
+        newOperationId = m_nextOperationId++;
+
+        auto func = [this, newOperationId]( int reason, gem::String hint )
+        {
+            OnComplete( newOperationId, reason, hint );
+        };
+
+        operation->listener = gem::StrongPointerFactory<ProgressListenerImpl>( func );
+
+        // registered before the computation starts, the SDK may complete it right away
+        m_operations[newOperationId] = operation;
+    }
+
+    if ( operation->bFromCache )
+    {
+        auto completeFunc = [this, newOperationId]()
+        {
+            OnComplete( newOperationId, gem::KNoError, gem::String() );
+        };
+
+        // the callback never runs before ComputeRoutes returns, as for a computation
+        if ( gem::OperationScheduler().timeoutOperation( 0, completeFunc, gem::ProgressListener(), true ) == gem::KNoError )
+        {
+            operationId = newOperationId;
+            return gem::KNoError;
+        }
+
+        std::lock_guard<std::mutex> guard( m_sync );
+        operation->bFromCache = false;
+        operation->routes.clear();
+    }
+
+    operation->startTime = std::chrono::steady_clock::now();
+
+    int err = m_backend->CalculateRoute( operation->routes, waypoints, preferences, operation->listener );
+
+    if ( err != gem::KNoError )
+    {
+        // no completion follows a failed start
+        std::lock_guard<std::mutex> guard( m_sync );
+        m_operations.erase( newOperationId );
+
+        return err;
+    }
+
+    operationId = newOperationId;
+
+    return gem::KNoError;
+}
+
+bool RouteOperationManager::Cancel( RouteOperationId operationId )
+{
+    gem::StrongPointer<gem::IProgressListener> listener;
+
+    {
+        std::lock_guard<std::mutex> guard( m_sync );
+
+        auto it = m_operations.find( operationId );
+        if ( it == m_operations.end() || it->second->bCancelled )
+            return false;
+
+        it->second->bCancelled = true;
+
+        // a cache hit has no computation to cancel, it completes with the cancel reason
+        if ( !it->second->bFromCache )
+            listener = it->second->listener;
+    }
+
+    // the SDK completes the computation, with the cancel reason
+    if ( listener )
+        m_backend->CancelRoute( listener );
+
+    return true;
+}
+
+void RouteOperationManager::CancelAll()
+{
+    std::vector<RouteOperationId> operationIds;
+
+    {
+        std::lock_guard<std::mutex> guard( m_sync );
+
+        for ( const auto& it : m_operations )
+            operationIds.push_back( it.first );
+    }
+
+    for ( auto operationId : operationIds )
+        Cancel( operationId );
+}
+
+void RouteOperationManager::Reset()
+{
+    std::vector<gem::StrongPointer<gem::IProgressListener>> listeners;
+
+    {
+        std::lock_guard<std::mutex> guard( m_sync );
+
+        for ( const auto& it : m_operations )
+            if ( !it.second->bFromCache && !it.second->bCancelled )
+                listeners.push_back( it.second->listener );
+
+        // the completions still to come find no operation
+        m_operations.clear();
+    }
+
+    for ( const auto& listener : listeners )
+        m_backend->CancelRoute( listener );
+}
+
+bool RouteOperationManager::IsRunning( RouteOperationId operationId ) const
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    auto it = m_operations.find( operationId );
+
+    return it != m_operations.end() && !it->second->bCancelled;
+}
+
+size_t RouteOperationManager::GetCount() const
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    return GetRunningCount();
+}
+
+void RouteOperationManager::OnComplete( RouteOperationId operationId, int reason, gem::String hint )
+{
+    OperationPtr operation;
+
+    {
+        std::lock_guard<std::mutex> guard( m_sync );
+
+        auto it = m_operations.find( operationId );
+        if ( it == m_operations.end() )
+            return;
+
+        operation = it->second;
+        m_operations.erase( it );
+    }
+
+    if ( operation->bCancelled )
+    {
+        operation->routes.clear();
+        reason = gem::error::KCancel;
+    }
+    else if ( !operation->bFromCache )
+    {
+        double computeSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - operation->startTime ).count();
+
+        if ( operation->bRecordLatency )
+            m_latencies.Record( operation->mode, operation->waypointCount, computeSeconds, reason == gem::KNoError );
+
+        if ( reason == gem::KNoError && !operation->routes.empty() )
+            m_cache.Insert( operation->cacheKey, operation->routes, computeSeconds, operation->cacheGeneration );
+    }
+
+    // outside the lock, the callback may start a new computation
+    if ( operation->callback )
+        operation->callback( reason, hint, operation->routes );
+}
+
+RouteCache& RouteOperationManager::GetCache()
+{
+    return m_cache;
+}
+
+const RouteCache& RouteOperationManager::GetCache() const
+{
+    return m_cache;
+}
+
+RouteLatencyHistograms& RouteOperationManager::GetLatencies()
+{
+    return m_latencies;
+}
+
+const RouteLatencyHistograms& RouteOperationManager::GetLatencies() const
+{
+    return m_latencies;
+}
+
+size_t RouteOperationManager::GetRunningCount() const
+{
+    size_t count = 0;
+
+    for ( const auto& it : m_operations )
+        if ( !it.second->bCancelled )
+            count++;
+
+    return count;
+}
@@ -0,0 +1,134 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include "IMapService.h"
+#include "RouteCache.h"
+#include "RouteLatencyHistograms.h"
+
+#include <API/GEM_RoutingService.h>
+
+#include <map>
+#include <mutex>
+#include <memory>
+
+// The routing calls of the route operations (a stand-in router can simulate the computations).
+// They are never made under the route operations lock: the completion may be notified from within.
+class IRouteBackend
+{
+public:
+    virtual int CalculateRoute( gem::RouteList& routes, const gem::LandmarkList& waypoints, const gem::RoutePreferences& preferences, gem::StrongPointer<gem::IProgressListener> listener ) = 0;
+    virtual void CancelRoute( gem::StrongPointer<gem::IProgressListener> listener ) = 0;
+
+    virtual ~IRouteBackend() = default;
+};
+
+// gem::RoutingService computations
+class RoutingServiceRouteBackend : public IRouteBackend
+{
+public:
+    int CalculateRoute( gem::RouteList& routes, const gem::LandmarkList& waypoints, const gem::RoutePreferences& preferences, gem::StrongPointer<gem::IProgressListener> listener ) override;
+    void CancelRoute( gem::StrongPointer<gem::IProgressListener> listener ) override;
+};
+
+// Who a route computation is for: the background ones (e.g. route matrix cells) are neither
+// recorded in the latency histograms nor allowed to take the last operation slots
+enum class ERouteOperationKind
+{
+    User,
+    Background
+};
+
+// The running route computations: each calculateRoute call gets its own id, route list, progress
+// listener and callback, so several of them (e.g. one per vehicle) run at the same time and can be
+// cancelled one by one.
+class RouteOperationManager
+{
+public:
+    RouteOperationManager( std::unique_ptr<IRouteBackend> backend = std::make_unique<RoutingServiceRouteBackend>() );
+    ~RouteOperationManager();
+
+    // KBusy is returned by Start when this many computations are running, or for a background one
+    // when only the slots kept for the user computations are left
+    void SetMaxOperations( size_t maxOperations );
+    size_t GetMaxOperations() const;
+
+    // On success operationId identifies the computation until its callback is called. Routes found
+    // in the cache under cacheKey (if not empty) are delivered asynchronously, like computed ones.
+    int Start( const gem::LandmarkList& waypoints, const gem::RoutePreferences& preferences, ETransportMode mode, const std::string& cacheKey, ComputeRoutesCallback callback, RouteOperationId& operationId, ERouteOperationKind kind = ERouteOperationKind::User );
+
+    // the callback is still called, with the cancel reason
+    bool Cancel( RouteOperationId operationId );
+    void CancelAll();
+
+    // cancels all the computations without calling their callbacks (their owners go away)
+    void Reset();
+
+    bool IsRunning( RouteOperationId operationId ) const;
+
+    // cancelled computations not counted
+    size_t GetCount() const;
+
+    RouteCache& GetCache();
+    const RouteCache& GetCache() const;
+
+    // the computations completed by the SDK (not the cache hits, not the cancelled ones, not the
+    // background ones)
+    RouteLatencyHistograms& GetLatencies();
+    const RouteLatencyHistograms& GetLatencies() const;
+
+private:
+    struct Operation
+    {
+        Operation( ComputeRoutesCallback callback_, ETransportMode mode_, size_t waypointCount_, bool bRecordLatency_, const std::string& cacheKey_, size_t cacheGeneration_ )
+            : callback( callback_ )
+            , bCancelled( false )
+            , mode( mode_ )
+            , waypointCount( waypointCount_ )
+            , bRecordLatency( bRecordLatency_ )
+            , cacheKey( cacheKey_ )
+            , cacheGeneration( cacheGeneration_ )
+            , bFromCache( false )
+            , startTime( std::chrono::steady_clock::now() )
+        {}
+
+        gem::RouteList routes;
+        gem::StrongPointer<gem::IProgressListener> listener;
+        ComputeRoutesCallback callback;
+        bool bCancelled;
+
+        ETransportMode mode;
+        size_t waypointCount;
+        bool bRecordLatency;
+
+        std::string cacheKey;
+        size_t cacheGeneration;
+        bool bFromCache;
+        std::chrono::steady_clock::time_point startTime;   // calculateRoute call
+    };
+    using OperationPtr = std::shared_ptr<Operation>;
+
+    void OnComplete( RouteOperationId operationId, int reason, gem::String hint );
+
+    // lock held
+    size_t GetRunningCount() const;
+
+private:
+    std::unique_ptr<IRouteBackend> m_backend;
+
+    std::map<RouteOperationId, OperationPtr> m_operations;
+
+    RouteCache m_cache;
+    RouteLatencyHistograms m_latencies;
+
+    RouteOperationId m_nextOperationId;
+    size_t m_maxOperations;
+
+    mutable std::mutex m_sync;
+};
@@ -31,6 +31,9 @@ void RoutesView::OnEvent( EVmEvent event )
     {
     case EVmEvent::Generic_ChangedConnection:
         break;
+    case EVmEvent::Routes_ComputeFailed:
+        m_parentWindow->ShowMessage( "Error", "The routes could not be computed (error %d).", m_viewModel->GetComputeError() );
+        break;
     default:
         BaseView::OnEvent( event );
         break;
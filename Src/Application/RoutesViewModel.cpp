@@ -4,9 +4,30 @@
 
 #include "API/GEM_ImageIDs.h"
 
+#include <cmath>
+
+// a dragged waypoint resting this long gets its routes computed
+const std::chrono::milliseconds SPECULATION_DEBOUNCE( 250 );
+
+// a dropped waypoint this close (degrees) to the speculated position uses its routes
+const double SPECULATION_TOLERANCE_DEGREES = 0.0001;
+
+// the last computed routes, in the cache dir, shown again when the view opens
+static const char* const LAST_ROUTES_FILE = "LastRoutes.dat";
+
 RoutesViewModel::RoutesViewModel( IMapService* mapService, INavigationService* navigationService, IViewModelListener* listener )
     : BaseViewModel( mapService, navigationService, listener )
     , m_state( ERoutesState::PoiSelection )
+    , m_routeOperationId( KInvalidRouteOperationId )
+    , m_waypointOrderId( KInvalidWaypointOrderId )
+    , m_computeError( gem::KNoError )
+    , m_bSimulateWhenComputed( false )
+    , m_bDragMoved( false )
+    , m_speculation( 0 )
+    , m_speculativeOperationId( KInvalidRouteOperationId )
+    , m_bSpeculationReady( false )
+    , m_bSpeculationAdopted( false )
+    , m_bAlive( std::make_shared<bool>( true ) )
 {
     m_waypoints.push_back( gem::Landmark( "Departure", { 45.65119, 25.60480 } )
         .setImage( gem::image::Core::Waypoint_Start ) );
@@ -16,12 +37,29 @@ RoutesViewModel::RoutesViewModel( IMapService* mapService, INavigationService* n
 
     UpdateMenuItems();
 
-    m_mapView->DisplayLandmarks( m_waypoints, true );
+    if ( !RestoreRoutes() )
+        m_mapView->DisplayLandmarks( m_waypoints, true );
+}
+
+RoutesViewModel::~RoutesViewModel()
+{
+    // the cancelled computations complete later (or right away), their callbacks are ignored
+    m_bAlive.reset();
+
+    if ( m_waypointOrderId != KInvalidWaypointOrderId )
+        GetMapService()->CancelWaypointOrder( m_waypointOrderId );
+
+    if ( m_routeOperationId != KInvalidRouteOperationId )
+        GetMapService()->CancelComputeRoutes( m_routeOperationId );
+
+    // the same computation once adopted
+    if ( m_speculativeOperationId != KInvalidRouteOperationId && m_speculativeOperationId != m_routeOperationId )
+        GetMapService()->CancelComputeRoutes( m_speculativeOperationId );
 }
 
 void RoutesViewModel::Scroll( int delta, Xy xy )
 {
-    if ( m_state == ERoutesState::RoutesComputed )
+    if ( m_state == ERoutesState::RoutesComputed || m_state == ERoutesState::RoutesRestored )
         return;
 
     BaseViewModel::Scroll( delta, xy );
@@ -41,9 +79,14 @@ void RoutesViewModel::UpdateMenuItems()
             m_mapView->DeactivateAllHighlights();
             m_navigationService->GoToView( EView::Main ); 
         };
+        auto func3 = [&]()
+        {
+            AddStop();
+        };
 
         SetMenuItems( {
             { "Compute routes", func1 },
+            { "Add stop", func3 },
             { "Main", func2 },
             } );
 
@@ -83,9 +126,36 @@ void RoutesViewModel::UpdateMenuItems()
 
         break;
     }
+    case ERoutesState::RoutesRestored:
+    {
+        auto func1 = [&]() { StartRestoredSimulation(); };
+        auto func2 = [&]()
+        {
+            m_mapView->ClearRoutes();
+            m_mapView->DisplayLandmarks( m_waypoints, true );
+            SetState( ERoutesState::PoiSelection );
+        };
+        auto func3 = [&]() {
+            m_mapView->ClearRoutes();
+            m_navigationService->GoToView( EView::Main );
+        };
+
+        SetMenuItems( {
+            { "Start simulation", func1 },
+            { "Clear routes", func2 },
+            { "Main", func3 },
+            } );
+
+        break;
+    }
     }
 }
 
+int RoutesViewModel::GetComputeError() const
+{
+    return m_computeError;
+}
+
 void RoutesViewModel::Touch( ETouchEvent event, LargeInteger fingerId, Xy xy )
 {
     if ( m_state == ERoutesState::PoiSelection )
@@ -97,14 +167,23 @@ void RoutesViewModel::Touch( ETouchEvent event, LargeInteger fingerId, Xy xy )
             gem::Xy gemXy( xy.x, xy.y );
 
             if ( m_selectedWaypoint = m_mapView->SelectWaypoint( GetDepartureArrivalLandmarks(), gemXy ) )
+            {
+                CancelSpeculation();
                 return;
+            }
 
             break;
         }
         case ETouchEvent::TE_Move:
         {
             if ( m_selectedWaypoint )
+            {
+                // debounced in BeforeViewRender
+                m_bDragMoved = true;
+                m_dragXy = xy;
+                m_dragMoveTime = std::chrono::steady_clock::now();
                 return;
+            }
 
             break;
         }
@@ -117,8 +196,29 @@ void RoutesViewModel::Touch( ETouchEvent event, LargeInteger fingerId, Xy xy )
 
                 m_selectedWaypoint->setCoordinates( gemCoordinates );
                 m_selectedWaypoint = nullptr;
+                m_bDragMoved = false;
 
                 m_mapView->DisplayLandmarks( GetDepartureArrivalLandmarks(), false );
+
+                if ( !IsSpeculationMatching() )
+                {
+                    CancelSpeculation();
+                }
+                else if ( m_bSpeculationReady )
+                {
+                    gem::RouteList routes = m_speculativeRoutes;
+                    CancelSpeculation();
+
+                    OnRoutesComputed( gem::KNoError, routes );
+                }
+                else
+                {
+                    // shown once computed, "Abort computation" cancels it
+                    m_bSpeculationAdopted = true;
+                    m_routeOperationId = m_speculativeOperationId;
+                    SetState( ERoutesState::RoutesComputing );
+                }
+
                 return;
             }
 
@@ -127,6 +227,9 @@ void RoutesViewModel::Touch( ETouchEvent event, LargeInteger fingerId, Xy xy )
         }
     }
 
+    if ( m_state == ERoutesState::RoutesRestored )
+        return;
+
     if ( m_state == ERoutesState::RoutesComputed )
     {
         if ( gem::Route route = m_mapView->SelectRoute( gem::Xy( xy.x, xy.y ) ) )
@@ -140,6 +243,24 @@ void RoutesViewModel::Touch( ETouchEvent event, LargeInteger fingerId, Xy xy )
     BaseViewModel::Touch( event, fingerId, xy );
 }
 
+void RoutesViewModel::BeforeViewRender()
+{
+    if ( m_bDragMoved && m_selectedWaypoint && std::chrono::steady_clock::now() - m_dragMoveTime >= SPECULATION_DEBOUNCE )
+    {
+        m_bDragMoved = false;
+        StartSpeculation();
+    }
+
+    BaseViewModel::BeforeViewRender();
+
+    // the restored routes computed again, the simulation starts after this frame
+    if ( m_bSimulateWhenComputed && m_state == ERoutesState::RoutesComputed )
+    {
+        m_bSimulateWhenComputed = false;
+        m_action = [&]() { m_navigationService->GoToView( EView::Navigation ); };
+    }
+}
+
 gem::LandmarkList RoutesViewModel::GetDepartureArrivalLandmarks() const
 {
     return m_waypoints;
@@ -150,37 +271,262 @@ void RoutesViewModel::UpdateWaypointCoordinates( int index, gem::Coordinates coo
     m_waypoints.toStd().at( index ).setCoordinates( coordinates );
 }
 
+void RoutesViewModel::AddStop()
+{
+    auto& waypoints = m_waypoints.toStd();
+
+    auto from = waypoints[waypoints.size() - 2].getCoordinates();
+    auto to = waypoints.back().getCoordinates();
+
+    gem::Landmark stop = gem::Landmark( "Stop", { ( from.getLatitude() + to.getLatitude() ) / 2, ( from.getLongitude() + to.getLongitude() ) / 2 } )
+        .setImage( gem::image::Core::Waypoint_Intermediate );
+
+    // a speculation for the previous waypoints is stale
+    CancelSpeculation();
+
+    waypoints.insert( waypoints.end() - 1, stop );
+
+    m_mapView->DisplayLandmarks( m_waypoints, false );
+}
+
 void RoutesViewModel::ComputeRoutes()
 {
     SetState( ERoutesState::RoutesComputing );
 
-    int err = GetMapService()->ComputeRoutes( m_waypoints, [&]( int reason, gem::String hint, gem::RouteList routes )
+    // nothing to reorder with less than 2 intermediate stops
+    if ( m_waypoints.size() < 4 )
+    {
+        StartComputeRoutes();
+        return;
+    }
+
+    std::weak_ptr<bool> alive = m_bAlive;
+
+    int err = GetMapService()->OptimizeWaypointOrder( m_waypoints, [this, alive]( int reason, gem::LandmarkList waypoints, const WaypointOrderReport& report )
         {
+            if ( !alive.lock() )
+                return;
+
+            // aborted meanwhile
+            if ( m_waypointOrderId == KInvalidWaypointOrderId || reason == gem::error::KCancel )
+                return;
+
+            m_waypointOrderId = KInvalidWaypointOrderId;
+
             if ( reason == gem::KNoError )
-            {
-                if ( !routes.empty() )
-                    m_mapView->DisplayRoutes( routes );
+                m_waypoints = waypoints;
 
-                SetState( routes.empty() ? ERoutesState::PoiSelection : ERoutesState::RoutesComputed );
-            }
-            else
-            {
-                SetState( ERoutesState::PoiSelection );
-                // DisplayMessage( "Error", "Route calculation error: %d %s", reason, hint.toStdString().c_str() );
-            }
-        } );
+            StartComputeRoutes();
+        }, ETransportMode::Car, &m_waypointOrderId );
+
+    if ( err != gem::KNoError )
+    {
+        m_waypointOrderId = KInvalidWaypointOrderId;
+        StartComputeRoutes();
+    }
+}
+
+void RoutesViewModel::StartComputeRoutes()
+{
+    std::weak_ptr<bool> alive = m_bAlive;
+
+    int err = GetMapService()->ComputeRoutes( m_waypoints, [this, alive]( int reason, gem::String hint, gem::RouteList routes )
+        {
+            if ( !alive.lock() )
+                return;
+
+            m_routeOperationId = KInvalidRouteOperationId;
+
+            OnRoutesComputed( reason, routes );
+        }, ETransportMode::Car, &m_routeOperationId );
 
 
     if ( err != gem::KNoError )
+        OnComputeFailed( err );
+}
+
+void RoutesViewModel::CancelComputeRoutes()
+{
+    // the route matrix of the waypoints is cancelled with it
+    if ( m_waypointOrderId != KInvalidWaypointOrderId )
     {
+        GetMapService()->CancelWaypointOrder( m_waypointOrderId );
+        m_waypointOrderId = KInvalidWaypointOrderId;
+
         SetState( ERoutesState::PoiSelection );
-        // DisplayMessage( "Error", "Route calculation error: %d", err );
+        return;
     }
+
+    // only ours, other computations may be running
+    GetMapService()->CancelComputeRoutes( m_routeOperationId );
 }
 
-void RoutesViewModel::CancelComputeRoutes()
+void RoutesViewModel::OnRoutesComputed( int reason, const gem::RouteList& routes )
+{
+    if ( reason == gem::KNoError )
+    {
+        if ( !routes.empty() )
+        {
+            m_mapView->DisplayRoutes( routes );
+            GetMapService()->SaveRoutes( GetMapService()->GetCacheFilePath( LAST_ROUTES_FILE ), routes );
+        }
+
+        if ( routes.empty() )
+            OnComputeFailed( gem::error::KNotFound );
+        else
+            SetState( ERoutesState::RoutesComputed );
+    }
+    else if ( reason == gem::error::KCancel )
+    {
+        m_bSimulateWhenComputed = false;
+        SetState( ERoutesState::PoiSelection );
+    }
+    else
+    {
+        OnComputeFailed( reason );
+    }
+}
+
+void RoutesViewModel::OnComputeFailed( int reason )
+{
+    // a restored routes preview
+    m_mapView->ClearRoutes();
+
+    m_computeError = reason;
+    m_bSimulateWhenComputed = false;
+    SetState( ERoutesState::PoiSelection );
+
+    m_listener->OnEvent( EVmEvent::Routes_ComputeFailed );
+}
+
+bool RoutesViewModel::RestoreRoutes()
+{
+    StoredRoutes storedRoutes;
+
+    if ( GetMapService()->LoadRoutes( GetMapService()->GetCacheFilePath( LAST_ROUTES_FILE ), storedRoutes ) != gem::KNoError || storedRoutes.waypoints.size() < 2 )
+        return false;
+
+    m_waypoints = storedRoutes.waypoints;
+
+    for ( auto& waypoint : m_waypoints.toStd() )
+        waypoint.setImage( gem::image::Core::Waypoint_Intermediate );
+
+    m_waypoints.toStd().front().setImage( gem::image::Core::Waypoint_Start );
+    m_waypoints.toStd().back().setImage( gem::image::Core::Waypoint_Finish );
+
+    m_mapView->DisplayLandmarks( m_waypoints, true );
+
+    // computed on older maps, only the waypoints are kept
+    if ( storedRoutes.bOutdated )
+        return true;
+
+    std::vector<std::vector<gem::Coordinates>> polylines;
+
+    for ( const auto& route : storedRoutes.routes )
+        polylines.push_back( route.polyline );
+
+    m_mapView->DisplayRoutePreview( polylines );
+    SetState( ERoutesState::RoutesRestored );
+
+    return true;
+}
+
+void RoutesViewModel::StartRestoredSimulation()
 {
-    GetMapService()->CancelComputeRoutes();
+    // the navigation needs the SDK routes, they replace the preview once computed
+    m_bSimulateWhenComputed = true;
+
+    SetState( ERoutesState::RoutesComputing );
+    StartComputeRoutes();
+}
+
+void RoutesViewModel::StartSpeculation()
+{
+    // the stops would be reordered first
+    if ( m_waypoints.size() >= 4 )
+        return;
+
+    // the previous position is stale
+    CancelSpeculation();
+
+    Coordinates coordinates = m_mapView->GetXyWgsPosition( m_dragXy );
+
+    // new landmarks, the waypoints themselves move only when dropped
+    gem::LandmarkList waypoints;
+
+    for ( size_t index = 0; index < m_waypoints.size(); index++ )
+    {
+        const auto& waypoint = m_waypoints.toStd()[index];
+
+        gem::Coordinates waypointCoordinates = waypoint.getCoordinates();
+        if ( &waypoint == m_selectedWaypoint )
+            waypointCoordinates = gem::Coordinates( coordinates.latitude, coordinates.longitude );
+
+        gem::Landmark landmark;
+        landmark.setCoordinates( waypointCoordinates );
+
+        waypoints.push_back( landmark );
+        m_speculativeCoordinates.push_back( waypointCoordinates );
+    }
+
+    size_t speculation = m_speculation;
+    std::weak_ptr<bool> alive = m_bAlive;
+
+    int err = GetMapService()->ComputeRoutes( waypoints, [this, alive, speculation]( int reason, gem::String hint, gem::RouteList routes )
+        {
+            // the view model is gone, cancelled or superseded
+            if ( !alive.lock() || speculation != m_speculation )
+                return;
+
+            m_speculativeOperationId = KInvalidRouteOperationId;
+
+            if ( m_bSpeculationAdopted )
+            {
+                m_bSpeculationAdopted = false;
+                m_routeOperationId = KInvalidRouteOperationId;
+
+                OnRoutesComputed( reason, routes );
+                return;
+            }
+
+            m_bSpeculationReady = reason == gem::KNoError && !routes.empty();
+            m_speculativeRoutes = routes;
+        }, ETransportMode::Car, &m_speculativeOperationId );
+
+    if ( err != gem::KNoError )
+        m_speculativeOperationId = KInvalidRouteOperationId;
+}
+
+void RoutesViewModel::CancelSpeculation()
+{
+    m_speculation++;
+
+    if ( m_speculativeOperationId != KInvalidRouteOperationId )
+        GetMapService()->CancelComputeRoutes( m_speculativeOperationId );
+
+    m_speculativeOperationId = KInvalidRouteOperationId;
+    m_speculativeCoordinates.clear();
+    m_speculativeRoutes.clear();
+    m_bSpeculationReady = false;
+    m_bSpeculationAdopted = false;
+}
+
+bool RoutesViewModel::IsSpeculationMatching() const
+{
+    if ( m_speculativeCoordinates.size() != m_waypoints.size() || ( !m_bSpeculationReady && m_speculativeOperationId == KInvalidRouteOperationId ) )
+        return false;
+
+    for ( size_t index = 0; index < m_waypoints.size(); index++ )
+    {
+        const auto& speculated = m_speculativeCoordinates[index];
+        auto current = m_waypoints.toStd()[index].getCoordinates();
+
+        if ( std::fabs( speculated.getLatitude() - current.getLatitude() ) > SPECULATION_TOLERANCE_DEGREES ||
+            std::fabs( speculated.getLongitude() - current.getLongitude() ) > SPECULATION_TOLERANCE_DEGREES )
+            return false;
+    }
+
+    return true;
 }
 
 void RoutesViewModel::SetState( ERoutesState state )
@@ -5,31 +5,62 @@
 #include "API/GEM_Landmark.h"
 #include "API/GEM_ApiLists.h"
 
+#include <chrono>
+#include <memory>
+
 enum class ERoutesState
 {
     PoiSelection,
     RoutesComputing,
-    RoutesComputed
+    RoutesComputed,
+    RoutesRestored      // the stored routes shown, computed when the simulation starts
 };
 
 class RoutesViewModel : public BaseViewModel
 {
 public:
     RoutesViewModel( IMapService* mapService, INavigationService* navigationService, IViewModelListener* listener );
+    ~RoutesViewModel();
 
     void Scroll( int delta, Xy xy );
 
     void UpdateMenuItems();
 
+    // of the last failed route computation (Routes_ComputeFailed)
+    int GetComputeError() const;
+
 private:
     void Touch( ETouchEvent event, LargeInteger fingerId, Xy xy ) override;
 
+    void BeforeViewRender() override;
+
     gem::LandmarkList GetDepartureArrivalLandmarks() const;
     void UpdateWaypointCoordinates( int index, gem::Coordinates coordinates );
 
+    // a stop halfway between the last stop (or the departure) and the arrival, dragged from there
+    void AddStop();
+
+    // the stops between the departure and the arrival are reordered first
     void ComputeRoutes();
+    void StartComputeRoutes();
     void CancelComputeRoutes();
 
+    void OnRoutesComputed( int reason, const gem::RouteList& routes );
+
+    // back to the waypoints selection, the view shows the error
+    void OnComputeFailed( int reason );
+
+    // the last computed routes are shown from their file, they are computed again (for the
+    // navigation) only if the simulation is started
+    bool RestoreRoutes();
+    void StartRestoredSimulation();
+
+    // While a waypoint is dragged, the routes are computed in the background for its position once
+    // it rests for a moment; dropping it where the routes were computed shows them right away.
+    void StartSpeculation();
+    void CancelSpeculation();
+    bool IsSpeculationMatching() const;
+
 private:
     void SetState( ERoutesState state );
 
@@ -38,4 +69,24 @@ private:
 
     gem::LandmarkList m_waypoints;
     gem::Landmark* m_selectedWaypoint;
+
+    RouteOperationId m_routeOperationId;
+    WaypointOrderId m_waypointOrderId;
+    int m_computeError;
+    bool m_bSimulateWhenComputed;
+
+    // Speculative routes
+    bool m_bDragMoved;
+    Xy m_dragXy;
+    std::chrono::steady_clock::time_point m_dragMoveTime;
+
+    size_t m_speculation;               // changed by each start / cancel, the older results are dropped
+    RouteOperationId m_speculativeOperationId;
+    std::vector<gem::Coordinates> m_speculativeCoordinates;
+    gem::RouteList m_speculativeRoutes;
+    bool m_bSpeculationReady;
+    bool m_bSpeculationAdopted;         // dropped while computing, shown once computed
+
+    // shared with the map service callbacks, which may come after the view model is deleted
+    std::shared_ptr<bool> m_bAlive;
 };
@@ -10,6 +10,7 @@
 
 #include <API/GEM_Sdk.h>
 #include <API/GEM_Traffic.h>
+#include <API/GEM_MapDetails.h>
 
 #include <string>
 #include <Windows.h>
@@ -52,7 +53,7 @@ int SDKUtils::InitSDK( std::string logFile )
     if (resPath.empty())
         return gem::error::KNotFound;
 
-    std::string cachePath = GetCachePath();
+    cachePath = ::GetCachePath();
     if (cachePath.empty())
         return gem::error::KNotFound;
 
@@ -73,7 +74,28 @@ void SDKUtils::Tick()
     apiTimer->Tick();
 }
 
+const std::string& SDKUtils::GetCachePath() const
+{
+    return cachePath;
+}
+
 void SDKUtils::ReleaseSDK()
 {
     gem::Sdk::release();
 }
+
+std::string SDKUtils::CombinePath( const std::string& dir, const std::string& fileName )
+{
+    char path[MAX_PATH];
+    if ( !PathCombineA( path, dir.c_str(), fileName.c_str() ) )
+        return std::string();
+
+    return path;
+}
+
+unsigned long long SDKUtils::GetMapVersion()
+{
+    gem::Version version = gem::MapDetails().getMapVersion();
+
+    return ( (unsigned long long)version.major << 32 ) | (unsigned int)version.minor;
+}
@@ -24,8 +24,19 @@ public:
 
     void ReleaseSDK();
 
+    // dir of the SDK cache, set by InitSDK
+    const std::string& GetCachePath() const;
+
+    // fileName in dir (e.g. the cache path), empty if the path is too long
+    static std::string CombinePath( const std::string& dir, const std::string& fileName );
+
+    // version of the road map data ( major << 32 | minor ), changed by the map updates
+    static unsigned long long GetMapVersion();
+
 private:
     gem::StrongPointer<ApiCallLoggerImpl> apiLogger;
     gem::StrongPointer<TimerServiceImpl> apiTimer;
+
+    std::string cachePath;
 };
 
@@ -0,0 +1,99 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+// An immutable value published to the readers: a reader takes the current snapshot with a single
+// atomic load (no lock) and keeps it alive for as long as it uses it. Writers (build, replace,
+// modify, invalidate) are serialized; an invalidated snapshot is rebuilt by the next reader.
+template<class T>
+class SnapshotSlot
+{
+public:
+    using Ptr = std::shared_ptr<const T>;
+
+    SnapshotSlot() = default;
+
+    SnapshotSlot( const SnapshotSlot& ) = delete;
+    SnapshotSlot& operator=( const SnapshotSlot& ) = delete;
+
+    // nullptr while invalidated
+    Ptr Load() const
+    {
+        return std::atomic_load( &m_snapshot );
+    }
+
+    // the current snapshot, built first if invalidated
+    Ptr Get( const std::function<Ptr()>& buildFunc )
+    {
+        Ptr snapshot = Load();
+        if ( snapshot )
+            return snapshot;
+
+        std::lock_guard<std::mutex> guard( m_writeSync );
+
+        // built by another reader meanwhile
+        snapshot = Load();
+        if ( !snapshot )
+        {
+            snapshot = buildFunc();
+            std::atomic_store( &m_snapshot, snapshot );
+        }
+
+        return snapshot;
+    }
+
+    // publishes 'snapshot' in place of 'expected'; false (nothing published) if 'expected' was
+    // invalidated or replaced meanwhile
+    bool Replace( const Ptr& expected, Ptr snapshot )
+    {
+        std::lock_guard<std::mutex> guard( m_writeSync );
+
+        if ( Load() != expected )
+            return false;
+
+        std::atomic_store( &m_snapshot, std::move( snapshot ) );
+
+        return true;
+    }
+
+    // publishes a modified copy of the current snapshot, readers holding the previous version keep it
+    // alive until they are done; false (nothing published) if the snapshot is invalidated
+    bool Modify( const std::function<void( T& )>& modifyFunc )
+    {
+        std::lock_guard<std::mutex> guard( m_writeSync );
+
+        Ptr current = Load();
+        if ( !current )
+            return false;
+
+        auto snapshot = std::make_shared<T>( *current );
+        modifyFunc( *snapshot );
+
+        std::atomic_store( &m_snapshot, Ptr( std::move( snapshot ) ) );
+
+        return true;
+    }
+
+    // waits for a build in progress, which would publish outdated data otherwise
+    void Invalidate()
+    {
+        std::lock_guard<std::mutex> guard( m_writeSync );
+
+        std::atomic_store( &m_snapshot, Ptr() );
+    }
+
+private:
+    Ptr m_snapshot;
+    std::mutex m_writeSync;
+};
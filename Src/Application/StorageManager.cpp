@@ -0,0 +1,212 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "StorageManager.h"
+
+#include "IResourceRepository.h"
+
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+
+static long long GetUnixTime()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>( std::chrono::system_clock::now().time_since_epoch() ).count();
+}
+
+StorageManager::StorageManager()
+    : m_quotaBytes( 0 )
+{
+
+}
+
+StorageManager::~StorageManager()
+{
+
+}
+
+void StorageManager::Open( const std::string& filePath )
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    m_filePath = filePath;
+    m_lastUsed.clear();
+
+    // one "item id, last use time" pair per line
+    std::ifstream file( m_filePath );
+
+    gem::LargeInteger itemId;
+    long long lastUsed;
+
+    while ( file >> itemId >> lastUsed )
+        m_lastUsed[itemId] = lastUsed;
+}
+
+void StorageManager::SetQuota( gem::LargeInteger quotaBytes )
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    m_quotaBytes = quotaBytes;
+}
+
+gem::LargeInteger StorageManager::GetQuota() const
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    return m_quotaBytes;
+}
+
+void StorageManager::MarkItemUsed( gem::LargeInteger itemId )
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    m_lastUsed[itemId] = GetUnixTime();
+
+    Save();
+}
+
+void StorageManager::MarkCountriesUsed( const ContentCatalog& catalog, const std::vector<gem::String>& isos )
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    long long now = GetUnixTime();
+
+    for ( const auto& iso : isos )
+        for ( auto index : catalog.GetItemsByIso( iso ) )
+            m_lastUsed[catalog.GetItem( index ).getId()] = now;
+
+    Save();
+}
+
+void StorageManager::SetProtectedCountries( const std::vector<gem::String>& isos )
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    m_protectedIsos.clear();
+
+    for ( const auto& iso : isos )
+    {
+        int isoCode = ContentCatalog::IsoToInt( iso );
+        if ( isoCode != INVALID_ISO_CODE )
+            m_protectedIsos.insert( isoCode );
+    }
+}
+
+bool StorageManager::IsProtected( const gem::ContentStoreItem& item ) const
+{
+    std::vector<gem::String> isos;
+    for ( const auto& iso : item.getCountryCodes() )
+        isos.push_back( iso );
+
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    return IsProtected( isos );
+}
+
+gem::LargeInteger StorageManager::GetUsedBytes( const ContentCatalog& catalog )
+{
+    return catalog.GetTotalSize( EItemState::Completed ) + catalog.GetTotalSize( EItemState::InProgress ) + catalog.GetTotalSize( EItemState::Paused );
+}
+
+bool StorageManager::SelectEvictions( const ContentCatalog& catalog, gem::LargeInteger requiredBytes, std::vector<size_t>& evictions ) const
+{
+    std::vector<StoredMap> storedMaps;
+    std::vector<size_t> catalogIndexes;
+
+    for ( auto index : catalog.GetItemsByState( EItemState::Completed ) )
+    {
+        const auto& item = catalog.GetItem( index );
+
+        StoredMap storedMap( item.getId(), item.getTotalSize() );
+        for ( const auto& iso : item.getCountryCodes() )
+            storedMap.isos.push_back( iso );
+
+        storedMaps.push_back( storedMap );
+        catalogIndexes.push_back( index );
+    }
+
+    if ( !SelectEvictions( storedMaps, GetUsedBytes( catalog ), requiredBytes, evictions ) )
+        return false;
+
+    for ( auto& eviction : evictions )
+        eviction = catalogIndexes[eviction];
+
+    return true;
+}
+
+bool StorageManager::SelectEvictions( const std::vector<StoredMap>& storedMaps, gem::LargeInteger usedBytes, gem::LargeInteger requiredBytes, std::vector<size_t>& evictions ) const
+{
+    evictions.clear();
+
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    if ( m_quotaBytes <= 0 )
+        return true;
+
+    gem::LargeInteger excessBytes = usedBytes + requiredBytes - m_quotaBytes;
+    if ( excessBytes <= 0 )
+        return true;
+
+    std::vector<std::pair<long long, size_t>> candidates;
+
+    for ( size_t index = 0; index < storedMaps.size(); index++ )
+    {
+        if ( IsProtected( storedMaps[index].isos ) )
+            continue;
+
+        auto it = m_lastUsed.find( storedMaps[index].itemId );
+        candidates.emplace_back( it == m_lastUsed.end() ? 0 : it->second, index );
+    }
+
+    std::sort( candidates.begin(), candidates.end() );
+
+    for ( const auto& candidate : candidates )
+    {
+        if ( excessBytes <= 0 )
+            break;
+
+        evictions.push_back( candidate.second );
+        excessBytes -= storedMaps[candidate.second].sizeBytes;
+    }
+
+    if ( excessBytes > 0 )
+    {
+        evictions.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void StorageManager::Forget( gem::LargeInteger itemId )
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    if ( m_lastUsed.erase( itemId ) )
+        Save();
+}
+
+void StorageManager::Save()
+{
+    if ( m_filePath.empty() )
+        return;
+
+    std::ofstream file( m_filePath, std::ios::trunc );
+
+    for ( const auto& it : m_lastUsed )
+        file << it.first << ' ' << it.second << '\n';
+}
+
+bool StorageManager::IsProtected( const std::vector<gem::String>& isos ) const
+{
+    for ( const auto& iso : isos )
+        if ( m_protectedIsos.find( ContentCatalog::IsoToInt( iso ) ) != m_protectedIsos.end() )
+            return true;
+
+    return false;
+}
@@ -0,0 +1,85 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include "ContentCatalog.h"
+
+#include <set>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// A downloaded map, as seen by the eviction policy (a fake store provides them without the SDK)
+struct StoredMap
+{
+    StoredMap( gem::LargeInteger itemId = 0, gem::LargeInteger sizeBytes = 0, const std::vector<gem::String>& isos = std::vector<gem::String>() )
+        : itemId( itemId )
+        , sizeBytes( sizeBytes )
+        , isos( isos )
+    {}
+
+    gem::LargeInteger itemId;
+    gem::LargeInteger sizeBytes;
+    std::vector<gem::String> isos;
+};
+
+// Storage budget of the downloaded maps: the bytes used come from the maps catalog (downloaded
+// items plus the ones being downloaded, which reserve their full size). When a download would
+// go over the quota, the least recently used maps are evicted to make room; the maps of the
+// protected countries (e.g. on the active route) are never evicted.
+class StorageManager
+{
+public:
+    StorageManager();
+    ~StorageManager();
+
+    // loads the last use times saved in the file, which is rewritten on each change
+    void Open( const std::string& filePath );
+
+    // 0 = no quota
+    void SetQuota( gem::LargeInteger quotaBytes );
+    gem::LargeInteger GetQuota() const;
+
+    void MarkItemUsed( gem::LargeInteger itemId );
+    void MarkCountriesUsed( const ContentCatalog& catalog, const std::vector<gem::String>& isos );
+
+    void SetProtectedCountries( const std::vector<gem::String>& isos );
+    bool IsProtected( const gem::ContentStoreItem& item ) const;
+
+    // downloaded + reserved by the running / paused downloads
+    static gem::LargeInteger GetUsedBytes( const ContentCatalog& catalog );
+
+    // The catalog indexes of the maps to delete so that requiredBytes more fit in the quota,
+    // least recently used first. Returns false (and no evictions) if they can't be made to fit.
+    bool SelectEvictions( const ContentCatalog& catalog, gem::LargeInteger requiredBytes, std::vector<size_t>& evictions ) const;
+
+    // same, for the downloaded maps given apart; the evictions are indexes in storedMaps
+    bool SelectEvictions( const std::vector<StoredMap>& storedMaps, gem::LargeInteger usedBytes, gem::LargeInteger requiredBytes, std::vector<size_t>& evictions ) const;
+
+    // the item was deleted
+    void Forget( gem::LargeInteger itemId );
+
+private:
+    // lock held
+    void Save();
+    bool IsProtected( const std::vector<gem::String>& isos ) const;
+
+private:
+    std::string m_filePath;
+
+    gem::LargeInteger m_quotaBytes;
+
+    // seconds since epoch, items never used are evicted first
+    std::unordered_map<gem::LargeInteger, long long> m_lastUsed;
+
+    std::set<int> m_protectedIsos;
+
+    mutable std::mutex m_sync;
+};
@@ -8,11 +8,16 @@
 
 #include <API/GEM_ContentStoreItem.h>
 #include <string>
+#include <vector>
+#include <numeric>
 
 StyleView::StyleView(IMainWindow* parent)
     : BaseView(parent)
     , m_viewModel(nullptr)
     , m_mapFilterIndex(0)
+    , m_prefetchedFilterIndex(-1)
+    , m_prefetchedVersion(0)
+    , m_prefetchedFirstRow(0)
 {
 
 }
@@ -38,6 +43,28 @@ static std::string FormatFileSize(gem::LargeInteger sz)
     return gem::String::formatString(u"%.2lf GB", sz / (1024. * 1024. * 1024.));
 }
 
+// previews of the visible rows first, then of the next screen
+static void PrefetchPreviews(ITextureRepository* textureRepository, const ContentCatalog& catalog, const std::vector<size_t>& rows, size_t firstRow, size_t visibleRows, const ImVec2& imageSize)
+{
+    std::vector<gem::Image> visible, nearVisible;
+
+    for (size_t row = firstRow; row < rows.size() && row < firstRow + 2 * visibleRows; row++)
+    {
+        const auto& item = catalog.GetItem(rows[row]);
+
+        if (!item.isImagePreviewAvailable())
+            continue;
+
+        if (row < firstRow + visibleRows)
+            visible.push_back(item.getImagePreview());
+        else
+            nearVisible.push_back(item.getImagePreview());
+    }
+
+    textureRepository->PrefetchTextures(visible, imageSize.x, imageSize.y, ETexturePriority::High);
+    textureRepository->PrefetchTextures(nearVisible, imageSize.x, imageSize.y, ETexturePriority::Low);
+}
+
 void StyleView::Render()
 {
     auto resourceRepository = m_viewModel->GetResourceRepository();
@@ -51,7 +78,7 @@ void StyleView::Render()
     }
     else
     {
-        gem::ContentStoreItemList contentStoreItems = resourceRepository->GetStyles();
+        ContentSnapshotPtr snapshot = resourceRepository->GetContentSnapshot(EResourceType::Style);
 
         ImGui::SetNextWindowBgAlpha(0.8f);
 
@@ -61,10 +88,10 @@ void StyleView::Render()
         static const char* contentStoreFilter[5] = { "All", "Downloaded", "Not downloaded", "In progress", "Paused" };
         m_parentWindow->Combo("##filterstylescombo", contentStoreFilter, IM_ARRAYSIZE(contentStoreFilter), m_mapFilterIndex, []() {});
 
+        const ImVec2 STYLE_IMAGE_SIZE(DPI(100), DPI(50));
+
         if (ImGui::BeginTable("##table_styles", 3, ImGuiTableFlags_ScrollY))
         {
-            const ImVec2 STYLE_IMAGE_SIZE(DPI(100), DPI(50));
-
             static float COLUMN2_SIZE = 0;
             if (COLUMN2_SIZE < 0.1)
                 COLUMN2_SIZE = ImGui::CalcTextSize("386.96 KB").x;
@@ -79,22 +106,51 @@ void StyleView::Render()
 
             ImGui::TableHeadersRow();
 
-            if (!contentStoreItems.empty())
+            const ContentCatalog& catalog = snapshot->catalog;
+
+            // the filtered rows come from the catalog state groups, not from a scan of the whole list
+            std::vector<size_t> rows;
+
+            if (m_mapFilterIndex == 0)
+            {
+                rows.resize(catalog.GetItemCount());
+                std::iota(rows.begin(), rows.end(), 0);
+            }
+            else
+            {
+                const auto& group = catalog.GetItemsByState(EItemState(m_mapFilterIndex));
+                rows.assign(group.begin(), group.end());
+            }
+
+            // warm the previews of the scrolled window at once, instead of discovering them row by row
+            const float rowHeight = STYLE_IMAGE_SIZE.y + 2 * ImGui::GetStyle().CellPadding.y;
+            size_t firstRow = size_t(ImGui::GetScrollY() / rowHeight);
+            size_t visibleRows = size_t(ImGui::GetWindowHeight() / rowHeight) + 1;
+
+            if (m_prefetchedFilterIndex != m_mapFilterIndex || m_prefetchedVersion != snapshot->version || m_prefetchedFirstRow != firstRow)
+            {
+                PrefetchPreviews(textureRepository, catalog, rows, firstRow, visibleRows, STYLE_IMAGE_SIZE);
+
+                m_prefetchedFilterIndex = m_mapFilterIndex;
+                m_prefetchedVersion = snapshot->version;
+                m_prefetchedFirstRow = firstRow;
+            }
+
+            if (!rows.empty())
             {
                 int itemIndex = 0;
 
-                for (auto item : contentStoreItems)
+                for (size_t catalogIndex : rows)
                 {
-                    auto itemState = resourceRepository->GetItemState(item);
-
-                    if (m_mapFilterIndex != 0 && m_mapFilterIndex != (int)itemState)
-                        continue;
+                    // handle copy, the snapshot items are immutable
+                    gem::ContentStoreItem item = catalog.GetItem(catalogIndex);
+                    auto itemState = catalog.GetItemState(catalogIndex);
 
                     gem::String itemName = item.getName();
                     if (itemState == EItemState::Paused)
                         itemName = gem::String::formatString(u"%s %s", "[PAUSED]", itemName);
                     if (itemState == EItemState::InProgress)
-                        itemName = gem::String::formatString(u"[%02d%%] %s", item.getDownloadProgress(), item.getName());
+                        itemName = gem::String::formatString(u"[%02d%%] %s", m_viewModel->GetDownloadProgress(item), item.getName());
 
                     ImGui::TableNextRow();
 
@@ -103,7 +159,7 @@ void StyleView::Render()
                     if (item.isImagePreviewAvailable())
                     {
                         auto textureId = textureRepository->GetTexture(item.getImagePreview(), STYLE_IMAGE_SIZE.x, STYLE_IMAGE_SIZE.y, false);
-                        if (textureId != -1)
+                        if (textureId != INVALID_TEXTURE_ID)
                             ImGui::Image((void*)textureId, STYLE_IMAGE_SIZE);
                     }
 
@@ -119,8 +175,8 @@ void StyleView::Render()
                         ImGui::PushStyleColor(ImGuiCol_Button, ImGuiColor_Black);
                         ImGui::BeginDisabled(!m_viewModel->IsConnected() && itemState == EItemState::Paused);
 
-                        if (ImGui::Button(itemName.toStdString().c_str()))
-                            resourceRepository->DownloadAsync(item);
+                        if (ImGui::Button(itemName.toStdString().c_str()) && resourceRepository->DownloadAsync(item) == EEnqueueResult::Refused)
+                            m_parentWindow->ShowMessage("Error", "The style could not be downloaded.");
 
                         ImGui::EndDisabled();
                         ImGui::PopStyleColor();
@@ -23,4 +23,9 @@ private:
     StyleViewModel* m_viewModel;
 
     int m_mapFilterIndex;
+
+    // filter & scroll position for which the previews were prefetched (-1 none)
+    int m_prefetchedFilterIndex;
+    size_t m_prefetchedVersion; // of the styles snapshot
+    size_t m_prefetchedFirstRow;
 };
@@ -0,0 +1,164 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "TextureCache.h"
+
+TextureCache::TextureCache( size_t budgetBytes, ReleaseTextureFunc releaseFunc )
+    : m_releaseFunc( releaseFunc )
+    , m_budgetBytes( budgetBytes )
+    , m_frame( 0 )
+{
+    m_stats.budgetBytes = budgetBytes;
+}
+
+TextureCache::~TextureCache()
+{
+    Clear();
+}
+
+bool TextureCache::Find( const TextureKey& key, unsigned int& textureId )
+{
+    auto it = m_entries.find( key );
+    if ( it == m_entries.end() )
+    {
+        m_stats.misses++;
+        return false;
+    }
+
+    textureId = it->second.textureId;
+
+    m_stats.hits++;
+    Touch( it->second );
+
+    return true;
+}
+
+void TextureCache::Insert( const TextureKey& key, unsigned int textureId, size_t bytes )
+{
+    auto it = m_entries.find( key );
+    if ( it != m_entries.end() )
+    {
+        // texture replaced
+        if ( it->second.textureId != textureId )
+            m_releaseFunc( it->second.textureId );
+
+        m_stats.bytes -= it->second.bytes;
+
+        it->second.textureId = textureId;
+        it->second.bytes = bytes;
+        Touch( it->second );
+    }
+    else
+    {
+        m_lru.push_front( key );
+
+        Entry entry;
+        entry.textureId = textureId;
+        entry.bytes = bytes;
+        entry.lastUsedFrame = m_frame;
+        entry.lruPosition = m_lru.begin();
+
+        it = m_entries.insert( std::make_pair<>( key, entry ) ).first;
+    }
+
+    m_stats.bytes += it->second.bytes;
+    m_stats.entries = m_entries.size();
+
+    EvictOverBudget();
+}
+
+void TextureCache::EraseImage( unsigned int imageUid )
+{
+    auto it = m_entries.lower_bound( TextureKey( imageUid, INT_MIN, INT_MIN, 0 ) );
+
+    while ( it != m_entries.end() && it->first.imageUid == imageUid )
+        Erase( it++, false );
+}
+
+void TextureCache::EraseTexture( unsigned int textureId )
+{
+    if ( textureId == INVALID_TEXTURE_ID )
+        return;
+
+    for ( auto it = m_entries.begin(); it != m_entries.end(); ++it )
+    {
+        if ( it->second.textureId == textureId )
+        {
+            Erase( it, false );
+            return;
+        }
+    }
+}
+
+void TextureCache::Clear()
+{
+    while ( !m_entries.empty() )
+        Erase( m_entries.begin(), false );
+}
+
+void TextureCache::SetBudget( size_t budgetBytes )
+{
+    m_budgetBytes = budgetBytes;
+    m_stats.budgetBytes = budgetBytes;
+
+    EvictOverBudget();
+}
+
+void TextureCache::NewFrame()
+{
+    m_frame++;
+
+    // catch up on evictions skipped because the textures were in use
+    EvictOverBudget();
+}
+
+TextureCacheStats TextureCache::GetStats() const
+{
+    return m_stats;
+}
+
+void TextureCache::Touch( Entry& entry )
+{
+    entry.lastUsedFrame = m_frame;
+
+    m_lru.splice( m_lru.begin(), m_lru, entry.lruPosition );
+}
+
+void TextureCache::Erase( EntryMap::iterator it, bool evicted )
+{
+    if ( it->second.textureId != INVALID_TEXTURE_ID )
+        m_releaseFunc( it->second.textureId );
+
+    m_stats.bytes -= it->second.bytes;
+    if ( evicted )
+        m_stats.evictions++;
+
+    m_lru.erase( it->second.lruPosition );
+    m_entries.erase( it );
+
+    m_stats.entries = m_entries.size();
+}
+
+void TextureCache::EvictOverBudget()
+{
+    auto lruIt = m_lru.end();
+
+    while ( m_stats.bytes > m_budgetBytes && lruIt != m_lru.begin() )
+    {
+        --lruIt;
+
+        auto it = m_entries.find( *lruIt );
+        if ( it->second.lastUsedFrame == m_frame )
+            continue;
+
+        // keep a valid position, the current one is removed by Erase
+        auto next = std::next( lruIt );
+        Erase( it, true );
+        lruIt = next;
+    }
+}
@@ -0,0 +1,90 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include "ITextureRepository.h"
+
+#include <map>
+#include <list>
+#include <tuple>
+#include <cstdint>
+#include <climits>
+#include <functional>
+
+using ReleaseTextureFunc = std::function<void( unsigned int& )>;
+
+struct TextureKey
+{
+    TextureKey( unsigned int imageUid = 0, int width = 0, int height = 0, uint64_t settingsHash = 0 )
+        : imageUid( imageUid )
+        , width( width )
+        , height( height )
+        , settingsHash( settingsHash )
+    {}
+
+    bool operator<( const TextureKey& other ) const
+    {
+        return std::tie( imageUid, width, height, settingsHash ) < std::tie( other.imageUid, other.width, other.height, other.settingsHash );
+    }
+
+    unsigned int imageUid;
+    int width;
+    int height;
+    uint64_t settingsHash; // 0 for plain images, persisted by the disk cache
+};
+
+// GPU textures keyed by image & size, evicted least recently used first once
+// the total GPU memory goes over budget
+class TextureCache
+{
+public:
+    TextureCache( size_t budgetBytes, ReleaseTextureFunc releaseFunc );
+    ~TextureCache();
+
+    bool Find( const TextureKey& key, unsigned int& textureId );
+
+    void Insert( const TextureKey& key, unsigned int textureId, size_t bytes );
+
+    void EraseImage( unsigned int imageUid );
+    void EraseTexture( unsigned int textureId );
+    void Clear();
+
+    void SetBudget( size_t budgetBytes );
+
+    // textures used in the current frame are never evicted (they are still referenced by the UI draw lists)
+    void NewFrame();
+
+    TextureCacheStats GetStats() const;
+
+private:
+    struct Entry
+    {
+        unsigned int textureId;
+        size_t bytes;
+        unsigned int lastUsedFrame;
+        std::list<TextureKey>::iterator lruPosition;
+    };
+
+    using EntryMap = std::map<TextureKey, Entry>;
+
+    void Touch( Entry& entry );
+    void Erase( EntryMap::iterator it, bool evicted );
+    void EvictOverBudget();
+
+private:
+    EntryMap m_entries;
+    std::list<TextureKey> m_lru; // most recently used in front
+
+    ReleaseTextureFunc m_releaseFunc;
+
+    size_t m_budgetBytes;
+    unsigned int m_frame;
+
+    TextureCacheStats m_stats;
+};
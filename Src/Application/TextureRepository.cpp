@@ -9,22 +9,47 @@
 #include "TextureRepository.h"
 
 #include "BitmapImpl.h"
+#include "BitmapBufferPool.h"
+#include "SDKUtils.h"
 
 #include <API/GEM_ImageIDs.h>
-#include <API/GEM_MapDetails.h>
-#include <API/GEM_OperationScheduler.h>
 
 #include "GLES2/gl2.h"
 
 #include <functional>
+#include <algorithm>
 
-TextureRepository::TextureRepository()
+// GPU memory kept for cached textures, before the least recently used ones are unloaded
+const size_t DEFAULT_TEXTURE_CACHE_BUDGET = 32 * 1024 * 1024;
+
+// bytes uploaded from the rendered textures queue each frame
+const size_t DEFAULT_UPLOAD_BUDGET = 1024 * 1024;
+
+// pack of rendered textures, in the SDK cache dir
+static const char* const DISK_CACHE_FILE_NAME = "TextureCache.pack";
+
+// disk cache key of the flags atlas pages (not an image uid)
+const unsigned int FLAG_ATLAS_IMAGE_UID = -1;
+
+// the flags are rendered from the maps: a pack from other maps is dropped
+TextureRepository::TextureRepository( const std::string& cachePath /* = std::string() */, CountryMetadataPtr countries /* = std::make_shared<CountryMetadata>() */ )
+    : m_textureCache( DEFAULT_TEXTURE_CACHE_BUDGET, UnloadTextureFromGPU )
+    , m_countries( countries )
+    , m_flagAtlasGeneration( 0 )
+    , m_uploadBudget( DEFAULT_UPLOAD_BUDGET )
+    , m_textureFormat( ETextureFormat::RGBA8888 )
+    , m_bPremultipliedAlpha( false ) // ImGui blends straight alpha
 {
-    FillCountriesIsoToImageUids();
+    // rendered textures kept across launches
+    if ( !cachePath.empty() )
+        m_diskCache.Open( SDKUtils::CombinePath( cachePath, DISK_CACHE_FILE_NAME ), SDKUtils::GetMapVersion() );
 }
 
 TextureRepository::~TextureRepository()
 {
+    // no more rendering on the workers
+    m_workerPool.Stop();
+
     UnloadAllTextures();
 }
 
@@ -37,139 +62,469 @@ unsigned int TextureRepository::GetIconTexture(EIconType iconType, int width, in
 
 void TextureRepository::UnloadIconTexture(EIconType iconType)
 {
-    auto textureId = GetIconId(iconType);
+    auto imageUid = GetIconId(iconType);
 
-    UnloadTexture(textureId);
+    // all the loaded sizes of the icon
+    m_textureCache.EraseImage(imageUid);
 }
 
 unsigned int TextureRepository::GetTexture(gem::Image image, int w, int h, bool bSync /* = true */)
 {
-    auto it = m_ImagesUidToTextureId.find(image.getUid());
+    return GetCachedTexture(TextureKey(image.getUid(), w, h), GetRenderFunc(image), bSync);
+}
+
+unsigned int TextureRepository::GetTexture(const gem::AbstractGeometryImage& image, const gem::AbstractGeometryImageRenderSettings& settings, int w, int h, bool bSync /*= true */)
+{
+    return GetCachedTexture(TextureKey(image.getUid(), w, h, HashRenderSettings(settings)), GetRenderFunc(image, settings), bSync);
+}
+
+unsigned int TextureRepository::GetTexture(unsigned int imageId, int w, int h, bool bSync )
+{
+    return GetTexture(gem::Image(imageId), w, h, bSync);
+}
+
+TextureFuture TextureRepository::RequestTexture(gem::Image image, int w, int h)
+{
+    return RequestCachedTexture(TextureKey(image.getUid(), w, h), GetRenderFunc(image));
+}
+
+TextureFuture TextureRepository::RequestTexture(const gem::AbstractGeometryImage& image, const gem::AbstractGeometryImageRenderSettings& settings, int w, int h)
+{
+    return RequestCachedTexture(TextureKey(image.getUid(), w, h, HashRenderSettings(settings)), GetRenderFunc(image, settings));
+}
+
+PrefetchFuture TextureRepository::PrefetchTextures(const std::vector<gem::Image>& images, int w, int h, ETexturePriority priority /* = ETexturePriority::Normal */)
+{
+    auto batch = std::make_shared<PrefetchBatch>();
+    PrefetchFuture future = batch->promise.get_future().share();
+
+    batch->textures.reserve(images.size());
+
+    for (const auto& image : images)
+        batch->textures.push_back(RequestCachedTexture(TextureKey(image.getUid(), w, h), GetRenderFunc(image), priority));
+
+    m_prefetchBatches.push_back(batch);
+
+    // everything cached already
+    CompletePrefetchBatches();
+
+    return future;
+}
+
+TextureRegion TextureRepository::GetFlagTexture( const gem::String& iso, int w, int h )
+{
+    // (re)build the atlas for the requested flag size, e.g. first use or DPI change
+    if ( !m_flagAtlas.IsBuilt( w, h ) )
+        BuildFlagAtlas( w, h );
+
+    const CountryInfo* country = m_countries->Find( iso );
+
+    return m_flagAtlas.GetRegion( country ? country->isoCode : 0 );
+}
+
+void TextureRepository::UnloadAllTextures()
+{
+    DropPendingTextures();
+
+    m_textureCache.Clear();
+
+    ReleaseFlagAtlas();
+}
+
+void TextureRepository::UnloadTexture(unsigned int textureId)
+{
+    m_textureCache.EraseTexture(textureId);
+}
+
+void TextureRepository::SetCacheBudget(size_t budgetBytes)
+{
+    m_textureCache.SetBudget(budgetBytes);
+}
+
+TextureCacheStats TextureRepository::GetCacheStats() const
+{
+    TextureCacheStats stats = m_textureCache.GetStats();
+
+    BitmapPoolStats poolStats = BitmapBufferPool::Instance().GetStats();
+    stats.bitmapLeases = poolStats.leases;
+    stats.bitmapReuses = poolStats.reuses;
+    stats.pooledBitmapBytes = poolStats.pooledBytes;
+
+    return stats;
+}
+
+void TextureRepository::SetBitmapPoolLimit(size_t maxPooledBytes)
+{
+    BitmapBufferPool::Instance().SetMaxPooledBytes(maxPooledBytes);
+}
+
+void TextureRepository::SetUploadBudget(size_t bytesPerFrame)
+{
+    m_uploadBudget = bytesPerFrame;
+}
+
+void TextureRepository::SetUploadMode(ETextureUploadMode mode)
+{
+    m_textureUploader.SetMode(mode);
+}
+
+ETextureUploadMode TextureRepository::GetUploadMode() const
+{
+    return m_textureUploader.GetMode();
+}
+
+void TextureRepository::SetTextureFormat(ETextureFormat format)
+{
+    if (format == m_textureFormat)
+        return;
+
+    m_textureFormat = format;
+
+    DropPendingTextures();
+    m_textureCache.Clear();
+}
+
+ETextureFormat TextureRepository::GetTextureFormat() const
+{
+    return m_textureFormat;
+}
+
+void TextureRepository::SetPremultipliedAlpha(bool bPremultiplied)
+{
+    if (bPremultiplied == m_bPremultipliedAlpha)
+        return;
+
+    m_bPremultipliedAlpha = bPremultiplied;
+
+    DropPendingTextures();
+    m_textureCache.Clear();
+}
+
+bool TextureRepository::IsPremultipliedAlpha() const
+{
+    return m_bPremultipliedAlpha;
+}
+
+WorkerPool& TextureRepository::GetWorkerPool()
+{
+    return m_workerPool;
+}
+
+void TextureRepository::OnResourceUpdated(EResourceType resType)
+{
+    // flags (maps) or style previews may have changed; the loaded textures are kept until unloaded
+    m_diskCache.Invalidate( SDKUtils::GetMapVersion() );
+}
+
+void TextureRepository::Tick()
+{
+    m_textureCache.NewFrame();
+
+    // a page is bigger than the budget, it takes the frame's uploads
+    UploadRenderedTextures(UploadFlagAtlasPage());
+
+    CompletePrefetchBatches();
+}
+
+unsigned int TextureRepository::GetCachedTexture(const TextureKey& key, RenderBitmapFunc renderFunc, bool bSync)
+{
+    if (!bSync)
+    {
+        TextureFuture future = RequestCachedTexture(key, renderFunc);
+
+        return IsTextureReady(future) ? future.get() : INVALID_TEXTURE_ID;
+    }
+
+    unsigned int textureId = INVALID_TEXTURE_ID;
 
     // texture is loaded
-    if (it != m_ImagesUidToTextureId.end() && (!bSync || it->second != -1))
-        return it->second;
+    if (m_textureCache.Find(key, textureId))
+        return textureId;
+
+    // rendered in a previous run
+    textureId = LoadDiskTexture(key);
+    if (textureId != INVALID_TEXTURE_ID)
+        return textureId;
+
+    // load texture on the calling thread (never wait for the workers); if the texture was
+    // already ordered async, the request is fulfilled now and the worker's result is dropped
+    // (cleared: a pooled buffer holds the pixels of a previous image, the transparent areas aren't written)
+    auto bitmap = gem::StrongPointerFactory<BitmapImpl>(key.width, key.height);
+    renderFunc(*bitmap);
+    ConvertPixels(*bitmap, m_textureFormat, m_bPremultipliedAlpha);
+
+    return UploadTexture(key, *bitmap, m_textureFormat, m_bPremultipliedAlpha);
+}
+
+TextureFuture TextureRepository::RequestCachedTexture(const TextureKey& key, RenderBitmapFunc renderFunc, ETexturePriority priority /* = ETexturePriority::Normal */)
+{
+    auto pendingIt = m_pendingTextures.find(key);
+    if (pendingIt != m_pendingTextures.end())
+        return pendingIt->second.future;
+
+    unsigned int textureId = INVALID_TEXTURE_ID;
 
-    // if texture was already ordered async, wait until available
-    if (bSync && it != m_ImagesUidToTextureId.end())
+    if (m_textureCache.Find(key, textureId))
     {
-        while (it->second == -1)
-        {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            it = m_ImagesUidToTextureId.find(image.getUid());
-        }
+        std::promise<unsigned int> promise;
+        promise.set_value(textureId);
 
-        return it->second;
+        return promise.get_future().share();
     }
 
-    if (bSync)
+    // uploaded right away, a mapped texture is as cheap as a queued one
+    textureId = LoadDiskTexture(key);
+    if (textureId != INVALID_TEXTURE_ID)
     {
-        // load texture for the first time
-        auto bitmap = gem::StrongPointerFactory<BitmapImpl>(w, h);
-        image.render(*bitmap);
+        std::promise<unsigned int> promise;
+        promise.set_value(textureId);
 
-        unsigned int textureId = LoadTextureIntoGPU(bitmap->size().width, bitmap->size().height, bitmap->begin());
+        return promise.get_future().share();
+    }
 
-        m_ImagesUidToTextureId.insert(std::make_pair<>(image.getUid(), textureId));
+    PendingTexture pending;
+    pending.promise = std::make_shared<std::promise<unsigned int>>();
+    pending.future = pending.promise->get_future().share();
 
-        return textureId;
+    m_pendingTextures.insert(std::make_pair<>(key, pending));
+
+    // CPU rasterization on the workers, the GPU upload is done by Tick() on the render thread
+    // the pixel conversions run on the worker as well
+    auto renderTask = [this, key, renderFunc, format = m_textureFormat, bPremultiply = m_bPremultipliedAlpha]()
+    {
+        auto bitmap = gem::StrongPointerFactory<BitmapImpl>(key.width, key.height);
+        renderFunc(*bitmap);
+        ConvertPixels(*bitmap, format, bPremultiply);
+
+        std::lock_guard<std::mutex> guard(m_renderedTexturesSync);
+        m_renderedTextures.push_back(RenderedTexture(key, bitmap, format, bPremultiply));
+    };
+
+    m_workerPool.Execute(renderTask, int(priority));
+
+    return pending.future;
+}
+
+unsigned int TextureRepository::UploadTexture(const TextureKey& key, BitmapImpl& bitmap, ETextureFormat format, bool bPremultiplied)
+{
+    size_t bytes = GetTextureBytes(key.width, key.height, format);
+
+    m_diskCache.Store(DiskTextureKey(key, GetPixelFlags(format, bPremultiplied)), bitmap.begin(), bytes);
+
+    return InsertTexture(key, bitmap.begin(), format);
+}
+
+unsigned int TextureRepository::LoadDiskTexture(const TextureKey& key)
+{
+    const void* data = m_diskCache.Find(DiskTextureKey(key, GetPixelFlags(m_textureFormat, m_bPremultipliedAlpha)), GetTextureBytes(key.width, key.height, m_textureFormat));
+    if (!data)
+        return INVALID_TEXTURE_ID;
+
+    return InsertTexture(key, data, m_textureFormat);
+}
+
+unsigned int TextureRepository::InsertTexture(const TextureKey& key, const void* data, ETextureFormat format)
+{
+    unsigned int textureId = LoadTextureIntoGPU(key.width, key.height, data, format);
+
+    m_textureCache.Insert(key, textureId, GetTextureBytes(key.width, key.height, format));
+
+    auto pendingIt = m_pendingTextures.find(key);
+    if (pendingIt != m_pendingTextures.end())
+    {
+        pendingIt->second.promise->set_value(textureId);
+        m_pendingTextures.erase(pendingIt);
     }
-    else
+
+    return textureId;
+}
+
+void TextureRepository::UploadRenderedTextures(size_t uploadedBytes)
+{
+    // at least one texture per frame, whatever the budget
+    while (uploadedBytes == 0 || uploadedBytes < m_uploadBudget)
     {
-        auto lambda = [&, image, w, h]()
+        RenderedTexture rendered;
+
         {
-            auto bitmap = gem::StrongPointerFactory<BitmapImpl>(w, h);
-            image.render(*bitmap);
+            std::lock_guard<std::mutex> guard(m_renderedTexturesSync);
+
+            if (m_renderedTextures.empty())
+                break;
 
-            auto lambda2 = [&, bitmap, image]()
-            {
-                unsigned int textureId = LoadTextureIntoGPU(bitmap->size().width, bitmap->size().height, bitmap->begin());
-                m_ImagesUidToTextureId[image.getUid()] = textureId;
-            };
+            rendered = m_renderedTextures.front();
+            m_renderedTextures.pop_front();
+        }
 
-            gem::OperationScheduler().timeoutOperation(20, lambda2, gem::ProgressListener(), true);
-        };
+        // already loaded sync or unloaded meanwhile
+        if (m_pendingTextures.find(rendered.key) == m_pendingTextures.end())
+            continue;
 
-        gem::OperationScheduler().executeOperation(lambda, gem::ProgressListener(), true);
+        // rendered before a texture format change
+        if (rendered.format != m_textureFormat || rendered.bPremultiplied != m_bPremultipliedAlpha)
+            continue;
 
-        m_ImagesUidToTextureId.insert(std::make_pair<>(image.getUid(), -1));
+        UploadTexture(rendered.key, *rendered.bitmap, rendered.format, rendered.bPremultiplied);
 
-        return -1;
+        uploadedBytes += GetTextureBytes(rendered.bitmap->size().width, rendered.bitmap->size().height, rendered.format);
     }
 }
 
-unsigned int TextureRepository::GetTexture(const gem::AbstractGeometryImage& image, const gem::AbstractGeometryImageRenderSettings& settings, int w, int h, bool bSync /*= true */)
+void TextureRepository::BuildFlagAtlas(int flagWidth, int flagHeight)
 {
-    auto it = m_ImagesUidToTextureId.find(image.getUid());
+    ReleaseFlagAtlas();
 
-    // texture is loaded
-    if (it != m_ImagesUidToTextureId.end() && (!bSync || it->second != -1))
-        return it->second;
+    m_flagAtlas.Layout(m_countries->GetFlagImageUids(), flagWidth, flagHeight);
 
-    // if texture was already ordered async, wait until available
-    if (bSync && it != m_ImagesUidToTextureId.end())
+    for (size_t page = 0; page < m_flagAtlas.GetPageCount(); page++)
     {
-        while (it->second == -1)
+        const FlagAtlasPage& layout = m_flagAtlas.GetPage(page);
+
+        // rendered in a previous run: uploaded from the mapping by Tick()
+        if (m_diskCache.Contains(GetFlagAtlasDiskKey(page), GetTextureBytes(layout.width, layout.height)))
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            it = m_ImagesUidToTextureId.find(image.getUid());
+            std::lock_guard<std::mutex> guard(m_renderedTexturesSync);
+            m_renderedAtlasPages.push_back(RenderedAtlasPage(m_flagAtlasGeneration, page));
         }
-
-        return it->second;
+        else
+            RenderFlagAtlasPage(page);
     }
+}
 
-    if (bSync)
+void TextureRepository::RenderFlagAtlasPage(size_t page)
+{
+    // the task only reads its copy of the page layout
+    auto renderTask = [this, generation = m_flagAtlasGeneration, page, layout = m_flagAtlas.GetPage(page)]()
     {
-        // load texture for the first time
-        auto bitmap = gem::StrongPointerFactory<BitmapImpl>(w, h);
-        image.render(*bitmap, settings);
+        RenderedAtlasPage rendered(generation, page);
+        FlagAtlas::RenderPage(layout, rendered.pixels);
 
-        unsigned int textureId = LoadTextureIntoGPU(bitmap->size().width, bitmap->size().height, bitmap->begin());
+        if (!PixelConverter::IsLittleEndian())
+            PixelConverter::SwizzleAbgrRgba(rendered.pixels.data(), (size_t)layout.width * (size_t)layout.height);
 
-        m_ImagesUidToTextureId.insert(std::make_pair<>(image.getUid(), textureId));
+        std::lock_guard<std::mutex> guard(m_renderedTexturesSync);
+        m_renderedAtlasPages.push_back(std::move(rendered));
+    };
 
-        return textureId;
+    // a list of visible flags is waiting for it
+    m_workerPool.Execute(renderTask, int(ETexturePriority::High));
+}
+
+void TextureRepository::ReleaseFlagAtlas()
+{
+    m_flagAtlas.Release(UnloadTextureFromGPU);
+
+    // the pages still rendering are dropped by Tick()
+    m_flagAtlasGeneration++;
+
+    std::lock_guard<std::mutex> guard(m_renderedTexturesSync);
+    m_renderedAtlasPages.clear();
+}
+
+size_t TextureRepository::UploadFlagAtlasPage()
+{
+    RenderedAtlasPage rendered;
+
+    {
+        std::lock_guard<std::mutex> guard(m_renderedTexturesSync);
+
+        if (m_renderedAtlasPages.empty())
+            return 0;
+
+        rendered = std::move(m_renderedAtlasPages.front());
+        m_renderedAtlasPages.pop_front();
     }
-    else
+
+    // rendered for a previous build (flag size changed, textures unloaded)
+    if (rendered.generation != m_flagAtlasGeneration)
+        return 0;
+
+    const FlagAtlasPage& layout = m_flagAtlas.GetPage(rendered.page);
+    size_t bytes = GetTextureBytes(layout.width, layout.height);
+
+    DiskTextureKey diskKey = GetFlagAtlasDiskKey(rendered.page);
+
+    if (rendered.pixels.empty())
     {
-        auto lambda = [&, image, w, h]()
+        // uploaded right away, the pointer doesn't outlive the next Find
+        const void* data = m_diskCache.Find(diskKey, bytes);
+
+        // dropped since the build (content update applied)
+        if (!data)
         {
-            auto bitmap = gem::StrongPointerFactory<BitmapImpl>(w, h);
-            image.render(*bitmap, settings);
+            RenderFlagAtlasPage(rendered.page);
+            return 0;
+        }
 
-            auto lambda2 = [&, bitmap, image]()
-            {
-                unsigned int textureId = LoadTextureIntoGPU(bitmap->size().width, bitmap->size().height, bitmap->begin());
-                m_ImagesUidToTextureId[image.getUid()] = textureId;
-            };
+        m_flagAtlas.SetPageTexture(rendered.page, LoadTextureIntoGPU(layout.width, layout.height, data));
+    }
+    else
+    {
+        m_diskCache.Store(diskKey, rendered.pixels.data(), bytes);
 
-            gem::OperationScheduler().timeoutOperation(20, lambda2, gem::ProgressListener(), true);
-        };
+        m_flagAtlas.SetPageTexture(rendered.page, LoadTextureIntoGPU(layout.width, layout.height, rendered.pixels.data()));
+    }
 
-        gem::OperationScheduler().executeOperation(lambda, gem::ProgressListener(), true);
+    return bytes;
+}
 
-        m_ImagesUidToTextureId.insert(std::make_pair<>(image.getUid(), -1));
+DiskTextureKey TextureRepository::GetFlagAtlasDiskKey(size_t page) const
+{
+    const FlagAtlasPage& layout = m_flagAtlas.GetPage(page);
 
-        return -1;
-    }
+    return DiskTextureKey(GetFlagAtlasPageKey(int(page), layout.width, layout.height, layout.flagWidth, layout.flagHeight, int(m_flagAtlas.GetFlagCount())), GetPixelFlags(ETextureFormat::RGBA8888, false));
 }
 
-unsigned int TextureRepository::GetTexture(unsigned int imageId, int w, int h, bool bSync )
+void TextureRepository::DropPendingTextures()
 {
-    return GetTexture(gem::Image(imageId), w, h);
+    for (auto& it : m_pendingTextures)
+        it.second.promise->set_value(INVALID_TEXTURE_ID);
+
+    m_pendingTextures.clear();
+
+    {
+        std::lock_guard<std::mutex> guard(m_renderedTexturesSync);
+        m_renderedTextures.clear();
+    }
+
+    // every request of the batches is fulfilled now
+    CompletePrefetchBatches();
 }
 
-void TextureRepository::UnloadAllTextures()
+void TextureRepository::CompletePrefetchBatches()
 {
-    for (auto it : m_ImagesUidToTextureId)
-        UnloadTexture(it.second);
+    for (auto it = m_prefetchBatches.begin(); it != m_prefetchBatches.end();)
+    {
+        auto& textures = (*it)->textures;
+
+        if (!std::all_of(textures.begin(), textures.end(), IsTextureReady))
+        {
+            it++;
+            continue;
+        }
+
+        size_t loadedCount = std::count_if(textures.begin(), textures.end(), [](const TextureFuture& future) { return future.get() != INVALID_TEXTURE_ID; });
+        (*it)->promise.set_value(loadedCount);
+
+        it = m_prefetchBatches.erase(it);
+    }
 }
 
-void TextureRepository::UnloadTexture(unsigned int textureId)
+RenderBitmapFunc TextureRepository::GetRenderFunc(gem::Image image)
 {
-    m_ImagesUidToTextureId.erase(textureId);
+    return [image](BitmapImpl& bitmap)
+    {
+        image.render(bitmap);
+    };
+}
 
-    UnloadTextureFromGPU(textureId);
+RenderBitmapFunc TextureRepository::GetRenderFunc(const gem::AbstractGeometryImage& image, const gem::AbstractGeometryImageRenderSettings& settings)
+{
+    // settings are copied, the rendering may outlive the caller's object
+    return [image, settings](BitmapImpl& bitmap)
+    {
+        image.render(bitmap, settings);
+    };
 }
 
 unsigned int TextureRepository::GetIconId(EIconType iconType)
@@ -185,60 +540,79 @@ unsigned int TextureRepository::GetIconId(EIconType iconType)
     return -1;
 }
 
-unsigned int TextureRepository::LoadTextureIntoGPU(int width, int height, void* data)
+void TextureRepository::ConvertPixels(BitmapImpl& bitmap, ETextureFormat format, bool bPremultiply)
 {
-    unsigned int textureId;
+    size_t count = (size_t)bitmap.size().width * (size_t)bitmap.size().height;
+    void* pixels = bitmap.begin();
 
-    glGenTextures(1, &textureId);
-    glBindTexture(GL_TEXTURE_2D, textureId);
+    // ABGR_8888 is packed as 0xAABBGGRR: already RGBA bytes on little endian, reversed on big endian
+    if (!PixelConverter::IsLittleEndian())
+        PixelConverter::SwizzleAbgrRgba(pixels, count);
 
-    // Setup filtering parameters for display
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); // Required on WebGL for non power-of-two textures
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE); // Required on WebGL for non power-of-two textures
+    if (bPremultiply)
+        PixelConverter::PremultiplyAlpha(pixels, count);
 
-    // Upload pixels into texture
-#ifdef GL_UNPACK_ROW_LENGTH
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-#endif
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    if (format == ETextureFormat::RGB565)
+        PixelConverter::RgbaToRgb565(pixels, (uint16_t*)pixels, count);
+}
 
-    return textureId;
+unsigned int TextureRepository::LoadTextureIntoGPU(int width, int height, const void* data, ETextureFormat format /* = ETextureFormat::RGBA8888 */)
+{
+    return m_textureUploader.Upload(width, height, data, format);
 }
 
 void TextureRepository::UnloadTextureFromGPU(unsigned int& textureId)
 {
-    if (textureId != -1)
+    if (textureId != INVALID_TEXTURE_ID)
         glDeleteTextures(1, &textureId);
 }
 
-void TextureRepository::FillCountriesIsoToImageUids()
+size_t TextureRepository::GetTextureBytes(int width, int height, ETextureFormat format /* = ETextureFormat::RGBA8888 */)
 {
-    // fill the map (iso country (int), imageUid) 
-    auto collectCountries = [&](const gem::String& name, const gem::Image& icon, const gem::String& iso)
-    {
-        m_countriesIsoToImageUids.insert(std::make_pair<>(IsoToInt(iso), icon.getUid()));
-
-        return true;
-    };
+    // no mipmaps
+    return (size_t)width * (size_t)height * TextureUploader::GetBytesPerPixel(format);
+}
 
-    gem::MapDetails().iterateCountries(collectCountries);
+static int64_t GetColorValue(const gem::Rgba& color)
+{
+    return (int64_t(color.getRed()) << 24) | (color.getGreen() << 16) | (color.getBlue() << 8) | color.getAlpha();
 }
 
-unsigned int TextureRepository::GetFlagImageUid(const gem::String& iso)
+uint64_t TextureRepository::HashRenderSettings(const gem::AbstractGeometryImageRenderSettings& settings)
 {
-    return m_countriesIsoToImageUids.find(IsoToInt(iso))->second;
+    // the named fields, not the struct bytes (padding)
+    return HashValues({
+        GetColorValue(settings.activeInnerColor),
+        GetColorValue(settings.activeOuterColor),
+        GetColorValue(settings.inactiveInnerColor),
+        GetColorValue(settings.inactiveOuterColor) });
 }
 
-gem::Image TextureRepository::GetFlagImage(const gem::String& iso)
+uint64_t TextureRepository::HashValues(std::initializer_list<int64_t> values)
 {
-    unsigned int imageId = GetFlagImageUid(iso);
+    // FNV-1a, each value as 8 little endian bytes
+    uint64_t hash = 14695981039346656037ull;
 
-    return gem::Image(imageId);
+    for (int64_t value : values)
+    {
+        for (int byte = 0; byte < 8; byte++)
+        {
+            hash ^= (uint64_t(value) >> (byte * 8)) & 0xFF;
+            hash *= 1099511628211ull;
+        }
+    }
+
+    // 0 is reserved for plain images
+    return hash ? hash : 1;
+}
+
+uint32_t TextureRepository::GetPixelFlags(ETextureFormat format, bool bPremultiplied)
+{
+    return uint32_t(format) | (bPremultiplied ? 0x100 : 0);
 }
 
-int TextureRepository::IsoToInt(const gem::String& iso)
+TextureKey TextureRepository::GetFlagAtlasPageKey(int page, int pageWidth, int pageHeight, int flagWidth, int flagHeight, int flagCount)
 {
-    return iso[0] | (iso[1] << 8) | (iso[2] << 16);
+    // the page layout depends on the flag size & count
+    return TextureKey(FLAG_ATLAS_IMAGE_UID, pageWidth, pageHeight, HashValues({ page, flagWidth, flagHeight, flagCount }));
 }
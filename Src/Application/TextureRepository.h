@@ -9,13 +9,71 @@
 #pragma once
 
 #include "ITextureRepository.h"
+#include "IResourceRepository.h"
+#include "FlagAtlas.h"
+#include "TextureCache.h"
+#include "DiskTextureCache.h"
+#include "WorkerPool.h"
+#include "TextureUploader.h"
+#include "BitmapImpl.h"
+#include "PixelConverter.h"
+#include "CountryMetadata.h"
 
 #include <map>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <future>
+#include <functional>
+#include <initializer_list>
 
-class TextureRepository : public ITextureRepository
+struct PrefetchBatch
+{
+    std::vector<TextureFuture> textures;
+    std::promise<size_t> promise;
+};
+
+using RenderBitmapFunc = std::function<void( BitmapImpl& )>;
+
+struct PendingTexture
+{
+    std::shared_ptr<std::promise<unsigned int>> promise;
+    TextureFuture future;
+};
+
+struct RenderedTexture
+{
+    RenderedTexture( const TextureKey& key = TextureKey(), gem::StrongPointer<BitmapImpl> bitmap = gem::StrongPointer<BitmapImpl>(), ETextureFormat format = ETextureFormat::RGBA8888, bool bPremultiplied = false )
+        : key( key )
+        , bitmap( bitmap )
+        , format( format )
+        , bPremultiplied( bPremultiplied )
+    {}
+
+    TextureKey key;
+    gem::StrongPointer<BitmapImpl> bitmap;
+    ETextureFormat format; // of the converted bitmap pixels
+    bool bPremultiplied;
+};
+
+// flags atlas page rendered by a worker, or to be loaded from the disk cache (no pixels)
+struct RenderedAtlasPage
+{
+    RenderedAtlasPage( unsigned int generation = 0, size_t page = 0 )
+        : generation( generation )
+        , page( page )
+    {}
+
+    unsigned int generation;    // of the atlas build, pages of a previous build are dropped
+    size_t page;
+    std::vector<unsigned char> pixels;
+};
+
+class TextureRepository : public ITextureRepository, public IResourceRepositoryListener
 {
 public:
-    TextureRepository();
+    // an empty cache path disables the disk cache
+    TextureRepository( const std::string& cachePath = std::string(), CountryMetadataPtr countries = std::make_shared<CountryMetadata>() );
     ~TextureRepository();
 
     unsigned int GetIconTexture(EIconType iconType, int width, int height) override;
@@ -25,25 +83,105 @@ public:
     unsigned int GetTexture(gem::Image image, int w, int h, bool bSync = true) override;
     unsigned int GetTexture(const gem::AbstractGeometryImage& image, const gem::AbstractGeometryImageRenderSettings& settings, int w, int h, bool bSync = true) override;
 
+    TextureFuture RequestTexture(gem::Image image, int w, int h) override;
+    TextureFuture RequestTexture(const gem::AbstractGeometryImage& image, const gem::AbstractGeometryImageRenderSettings& settings, int w, int h) override;
+
+    PrefetchFuture PrefetchTextures(const std::vector<gem::Image>& images, int w, int h, ETexturePriority priority = ETexturePriority::Normal) override;
+
+    TextureRegion GetFlagTexture( const gem::String& iso, int w, int h ) override;
+
     void UnloadAllTextures() override;
     void UnloadTexture(unsigned int textureId) override;
 
+    void SetCacheBudget(size_t budgetBytes) override;
+    TextureCacheStats GetCacheStats() const override;
+
+    void SetBitmapPoolLimit(size_t maxPooledBytes) override;
+
+    void SetUploadBudget(size_t bytesPerFrame) override;
+
+    void SetUploadMode(ETextureUploadMode mode) override;
+    ETextureUploadMode GetUploadMode() const override;
+
+    void SetTextureFormat(ETextureFormat format) override;
+    ETextureFormat GetTextureFormat() const override;
+
+    void SetPremultipliedAlpha(bool bPremultiplied) override;
+    bool IsPremultipliedAlpha() const override;
+
+    void Tick() override;
+
+    // IResourceRepositoryListener (content update applied)
+    void OnResourceUpdated(EResourceType resType) override;
+
+    // shared with the other background work of the app; stopped (the queued tasks dropped) on destruction
+    WorkerPool& GetWorkerPool();
+
 private:
+    unsigned int GetCachedTexture(const TextureKey& key, RenderBitmapFunc renderFunc, bool bSync);
+    TextureFuture RequestCachedTexture(const TextureKey& key, RenderBitmapFunc renderFunc, ETexturePriority priority = ETexturePriority::Normal);
+
+    // render thread only
+    unsigned int UploadTexture(const TextureKey& key, BitmapImpl& bitmap, ETextureFormat format, bool bPremultiplied);
+    unsigned int LoadDiskTexture(const TextureKey& key);
+    unsigned int InsertTexture(const TextureKey& key, const void* data, ETextureFormat format);
+    void UploadRenderedTextures(size_t uploadedBytes);
+    void BuildFlagAtlas(int flagWidth, int flagHeight);
+    void RenderFlagAtlasPage(size_t page);
+    void ReleaseFlagAtlas();
+    size_t UploadFlagAtlasPage();
+    DiskTextureKey GetFlagAtlasDiskKey(size_t page) const;
+    void DropPendingTextures();
+    void CompletePrefetchBatches();
+
+    static RenderBitmapFunc GetRenderFunc(gem::Image image);
+    static RenderBitmapFunc GetRenderFunc(const gem::AbstractGeometryImage& image, const gem::AbstractGeometryImageRenderSettings& settings);
+
     static unsigned int GetIconId(EIconType iconType);
 
-    static unsigned int LoadTextureIntoGPU(int width, int height, void* data);
-    static void UnloadTextureFromGPU(unsigned int& textureId);
+    // in place, from the rendered ABGR_8888 bitmap to the texture format
+    static void ConvertPixels(BitmapImpl& bitmap, ETextureFormat format, bool bPremultiply);
 
-    void FillCountriesIsoToImageUids();
+    unsigned int LoadTextureIntoGPU(int width, int height, const void* data, ETextureFormat format = ETextureFormat::RGBA8888);
+    static void UnloadTextureFromGPU(unsigned int& textureId);
 
-    unsigned int GetFlagImageUid(const gem::String& iso);
-    gem::Image GetFlagImage(const gem::String& iso);
+    static size_t GetTextureBytes(int width, int height, ETextureFormat format = ETextureFormat::RGBA8888);
+    // fixed 64 bits FNV-1a of the values, the same on every build (the hashes are persisted)
+    static uint64_t HashRenderSettings(const gem::AbstractGeometryImageRenderSettings& settings);
+    static uint64_t HashValues(std::initializer_list<int64_t> values);
 
-    static int IsoToInt(const gem::String& iso);
+    static uint32_t GetPixelFlags(ETextureFormat format, bool bPremultiplied);
+    static TextureKey GetFlagAtlasPageKey(int page, int pageWidth, int pageHeight, int flagWidth, int flagHeight, int flagCount);
 
 private:
-    std::map<unsigned int, unsigned int> m_ImagesUidToTextureId;
+    TextureCache m_textureCache;
+
+    DiskTextureCache m_diskCache;
+
+    // shared with the resource repository, read when the flags atlas is built
+    CountryMetadataPtr m_countries;
+
+    // laid out on the render thread, the pages are rendered by the workers and uploaded by Tick()
+    FlagAtlas m_flagAtlas;
+    unsigned int m_flagAtlasGeneration;
+
+    // requested textures, not uploaded yet (render thread only)
+    std::map<TextureKey, PendingTexture> m_pendingTextures;
+
+    // prefetch batches not completed yet (render thread only)
+    std::vector<std::shared_ptr<PrefetchBatch>> m_prefetchBatches;
+
+    // textures rendered by the workers, waiting for the upload
+    std::deque<RenderedTexture> m_renderedTextures;
+    std::deque<RenderedAtlasPage> m_renderedAtlasPages;
+    std::mutex m_renderedTexturesSync;
+
+    size_t m_uploadBudget;
+
+    ETextureFormat m_textureFormat;
+    bool m_bPremultipliedAlpha;
+
+    TextureUploader m_textureUploader;
 
-    // Countries iso to image ids
-    std::map<int, unsigned int> m_countriesIsoToImageUids;
+    WorkerPool m_workerPool;
 };
@@ -0,0 +1,191 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "TextureUploader.h"
+
+#include "GLES3/gl3.h"
+
+#include <cstring>
+#include <cstdlib>
+
+// number of pixel buffers in the ring
+const size_t PIXEL_BUFFER_COUNT = 4;
+
+TextureUploader::TextureUploader()
+    : m_bInitialized( false )
+    , m_bPixelBufferSupported( false )
+    , m_requestedMode( ETextureUploadMode::PixelBuffer )
+    , m_mode( ETextureUploadMode::Direct )
+    , m_nextPixelBuffer( 0 )
+{
+
+}
+
+TextureUploader::~TextureUploader()
+{
+    Release();
+}
+
+void TextureUploader::SetMode( ETextureUploadMode mode )
+{
+    m_requestedMode = mode;
+
+    if ( m_bInitialized )
+        m_mode = m_bPixelBufferSupported ? m_requestedMode : ETextureUploadMode::Direct;
+}
+
+ETextureUploadMode TextureUploader::GetMode() const
+{
+    return m_mode;
+}
+
+unsigned int TextureUploader::Upload( int width, int height, const void* data, ETextureFormat format /* = ETextureFormat::RGBA8888 */ )
+{
+    // lazy, the GL context is not current when the repository is created
+    if ( !m_bInitialized )
+        Initialize();
+
+    if ( m_mode == ETextureUploadMode::PixelBuffer )
+        return UploadPixelBuffer( width, height, data, format );
+
+    return UploadDirect( width, height, data, format );
+}
+
+size_t TextureUploader::GetBytesPerPixel( ETextureFormat format )
+{
+    return format == ETextureFormat::RGB565 ? 2 : 4;
+}
+
+void TextureUploader::Release()
+{
+    if ( !m_pixelBuffers.empty() )
+        glDeleteBuffers( (GLsizei)m_pixelBuffers.size(), m_pixelBuffers.data() );
+
+    m_pixelBuffers.clear();
+    m_pixelBufferSizes.clear();
+    m_nextPixelBuffer = 0;
+}
+
+void TextureUploader::Initialize()
+{
+    m_bInitialized = true;
+    m_bPixelBufferSupported = IsPixelBufferSupported();
+
+    m_mode = m_bPixelBufferSupported ? m_requestedMode : ETextureUploadMode::Direct;
+}
+
+unsigned int TextureUploader::CreateTexture( int width, int height, const void* data, ETextureFormat format )
+{
+    unsigned int textureId;
+    unsigned int glFormat, glType;
+
+    GetFormat( format, glFormat, glType );
+
+    glGenTextures( 1, &textureId );
+    glBindTexture( GL_TEXTURE_2D, textureId );
+
+    // Setup filtering parameters for display
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE ); // Required on WebGL for non power-of-two textures
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE ); // Required on WebGL for non power-of-two textures
+
+    // Upload pixels into texture (data == nullptr only allocates the storage)
+#ifdef GL_UNPACK_ROW_LENGTH
+    glPixelStorei( GL_UNPACK_ROW_LENGTH, 0 );
+#endif
+    // 16 bit rows of odd width are not 4 byte aligned
+    glPixelStorei( GL_UNPACK_ALIGNMENT, format == ETextureFormat::RGB565 ? 2 : 4 );
+    glTexImage2D( GL_TEXTURE_2D, 0, glFormat, width, height, 0, glFormat, glType, data );
+
+    return textureId;
+}
+
+unsigned int TextureUploader::UploadDirect( int width, int height, const void* data, ETextureFormat format )
+{
+    return CreateTexture( width, height, data, format );
+}
+
+unsigned int TextureUploader::UploadPixelBuffer( int width, int height, const void* data, ETextureFormat format )
+{
+    if ( m_pixelBuffers.empty() )
+    {
+        m_pixelBuffers.resize( PIXEL_BUFFER_COUNT, 0 );
+        m_pixelBufferSizes.resize( PIXEL_BUFFER_COUNT, 0 );
+
+        glGenBuffers( (GLsizei)PIXEL_BUFFER_COUNT, m_pixelBuffers.data() );
+    }
+
+    size_t bytes = (size_t)width * (size_t)height * GetBytesPerPixel( format );
+    size_t index = m_nextPixelBuffer;
+    m_nextPixelBuffer = ( m_nextPixelBuffer + 1 ) % m_pixelBuffers.size();
+
+    // pre-allocated texture storage, filled from the pixel buffer below
+    unsigned int textureId = CreateTexture( width, height, nullptr, format );
+
+    unsigned int glFormat, glType;
+    GetFormat( format, glFormat, glType );
+
+    glBindBuffer( GL_PIXEL_UNPACK_BUFFER, m_pixelBuffers[index] );
+
+    if ( m_pixelBufferSizes[index] < bytes )
+        m_pixelBufferSizes[index] = bytes;
+
+    // orphan the previous contents, the driver may still be reading them
+    glBufferData( GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)m_pixelBufferSizes[index], nullptr, GL_STREAM_DRAW );
+
+    void* mapped = glMapBufferRange( GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT );
+    if ( !mapped )
+    {
+        glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+        glBindTexture( GL_TEXTURE_2D, textureId );
+        glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, width, height, glFormat, glType, data );
+        return textureId;
+    }
+
+    memcpy( mapped, data, bytes );
+    glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER );
+
+    // asynchronous copy: the source is the bound pixel buffer, offset 0
+    glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, width, height, glFormat, glType, nullptr );
+
+    glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+    return textureId;
+}
+
+void TextureUploader::GetFormat( ETextureFormat format, unsigned int& glFormat, unsigned int& glType )
+{
+    switch ( format )
+    {
+    case ETextureFormat::RGB565:
+        glFormat = GL_RGB;
+        glType = GL_UNSIGNED_SHORT_5_6_5;
+        return;
+    case ETextureFormat::RGBA8888:
+        break;
+    }
+
+    glFormat = GL_RGBA;
+    glType = GL_UNSIGNED_BYTE;
+}
+
+bool TextureUploader::IsPixelBufferSupported()
+{
+    // "OpenGL ES 3.0 ..." (GLES, ANGLE) or "3.0 ..." (desktop GL)
+    const char* version = (const char*)glGetString( GL_VERSION );
+    if ( !version )
+        return false;
+
+    const char* ES_PREFIX = "OpenGL ES ";
+    if ( strncmp( version, ES_PREFIX, strlen( ES_PREFIX ) ) == 0 )
+        version += strlen( ES_PREFIX );
+
+    return atoi( version ) >= 3;
+}
@@ -0,0 +1,58 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include "ITextureRepository.h"
+
+#include <vector>
+
+// Creates GL textures from client memory bitmaps, either directly (glTexImage2D)
+// or staged through a ring of pixel buffer objects (needs GL 3.0 / GLES 3.0)
+class TextureUploader
+{
+public:
+    TextureUploader();
+    ~TextureUploader();
+
+    // falls back to ETextureUploadMode::Direct when pixel buffers are not supported
+    void SetMode( ETextureUploadMode mode );
+    ETextureUploadMode GetMode() const;
+
+    // must be called on the render thread; RGB565 data is 16 bit per pixel
+    unsigned int Upload( int width, int height, const void* data, ETextureFormat format = ETextureFormat::RGBA8888 );
+
+    static size_t GetBytesPerPixel( ETextureFormat format );
+
+    void Release();
+
+private:
+    void Initialize();
+
+    static unsigned int CreateTexture( int width, int height, const void* data, ETextureFormat format );
+
+    unsigned int UploadDirect( int width, int height, const void* data, ETextureFormat format );
+    unsigned int UploadPixelBuffer( int width, int height, const void* data, ETextureFormat format );
+
+    // GL format & type
+    static void GetFormat( ETextureFormat format, unsigned int& glFormat, unsigned int& glType );
+
+    static bool IsPixelBufferSupported();
+
+private:
+    bool m_bInitialized;
+    bool m_bPixelBufferSupported;
+
+    ETextureUploadMode m_requestedMode;
+    ETextureUploadMode m_mode;
+
+    // ring of pixel buffers, reused round robin so that a buffer still read by the driver is not rewritten
+    std::vector<unsigned int> m_pixelBuffers;
+    std::vector<size_t> m_pixelBufferSizes;
+    size_t m_nextPixelBuffer;
+};
@@ -0,0 +1,411 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "WaypointOrderOptimizer.h"
+
+#include <cmath>
+#include <random>
+#include <numeric>
+#include <algorithm>
+
+// travel time used for the pairs without a route (about a week), so that they are avoided
+const long long NO_ROUTE_SECONDS = 7 * 24 * 3600;
+
+// Or-opt moves segments up to this length
+const size_t MAX_MOVED_SEGMENT = 3;
+
+const double EARTH_RADIUS_METERS = 6371000.0;
+const double DEGREES_TO_RADIANS = 3.14159265358979323846 / 180.0;
+
+// road distance / straight line distance, on average
+const double ROAD_DETOUR_FACTOR = 1.3;
+
+struct WaypointOrderOptimizer::PendingSearch
+{
+    PendingSearch( WaypointOrderOptimizerPtr optimizer_, unsigned int seed_ )
+        : optimizer( optimizer_ )
+        , seed( seed_ )
+        , bRun( false )
+    {}
+
+    ~PendingSearch()
+    {
+        if ( !bRun )
+            optimizer->OnSearchDropped();
+    }
+
+    void Run()
+    {
+        bRun = true;
+        optimizer->OnSearchComplete( optimizer->Search( seed ) );
+    }
+
+    WaypointOrderOptimizerPtr optimizer;
+    unsigned int seed;
+    bool bRun;
+};
+
+// meters per second, on average over a trip
+static double GetTypicalSpeed( ETransportMode mode )
+{
+    switch ( mode )
+    {
+    case ETransportMode::Car:
+        return 50 / 3.6;
+    case ETransportMode::Truck:
+        return 40 / 3.6;
+    case ETransportMode::Pedestrian:
+        return 5 / 3.6;
+    case ETransportMode::RoadBike:
+        return 20 / 3.6;
+    default:
+        return 15 / 3.6;
+    }
+}
+
+// great circle distance (haversine)
+static double GetStraightDistance( const gem::Coordinates& from, const gem::Coordinates& to )
+{
+    double latitudeDelta = ( to.getLatitude() - from.getLatitude() ) * DEGREES_TO_RADIANS;
+    double longitudeDelta = ( to.getLongitude() - from.getLongitude() ) * DEGREES_TO_RADIANS;
+
+    double a = std::sin( latitudeDelta / 2 ) * std::sin( latitudeDelta / 2 ) +
+        std::cos( from.getLatitude() * DEGREES_TO_RADIANS ) * std::cos( to.getLatitude() * DEGREES_TO_RADIANS ) *
+        std::sin( longitudeDelta / 2 ) * std::sin( longitudeDelta / 2 );
+
+    return 2 * EARTH_RADIUS_METERS * std::asin( std::min( 1.0, std::sqrt( a ) ) );
+}
+
+WaypointOrderOptimizer::WaypointOrderOptimizer( const RouteMatrix& matrix )
+    : m_count( matrix.originCount )
+    , m_pendingSearches( 0 )
+    , m_bestCost( 0 )
+    , m_optimizeSeconds( 0 )
+{
+    m_times.resize( matrix.timeSeconds.size() );
+
+    for ( size_t cell = 0; cell < matrix.timeSeconds.size(); cell++ )
+        m_times[cell] = matrix.timeSeconds[cell] < 0 ? NO_ROUTE_SECONDS : matrix.timeSeconds[cell];
+
+    m_bestOrder.resize( m_count );
+    std::iota( m_bestOrder.begin(), m_bestOrder.end(), size_t( 0 ) );
+    m_bestCost = GetCost( m_bestOrder );
+}
+
+void WaypointOrderOptimizer::Start( WorkerPool& workerPool, size_t searchCount, int priority /* = 0 */ )
+{
+    {
+        std::lock_guard<std::mutex> guard( m_sync );
+
+        m_pendingSearches = searchCount > 0 ? searchCount : 1;
+        m_startTime = std::chrono::steady_clock::now();
+    }
+
+    auto self = shared_from_this();
+
+    for ( unsigned int seed = 0; seed < searchCount || seed == 0; seed++ )
+    {
+        auto search = std::make_shared<PendingSearch>( self, seed );
+
+        workerPool.Execute( [search]() { search->Run(); }, priority );
+    }
+}
+
+bool WaypointOrderOptimizer::IsDone() const
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    return m_pendingSearches == 0;
+}
+
+WaypointOrderReport WaypointOrderOptimizer::GetReport() const
+{
+    std::vector<size_t> inputOrder( m_count );
+    std::iota( inputOrder.begin(), inputOrder.end(), size_t( 0 ) );
+
+    WaypointOrderReport report;
+    report.inputSeconds = GetCost( inputOrder );
+
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    report.order = m_bestOrder;
+    report.optimizedSeconds = m_bestCost;
+    report.optimizeSeconds = m_optimizeSeconds;
+
+    return report;
+}
+
+long long WaypointOrderOptimizer::GetCost( const std::vector<size_t>& order ) const
+{
+    long long cost = 0;
+
+    for ( size_t index = 1; index < order.size(); index++ )
+        cost += GetTime( order[index - 1], order[index] );
+
+    return cost;
+}
+
+RouteMatrix WaypointOrderOptimizer::EstimateMatrix( const gem::LandmarkList& waypoints, ETransportMode mode )
+{
+    const size_t count = waypoints.size();
+    const double speed = GetTypicalSpeed( mode );
+
+    RouteMatrix estimate;
+    estimate.originCount = count;
+    estimate.destinationCount = count;
+    estimate.timeSeconds.assign( count * count, 0 );
+    estimate.distanceMeters.assign( count * count, 0 );
+
+    for ( size_t origin = 0; origin < count; origin++ )
+    {
+        for ( size_t destination = 0; destination < count; destination++ )
+        {
+            if ( origin == destination )
+                continue;
+
+            double distance = GetStraightDistance( waypoints.toStd()[origin].getCoordinates(), waypoints.toStd()[destination].getCoordinates() ) * ROAD_DETOUR_FACTOR;
+
+            size_t cell = estimate.GetCell( origin, destination );
+            estimate.timeSeconds[cell] = int( std::lround( distance / speed ) );
+            estimate.distanceMeters[cell] = int( std::lround( distance ) );
+        }
+    }
+
+    return estimate;
+}
+
+std::vector<size_t> WaypointOrderOptimizer::GetCandidateCells( const RouteMatrix& estimate, size_t neighbourCount )
+{
+    const size_t count = estimate.originCount;
+
+    auto isLeg = [count]( size_t origin, size_t destination )
+    {
+        return origin != destination && destination != 0 && origin + 1 != count && !( origin == 0 && destination + 1 == count );
+    };
+
+    std::vector<bool> bCandidate( count * count, false );
+    std::vector<size_t> neighbours;
+
+    for ( size_t waypoint = 0; waypoint < count; waypoint++ )
+    {
+        neighbours.clear();
+
+        for ( size_t other = 0; other < count; other++ )
+            if ( other != waypoint )
+                neighbours.push_back( other );
+
+        size_t nearestCount = std::min( neighbourCount, neighbours.size() );
+
+        std::partial_sort( neighbours.begin(), neighbours.begin() + nearestCount, neighbours.end(), [&]( size_t a, size_t b )
+        {
+            return estimate.timeSeconds[estimate.GetCell( waypoint, a )] < estimate.timeSeconds[estimate.GetCell( waypoint, b )];
+        } );
+
+        for ( size_t index = 0; index < nearestCount; index++ )
+        {
+            size_t other = neighbours[index];
+
+            if ( isLeg( waypoint, other ) )
+                bCandidate[estimate.GetCell( waypoint, other )] = true;
+
+            if ( isLeg( other, waypoint ) )
+                bCandidate[estimate.GetCell( other, waypoint )] = true;
+        }
+    }
+
+    std::vector<size_t> cells;
+
+    for ( size_t cell = 0; cell < bCandidate.size(); cell++ )
+        if ( bCandidate[cell] )
+            cells.push_back( cell );
+
+    return cells;
+}
+
+RouteMatrix WaypointOrderOptimizer::MergeMatrix( const RouteMatrix& estimate, const RouteMatrix& routed, const std::vector<size_t>& cells )
+{
+    std::vector<double> ratios;
+
+    for ( auto cell : cells )
+        if ( routed.timeSeconds[cell] >= 0 && estimate.timeSeconds[cell] > 0 )
+            ratios.push_back( double( routed.timeSeconds[cell] ) / estimate.timeSeconds[cell] );
+
+    double ratio = 1;
+
+    if ( !ratios.empty() )
+    {
+        std::nth_element( ratios.begin(), ratios.begin() + ratios.size() / 2, ratios.end() );
+        ratio = ratios[ratios.size() / 2];
+    }
+
+    RouteMatrix merged = estimate;
+    merged.elapsedSeconds = routed.elapsedSeconds;
+
+    for ( auto& timeSeconds : merged.timeSeconds )
+        timeSeconds = int( std::lround( timeSeconds * ratio ) );
+
+    for ( auto cell : cells )
+    {
+        merged.timeSeconds[cell] = routed.timeSeconds[cell];
+        merged.distanceMeters[cell] = routed.distanceMeters[cell];
+
+        if ( routed.timeSeconds[cell] < 0 )
+            merged.failedCount++;
+    }
+
+    return merged;
+}
+
+std::vector<size_t> WaypointOrderOptimizer::Search( unsigned int seed ) const
+{
+    std::vector<size_t> order = GetStartOrder( seed );
+
+    // nothing to reorder with less than 2 intermediate stops
+    if ( m_count < 4 )
+        return order;
+
+    while ( ImproveByReversal( order ) || ImproveByMove( order ) )
+        ;
+
+    return order;
+}
+
+std::vector<size_t> WaypointOrderOptimizer::GetStartOrder( unsigned int seed ) const
+{
+    std::vector<size_t> order( m_count );
+    std::iota( order.begin(), order.end(), size_t( 0 ) );
+
+    if ( seed == 0 || m_count < 4 )
+        return order;
+
+    if ( seed == 1 )
+    {
+        // nearest neighbour from the departure
+        for ( size_t index = 1; index + 1 < m_count; index++ )
+        {
+            auto nearest = std::min_element( order.begin() + index, order.end() - 1, [&]( size_t a, size_t b )
+            {
+                return GetTime( order[index - 1], a ) < GetTime( order[index - 1], b );
+            } );
+
+            std::iter_swap( order.begin() + index, nearest );
+        }
+
+        return order;
+    }
+
+    std::mt19937 random( seed );
+    std::shuffle( order.begin() + 1, order.end() - 1, random );
+
+    return order;
+}
+
+bool WaypointOrderOptimizer::ImproveByReversal( std::vector<size_t>& order ) const
+{
+    // the travel times are not symmetric: the reversed segment is costed in both directions
+    for ( size_t first = 1; first + 2 < m_count; first++ )
+    {
+        long long forwardCost = 0;
+        long long reverseCost = 0;
+
+        for ( size_t last = first + 1; last + 1 < m_count; last++ )
+        {
+            forwardCost += GetTime( order[last - 1], order[last] );
+            reverseCost += GetTime( order[last], order[last - 1] );
+
+            long long oldCost = GetTime( order[first - 1], order[first] ) + forwardCost + GetTime( order[last], order[last + 1] );
+            long long newCost = GetTime( order[first - 1], order[last] ) + reverseCost + GetTime( order[first], order[last + 1] );
+
+            if ( newCost < oldCost )
+            {
+                std::reverse( order.begin() + first, order.begin() + last + 1 );
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool WaypointOrderOptimizer::ImproveByMove( std::vector<size_t>& order ) const
+{
+    for ( size_t length = 1; length <= MAX_MOVED_SEGMENT; length++ )
+    {
+        for ( size_t first = 1; first + length < m_count; first++ )
+        {
+            size_t last = first + length - 1;
+
+            size_t before = order[first - 1];
+            size_t after = order[last + 1];
+
+            long long removeGain = GetTime( before, order[first] ) + GetTime( order[last], after ) - GetTime( before, after );
+
+            // inserted between order[position] and order[position + 1]
+            for ( size_t position = 0; position + 1 < m_count; position++ )
+            {
+                if ( position + 1 >= first && position <= last )
+                    continue;
+
+                long long insertCost = GetTime( order[position], order[first] ) + GetTime( order[last], order[position + 1] ) - GetTime( order[position], order[position + 1] );
+
+                if ( insertCost < removeGain )
+                {
+                    std::vector<size_t> segment( order.begin() + first, order.begin() + last + 1 );
+
+                    if ( position < first )
+                    {
+                        order.erase( order.begin() + first, order.begin() + last + 1 );
+                        order.insert( order.begin() + position + 1, segment.begin(), segment.end() );
+                    }
+                    else
+                    {
+                        order.insert( order.begin() + position + 1, segment.begin(), segment.end() );
+                        order.erase( order.begin() + first, order.begin() + last + 1 );
+                    }
+
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+long long WaypointOrderOptimizer::GetTime( size_t from, size_t to ) const
+{
+    return m_times[from * m_count + to];
+}
+
+void WaypointOrderOptimizer::OnSearchComplete( const std::vector<size_t>& order )
+{
+    long long cost = GetCost( order );
+
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    if ( cost < m_bestCost )
+    {
+        m_bestCost = cost;
+        m_bestOrder = order;
+    }
+
+    CompleteSearch();
+}
+
+void WaypointOrderOptimizer::OnSearchDropped()
+{
+    std::lock_guard<std::mutex> guard( m_sync );
+
+    CompleteSearch();
+}
+
+void WaypointOrderOptimizer::CompleteSearch()
+{
+    if ( m_pendingSearches > 0 && --m_pendingSearches == 0 )
+        m_optimizeSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - m_startTime ).count();
+}
@@ -0,0 +1,90 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include "IMapService.h"
+#include "WorkerPool.h"
+
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+// Reorders the intermediate stops of a waypoint list (the first and the last stay in place) to
+// minimise the travel time, given the travel times matrix between all the waypoints. Several local
+// searches (2-opt segment reversals and Or-opt moves of 1 to 3 stops) run in parallel on the worker
+// pool, from the input order, a nearest neighbour order and random orders; the best one is kept.
+// With many waypoints only the candidate cells are routed (see GetCandidateCells), the rest of the
+// matrix is estimated from the straight line distances.
+class WaypointOrderOptimizer : public std::enable_shared_from_this<WaypointOrderOptimizer>
+{
+public:
+    // matrix = the waypoints to themselves
+    WaypointOrderOptimizer( const RouteMatrix& matrix );
+
+    // a search dropped by a stopped pool completes without a result
+    void Start( WorkerPool& workerPool, size_t searchCount, int priority = 0 );
+
+    // all the searches completed (or dropped)
+    bool IsDone() const;
+
+    // the best order found, optimizeSeconds = from Start to the last search
+    WaypointOrderReport GetReport() const;
+
+    // sum of the travel times between the consecutive waypoints
+    long long GetCost( const std::vector<size_t>& order ) const;
+
+    // travel times of the straight line distances (stretched to a road distance) at a typical
+    // speed of the mode
+    static RouteMatrix EstimateMatrix( const gem::LandmarkList& waypoints, ETransportMode mode );
+
+    // The cells worth routing: from each waypoint to its neighbourCount nearest ones and from these
+    // to it, by the estimate. The legs no order uses (into the departure, out of the arrival, the
+    // departure straight to the arrival) are left out.
+    static std::vector<size_t> GetCandidateCells( const RouteMatrix& estimate, size_t neighbourCount );
+
+    // the routed cells replace their estimates (-1 if no route), the other estimates are scaled by
+    // the median routed / estimated time ratio
+    static RouteMatrix MergeMatrix( const RouteMatrix& estimate, const RouteMatrix& routed, const std::vector<size_t>& cells );
+
+private:
+    // a search queued on the pool, completed when its task is dropped without running
+    struct PendingSearch;
+    // first improvement local search, restarted until no move improves the order
+    std::vector<size_t> Search( unsigned int seed ) const;
+
+    std::vector<size_t> GetStartOrder( unsigned int seed ) const;
+
+    // 2-opt: reverses the segment [first, last]
+    bool ImproveByReversal( std::vector<size_t>& order ) const;
+    // Or-opt: moves a segment of 1 to 3 waypoints elsewhere
+    bool ImproveByMove( std::vector<size_t>& order ) const;
+
+    long long GetTime( size_t from, size_t to ) const;
+
+    void OnSearchComplete( const std::vector<size_t>& order );
+    void OnSearchDropped();
+
+    // lock held
+    void CompleteSearch();
+
+private:
+    size_t m_count;
+    std::vector<long long> m_times; // by origin, the pairs without a route are penalised
+
+    mutable std::mutex m_sync;
+
+    size_t m_pendingSearches;
+    std::vector<size_t> m_bestOrder;
+    long long m_bestCost;
+
+    std::chrono::steady_clock::time_point m_startTime;
+    double m_optimizeSeconds;
+};
+using WaypointOrderOptimizerPtr = std::shared_ptr<WaypointOrderOptimizer>;
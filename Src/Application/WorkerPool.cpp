@@ -0,0 +1,92 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool( unsigned int threadCount /*= 0*/ )
+    : m_bStop( false )
+{
+    if ( threadCount == 0 )
+    {
+        unsigned int cores = std::thread::hardware_concurrency(); // 0 if unknown
+        threadCount = cores > 1 ? cores - 1 : 1;
+    }
+
+    for ( unsigned int i = 0; i < threadCount; i++ )
+        m_threads.emplace_back( &WorkerPool::Run, this );
+}
+
+WorkerPool::~WorkerPool()
+{
+    Stop();
+}
+
+void WorkerPool::Execute( WorkerTask task, int priority /*= 0*/ )
+{
+    {
+        std::lock_guard<std::mutex> guard( m_sync );
+
+        if ( m_bStop )
+            return;
+
+        m_tasks[priority].push_back( task );
+    }
+
+    m_condition.notify_one();
+}
+
+void WorkerPool::Stop()
+{
+    {
+        std::lock_guard<std::mutex> guard( m_sync );
+
+        m_bStop = true;
+        m_tasks.clear();
+    }
+
+    m_condition.notify_all();
+
+    for ( auto& thread : m_threads )
+        if ( thread.joinable() )
+            thread.join();
+
+    m_threads.clear();
+}
+
+unsigned int WorkerPool::GetThreadCount() const
+{
+    return (unsigned int)m_threads.size();
+}
+
+void WorkerPool::Run()
+{
+    while ( true )
+    {
+        WorkerTask task;
+
+        {
+            std::unique_lock<std::mutex> lock( m_sync );
+
+            m_condition.wait( lock, [&]() { return m_bStop || !m_tasks.empty(); } );
+
+            if ( m_bStop )
+                return;
+
+            // empty queues are erased, the first one has the highest priority
+            auto it = m_tasks.begin();
+
+            task = it->second.front();
+            it->second.pop_front();
+
+            if ( it->second.empty() )
+                m_tasks.erase( it );
+        }
+
+        task();
+    }
+}
@@ -0,0 +1,47 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#pragma once
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+using WorkerTask = std::function<void( void )>;
+
+// Fixed number of threads executing queued tasks (higher priority first, FIFO within a priority)
+class WorkerPool
+{
+public:
+    // threadCount == 0 uses all the cores but one (left for the UI / render thread)
+    WorkerPool( unsigned int threadCount = 0 );
+    ~WorkerPool();
+
+    void Execute( WorkerTask task, int priority = 0 );
+
+    // waits for the running tasks, the queued ones are dropped
+    void Stop();
+
+    unsigned int GetThreadCount() const;
+
+private:
+    void Run();
+
+private:
+    std::vector<std::thread> m_threads;
+
+    std::map<int, std::deque<WorkerTask>, std::greater<int>> m_tasks; // priority -> tasks
+    std::mutex m_sync;
+    std::condition_variable m_condition;
+
+    bool m_bStop;
+};
@@ -0,0 +1,93 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "PixelConverter.h"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+#include <cstdint>
+
+enum class EPixelKernel
+{
+    Swizzle,
+    Premultiply,
+    Unpremultiply,
+    Rgb565
+};
+
+// a 256 x 256 texture and a 1024 x 1024 one (past the L2 cache)
+const int SMALL_PIXEL_COUNT = 256 * 256;
+const int LARGE_PIXEL_COUNT = 1024 * 1024;
+
+// RGBA pixels with every alpha value, so that both the opaque / transparent shortcuts and the
+// divisions are taken
+static std::vector<uint8_t> MakePixels( size_t count )
+{
+    std::vector<uint8_t> pixels( count * 4 );
+
+    for ( size_t index = 0; index < pixels.size(); index++ )
+        pixels[index] = uint8_t( index * 7 + ( index >> 8 ) );
+
+    return pixels;
+}
+
+// One iteration converts 'count' pixels with the kernel at the given SIMD level. The throughput
+// counts the source bytes (4 per pixel). args: kernel, SIMD level, pixel count
+static void ConvertPixels( benchmark::State& state )
+{
+    EPixelKernel kernel = EPixelKernel( state.range( 0 ) );
+    ESimdLevel level = ESimdLevel( state.range( 1 ) );
+    size_t count = size_t( state.range( 2 ) );
+
+    PixelConverter::SetSimdLevel( level );
+
+    if ( PixelConverter::GetSimdLevel() != level )
+    {
+        state.SkipWithError( "SIMD level not supported by the CPU" );
+        return;
+    }
+
+    std::vector<uint8_t> pixels = MakePixels( count );
+    std::vector<uint16_t> rgb565( count );
+
+    for ( auto _ : state )
+    {
+        // in place conversions are applied over the previous output, the cost doesn't depend on the values
+        switch ( kernel )
+        {
+        case EPixelKernel::Swizzle:
+            PixelConverter::SwizzleAbgrRgba( pixels.data(), count );
+            break;
+        case EPixelKernel::Premultiply:
+            PixelConverter::PremultiplyAlpha( pixels.data(), count );
+            break;
+        case EPixelKernel::Unpremultiply:
+            PixelConverter::UnpremultiplyAlpha( pixels.data(), count );
+            break;
+        case EPixelKernel::Rgb565:
+            PixelConverter::RgbaToRgb565( pixels.data(), rgb565.data(), count );
+            break;
+        }
+
+        benchmark::DoNotOptimize( pixels.data() );
+        benchmark::DoNotOptimize( rgb565.data() );
+        benchmark::ClobberMemory();
+    }
+
+    // the runtime detected level for the next runs
+    PixelConverter::SetSimdLevel( ESimdLevel::AVX2 );
+
+    state.SetBytesProcessed( int64_t( state.iterations() ) * int64_t( count ) * 4 );
+}
+
+BENCHMARK( ConvertPixels )
+    ->ArgNames( { "kernel", "simd", "pixels" } )
+    ->ArgsProduct( { { int( EPixelKernel::Swizzle ), int( EPixelKernel::Premultiply ), int( EPixelKernel::Unpremultiply ), int( EPixelKernel::Rgb565 ) },
+                     { int( ESimdLevel::Scalar ), int( ESimdLevel::SSE2 ), int( ESimdLevel::AVX2 ) },
+                     { SMALL_PIXEL_COUNT, LARGE_PIXEL_COUNT } } );
@@ -0,0 +1,81 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "RouteArchive.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+const int ROUTE_COUNT = 3;
+const int INSTRUCTION_COUNT = 100;
+
+// departure & arrival, 3 alternatives of 'points' polyline points and 100 instructions each
+static StoredRoutes MakeRoutes( int points )
+{
+    StoredRoutes routes;
+    routes.mapVersion = 1;
+
+    routes.waypoints.push_back( gem::Landmark( "Departure", { 45.65119, 25.60480 } ) );
+    routes.waypoints.push_back( gem::Landmark( "Arrival", { 45.84494, 24.97414 } ) );
+
+    for ( int index = 0; index < ROUTE_COUNT; index++ )
+    {
+        StoredRoute route;
+        route.timeSeconds = 3600 + index * 120;
+        route.distanceMeters = 62000 + index * 1500;
+
+        for ( int point = 0; point < points; point++ )
+            route.polyline.push_back( gem::Coordinates( 45.65119 + point * 0.19375 / points, 25.60480 - point * 0.63066 / points + index * 0.0001 ) );
+
+        for ( int instruction = 0; instruction < INSTRUCTION_COUNT; instruction++ )
+        {
+            StoredRouteInstruction stored;
+            stored.coordinates = route.polyline[instruction * points / INSTRUCTION_COUNT];
+            stored.timeSeconds = instruction * 36;
+            stored.distanceMeters = instruction * 620;
+            stored.text = "Turn right onto Strada " + std::to_string( instruction );
+
+            route.instructions.push_back( stored );
+        }
+
+        routes.routes.push_back( route );
+    }
+
+    return routes;
+}
+
+// One iteration decodes an archive encoded once, as Read does after mapping the file. Only the
+// decoding: computing the routes again needs the SDK, LoadRoutes logs its p50 next to the load time.
+// args: polyline points per route
+static void DecodeRoutes( benchmark::State& state )
+{
+    std::vector<unsigned char> buffer;
+    RouteArchive::Encode( MakeRoutes( int( state.range( 0 ) ) ), buffer );
+
+    for ( auto _ : state )
+    {
+        StoredRoutes routes;
+
+        if ( !RouteArchive::Decode( buffer.data(), buffer.size(), routes ) )
+        {
+            state.SkipWithError( "archive not decoded" );
+            break;
+        }
+
+        benchmark::DoNotOptimize( routes.routes.data() );
+    }
+
+    state.SetBytesProcessed( int64_t( state.iterations() ) * int64_t( buffer.size() ) );
+    state.counters["points/s"] = benchmark::Counter( double( state.iterations() ) * ROUTE_COUNT * double( state.range( 0 ) ), benchmark::Counter::kIsRate );
+}
+
+BENCHMARK( DecodeRoutes )
+    ->ArgName( "points" )
+    ->Arg( 1000 )
+    ->Arg( 10000 );
@@ -0,0 +1,200 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "RouteMatrixOperation.h"
+
+#include <API/GEM_Error.h>
+
+#include <benchmark/benchmark.h>
+
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
+
+// Routing service stand-in: each computation completes 'latency' after its start, from a worker
+// thread (from within the call for a zero latency). It finds no route (SDK routes can't be made
+// outside a computation), so every cell completes as not found: what is measured is the cost of
+// the matrix itself, starting the cells and collecting the results, and how the parallel routes
+// overlap the latency.
+class FakeRouteBackend : public IRouteBackend
+{
+public:
+    FakeRouteBackend( std::chrono::microseconds latency )
+        : m_latency( latency )
+        , m_bStop( false )
+    {
+        if ( m_latency.count() > 0 )
+            m_worker = std::thread( [this]() { Run(); } );
+    }
+
+    ~FakeRouteBackend()
+    {
+        {
+            std::lock_guard<std::mutex> guard( m_sync );
+            m_bStop = true;
+        }
+
+        m_condition.notify_one();
+
+        if ( m_worker.joinable() )
+            m_worker.join();
+    }
+
+    int CalculateRoute( gem::RouteList& routes, const gem::LandmarkList& waypoints, const gem::RoutePreferences& preferences, gem::StrongPointer<gem::IProgressListener> listener ) override
+    {
+        if ( m_latency.count() == 0 )
+        {
+            listener->notifyComplete( gem::KNoError, gem::String() );
+            return gem::KNoError;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard( m_sync );
+            m_computations.push_back( Computation( std::chrono::steady_clock::now() + m_latency, gem::KNoError, listener ) );
+        }
+
+        m_condition.notify_one();
+        return gem::KNoError;
+    }
+
+    void CancelRoute( gem::StrongPointer<gem::IProgressListener> listener ) override
+    {
+        {
+            std::lock_guard<std::mutex> guard( m_sync );
+
+            for ( auto& computation : m_computations )
+                if ( computation.listener == listener )
+                {
+                    computation.dueTime = std::chrono::steady_clock::now();
+                    computation.reason = gem::error::KCancel;
+                }
+        }
+
+        m_condition.notify_one();
+    }
+
+private:
+    struct Computation
+    {
+        Computation( std::chrono::steady_clock::time_point dueTime_, int reason_, gem::StrongPointer<gem::IProgressListener> listener_ )
+            : dueTime( dueTime_ )
+            , reason( reason_ )
+            , listener( listener_ )
+        {}
+
+        std::chrono::steady_clock::time_point dueTime;
+        int reason;
+        gem::StrongPointer<gem::IProgressListener> listener;
+    };
+
+    // the computations complete in start order (same latency), cancelled ones right away
+    void Run()
+    {
+        std::unique_lock<std::mutex> lock( m_sync );
+
+        for ( ;; )
+        {
+            if ( m_bStop )
+                return;
+
+            if ( m_computations.empty() )
+            {
+                m_condition.wait( lock );
+                continue;
+            }
+
+            auto it = m_computations.begin();
+            for ( auto computation = m_computations.begin(); computation != m_computations.end(); computation++ )
+                if ( computation->dueTime < it->dueTime )
+                    it = computation;
+
+            if ( std::chrono::steady_clock::now() < it->dueTime )
+            {
+                m_condition.wait_until( lock, it->dueTime );
+                continue;
+            }
+
+            Computation computation = *it;
+            m_computations.erase( it );
+
+            // outside the lock, the completion may start the next computation
+            lock.unlock();
+            computation.listener->notifyComplete( computation.reason, gem::String() );
+            lock.lock();
+        }
+    }
+
+private:
+    std::chrono::microseconds m_latency;
+
+    std::deque<Computation> m_computations;
+    bool m_bStop;
+
+    std::mutex m_sync;
+    std::condition_variable m_condition;
+    std::thread m_worker;
+};
+
+// n origins, n destinations a few km apart
+static void MakeLandmarks( size_t count, gem::LandmarkList& origins, gem::LandmarkList& destinations )
+{
+    for ( size_t index = 0; index < count; index++ )
+    {
+        origins.push_back( gem::Landmark( "Origin", { 45.65 + index * 0.01, 25.60 } ) );
+        destinations.push_back( gem::Landmark( "Destination", { 45.84 + index * 0.01, 24.97 } ) );
+    }
+}
+
+// One iteration computes an n x n matrix, Ticked as the map service does until its callback.
+// Reports the cells per second. args: n, parallel routes, router latency (us)
+static void ComputeRouteMatrix( benchmark::State& state )
+{
+    size_t count = size_t( state.range( 0 ) );
+    size_t maxParallelRoutes = size_t( state.range( 1 ) );
+    std::chrono::microseconds latency( state.range( 2 ) );
+
+    RouteOperationManager routeOperations( std::make_unique<FakeRouteBackend>( latency ) );
+    // the cells are background computations, one more operation is kept for the user
+    routeOperations.SetMaxOperations( maxParallelRoutes + 1 );
+
+    gem::LandmarkList origins, destinations;
+    MakeLandmarks( count, origins, destinations );
+
+    size_t completedCells = 0;
+
+    for ( auto _ : state )
+    {
+        bool bCompleted = false;
+
+        auto callback = [&]( RouteMatrixId matrixId, int reason, const RouteMatrix& matrix )
+        {
+            bCompleted = reason == gem::KNoError;
+            completedCells += matrix.timeSeconds.size();
+        };
+
+        RouteMatrixOperation matrix( 1, routeOperations, origins, destinations, gem::RoutePreferences(), ETransportMode::Car, maxParallelRoutes, callback, nullptr );
+
+        while ( matrix.Tick() )
+            std::this_thread::yield();
+
+        if ( !bCompleted )
+        {
+            state.SkipWithError( "matrix not completed" );
+            break;
+        }
+    }
+
+    state.counters["cells/s"] = benchmark::Counter( double( completedCells ), benchmark::Counter::kIsRate );
+}
+
+BENCHMARK( ComputeRouteMatrix )
+    ->ArgNames( { "n", "parallel", "latency_us" } )
+    ->ArgsProduct( { { 4, 16 }, { 1, 8 }, { 0, 200 } } )
+    ->UseRealTime();
@@ -0,0 +1,115 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "TextureUploader.h"
+
+#define SDL_MAIN_HANDLED
+#include <SDL.h>
+
+#include "GLES3/gl3.h"
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+// textures uploaded per frame, about what the Styles view opens with
+const int UPLOADS_PER_FRAME = 32;
+
+// A hidden window with a GLES 3.0 context, shared by all the runs. For a software rasterizer
+// (llvmpipe) run with LIBGL_ALWAYS_SOFTWARE=1 on Mesa.
+static bool MakeContextCurrent()
+{
+    static SDL_Window* window = nullptr;
+    static SDL_GLContext context = nullptr;
+
+    if ( context )
+        return true;
+
+    if ( SDL_Init( SDL_INIT_VIDEO ) != 0 )
+        return false;
+
+#ifdef __WIN32__
+    SDL_SetHint( SDL_HINT_OPENGL_ES_DRIVER, "1" );
+    SDL_SetHint( SDL_HINT_VIDEO_WIN_D3DCOMPILER, "none" );
+#endif
+
+    SDL_GL_SetAttribute( SDL_GL_CONTEXT_FLAGS, 0 );
+    SDL_GL_SetAttribute( SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES );
+    SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, 3 );
+    SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 0 );
+
+    window = SDL_CreateWindow( "TextureUploaderBenchmark", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN );
+    if ( !window )
+        return false;
+
+    context = SDL_GL_CreateContext( window );
+
+    return context && SDL_GL_MakeCurrent( window, context ) == 0;
+}
+
+// One iteration = one frame uploading UPLOADS_PER_FRAME textures of size x size, up to the flush:
+// the time the render thread is blocked. The slowest frame is the hitch; the throughput counts
+// the frame bytes. args: upload mode, size
+static void UploadFrame( benchmark::State& state )
+{
+    if ( !MakeContextCurrent() )
+    {
+        state.SkipWithError( "no GLES 3.0 context" );
+        return;
+    }
+
+    ETextureUploadMode mode = ETextureUploadMode( state.range( 0 ) );
+    int size = int( state.range( 1 ) );
+
+    TextureUploader uploader;
+    uploader.SetMode( mode );
+
+    std::vector<uint8_t> pixels( size_t( size ) * size * TextureUploader::GetBytesPerPixel( ETextureFormat::RGBA8888 ), 0x7F );
+    std::vector<unsigned int> textures;
+    textures.reserve( UPLOADS_PER_FRAME );
+
+    double maxFrameMs = 0;
+
+    for ( auto _ : state )
+    {
+        auto frameStart = std::chrono::steady_clock::now();
+
+        for ( int upload = 0; upload < UPLOADS_PER_FRAME; upload++ )
+            textures.push_back( uploader.Upload( size, size, pixels.data() ) );
+
+        glFlush();
+
+        maxFrameMs = std::max( maxFrameMs, std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - frameStart ).count() );
+
+        state.PauseTiming();
+
+        // the uploads are complete before the next frame, as after a real frame swap
+        glFinish();
+        glDeleteTextures( (GLsizei)textures.size(), textures.data() );
+        textures.clear();
+
+        state.ResumeTiming();
+    }
+
+    // the mode falls back to Direct without pixel buffers support
+    if ( uploader.GetMode() != mode )
+        state.SkipWithError( "pixel buffers not supported" );
+
+    uploader.Release();
+
+    state.SetBytesProcessed( int64_t( state.iterations() ) * UPLOADS_PER_FRAME * int64_t( pixels.size() ) );
+    state.counters["max_frame_ms"] = maxFrameMs;
+}
+
+BENCHMARK( UploadFrame )
+    ->ArgNames( { "mode", "size" } )
+    ->ArgsProduct( { { int( ETextureUploadMode::Direct ), int( ETextureUploadMode::PixelBuffer ) }, { 64, 256, 1024 } } )
+    ->Unit( benchmark::kMillisecond );
@@ -0,0 +1,27 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "ContentCatalog.h"
+
+#include <gtest/gtest.h>
+
+TEST( ContentCatalog, IsoCodesArePacked )
+{
+    EXPECT_EQ( ContentCatalog::IsoToInt( u"DEU" ), 'D' | ( 'E' << 8 ) | ( 'U' << 16 ) );
+    EXPECT_NE( ContentCatalog::IsoToInt( u"DEU" ), ContentCatalog::IsoToInt( u"FRA" ) );
+}
+
+TEST( ContentCatalog, InvalidIsoCodesAreRejected )
+{
+    // short, long, not printable ASCII
+    EXPECT_EQ( ContentCatalog::IsoToInt( u"" ), INVALID_ISO_CODE );
+    EXPECT_EQ( ContentCatalog::IsoToInt( u"DE" ), INVALID_ISO_CODE );
+    EXPECT_EQ( ContentCatalog::IsoToInt( u"DEUT" ), INVALID_ISO_CODE );
+    EXPECT_EQ( ContentCatalog::IsoToInt( u"D U" ), INVALID_ISO_CODE );
+    EXPECT_EQ( ContentCatalog::IsoToInt( u"D\u00C9U" ), INVALID_ISO_CODE );
+}
@@ -0,0 +1,344 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "DownloadScheduler.h"
+
+#include <API/GEM_Error.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <future>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+// Content store stand-in: the downloads progress only when the test transfers bytes and complete
+// when the test says so. Records whether the scheduler lock was held during each call.
+class FakeDownloadBackend : public IDownloadBackend
+{
+public:
+    struct FakeDownload
+    {
+        FakeDownload()
+            : downloadedBytes( 0 )
+            , startCount( 0 )
+            , bRunning( false )
+            , bCanceled( false )
+        {}
+
+        gem::LargeInteger downloadedBytes;
+        int startCount;
+        bool bRunning;
+        bool bCanceled;
+        gem::StrongPointer<gem::IProgressListener> listener;
+    };
+
+    FakeDownloadBackend()
+        : scheduler( nullptr )
+        , startError( gem::KNoError )
+        , bCompleteOnStart( false )
+        , bCalledUnderLock( false )
+    {}
+
+    int StartDownload( gem::LargeInteger itemId, gem::ContentStoreItem& item, gem::StrongPointer<gem::IProgressListener> listener ) override
+    {
+        CheckLock();
+
+        auto& download = downloads[itemId];
+        download.startCount++;
+        download.listener = listener;
+        download.bRunning = startError == gem::KNoError;
+
+        // the SDK may notify a failure from within the start
+        if ( bCompleteOnStart )
+            listener->notifyComplete( startError, gem::String() );
+
+        return startError;
+    }
+
+    void PauseDownload( gem::LargeInteger itemId, gem::ContentStoreItem& item ) override
+    {
+        CheckLock();
+
+        downloads[itemId].bRunning = false;
+    }
+
+    void CancelDownload( gem::LargeInteger itemId, gem::StrongPointer<gem::IProgressListener> listener ) override
+    {
+        CheckLock();
+
+        downloads[itemId].bRunning = false;
+        downloads[itemId].bCanceled = true;
+
+        listener->notifyComplete( gem::error::KCancel, gem::String() );
+    }
+
+    gem::LargeInteger GetDownloadedBytes( gem::LargeInteger itemId, const gem::ContentStoreItem& item ) const override
+    {
+        auto it = downloads.find( itemId );
+
+        return it != downloads.end() ? it->second.downloadedBytes : 0;
+    }
+
+    // each running download receives 'bytes'
+    void Transfer( gem::LargeInteger bytes )
+    {
+        for ( auto& it : downloads )
+            if ( it.second.bRunning )
+                it.second.downloadedBytes += bytes;
+    }
+
+    void Complete( gem::LargeInteger itemId, int reason = gem::KNoError )
+    {
+        auto& download = downloads[itemId];
+        download.bRunning = false;
+
+        download.listener->notifyComplete( reason, gem::String() );
+    }
+
+    std::vector<gem::LargeInteger> GetRunning() const
+    {
+        std::vector<gem::LargeInteger> running;
+
+        for ( const auto& it : downloads )
+            if ( it.second.bRunning )
+                running.push_back( it.first );
+
+        return running;
+    }
+
+    // the scheduler lock is held by the calling thread if another thread can't take it
+    void CheckLock()
+    {
+        if ( !scheduler )
+            return;
+
+        auto probe = std::async( std::launch::async, [this]() { scheduler->GetStats(); } );
+
+        if ( probe.wait_for( 1s ) != std::future_status::ready )
+            bCalledUnderLock = true;
+    }
+
+    std::map<gem::LargeInteger, FakeDownload> downloads;
+
+    DownloadScheduler* scheduler;
+    int startError;
+    bool bCompleteOnStart;
+    bool bCalledUnderLock;
+};
+
+class DownloadSchedulerTest : public ::testing::Test
+{
+protected:
+    DownloadSchedulerTest()
+    {
+        auto backend = std::make_unique<FakeDownloadBackend>();
+        m_backend = backend.get();
+
+        m_scheduler = std::make_unique<DownloadScheduler>( std::move( backend ) );
+        m_backend->scheduler = m_scheduler.get();
+
+        m_now = std::chrono::steady_clock::now();
+    }
+
+    EEnqueueResult Enqueue( gem::LargeInteger itemId, EDownloadPriority priority = EDownloadPriority::UserInitiated )
+    {
+        return m_scheduler->Enqueue( itemId, gem::ContentStoreItem(), priority, [this]( gem::LargeInteger itemId, int reason )
+        {
+            m_completed.push_back( std::make_pair( itemId, reason ) );
+        } );
+    }
+
+    void Tick( std::chrono::milliseconds elapsed )
+    {
+        m_now += elapsed;
+        m_scheduler->Tick( m_now );
+    }
+
+    FakeDownloadBackend* m_backend;
+    std::unique_ptr<DownloadScheduler> m_scheduler;
+
+    std::chrono::steady_clock::time_point m_now;
+    std::vector<std::pair<gem::LargeInteger, int>> m_completed;
+};
+
+TEST_F( DownloadSchedulerTest, StartsInPriorityOrderWithinTheParallelLimit )
+{
+    m_scheduler->SetMaxParallelDownloads( 1 );
+    m_scheduler->PauseQueue();
+
+    Enqueue( 1, EDownloadPriority::BackgroundUpdate );
+    Enqueue( 2, EDownloadPriority::RouteCorridor );
+    Enqueue( 3, EDownloadPriority::UserInitiated );
+
+    m_scheduler->ResumeQueue();
+
+    EXPECT_EQ( m_backend->GetRunning(), std::vector<gem::LargeInteger>( { 3 } ) );
+    EXPECT_EQ( m_scheduler->GetStats().queued, 2u );
+
+    m_backend->Complete( 3 );
+    Tick( 16ms );
+
+    EXPECT_EQ( m_backend->GetRunning(), std::vector<gem::LargeInteger>( { 2 } ) );
+    ASSERT_EQ( m_completed.size(), 1u );
+    EXPECT_EQ( m_completed[0].first, 3 );
+    EXPECT_EQ( m_completed[0].second, gem::KNoError );
+}
+
+TEST_F( DownloadSchedulerTest, PauseQueueRequeuesTheRunningDownloads )
+{
+    Enqueue( 1 );
+    Enqueue( 2 );
+
+    m_scheduler->PauseQueue();
+
+    EXPECT_TRUE( m_backend->GetRunning().empty() );
+    EXPECT_TRUE( m_scheduler->IsScheduled( 1 ) );
+    EXPECT_TRUE( m_scheduler->IsScheduled( 2 ) );
+
+    m_scheduler->ResumeQueue();
+
+    EXPECT_EQ( m_backend->GetRunning().size(), 2u );
+    EXPECT_EQ( m_backend->downloads[1].startCount, 2 );
+}
+
+TEST_F( DownloadSchedulerTest, NotificationsOfARequeuedDownloadAreIgnored )
+{
+    Enqueue( 1 );
+
+    auto oldListener = m_backend->downloads[1].listener;
+
+    m_scheduler->PauseQueue();
+    m_scheduler->ResumeQueue();
+
+    oldListener->notifyComplete( gem::KNoError, gem::String() );
+
+    EXPECT_TRUE( m_completed.empty() );
+    EXPECT_TRUE( m_scheduler->IsScheduled( 1 ) );
+}
+
+TEST_F( DownloadSchedulerTest, StartFailureIsReportedFromTick )
+{
+    m_backend->startError = gem::error::KNotFound;
+
+    Enqueue( 1 );
+
+    EXPECT_TRUE( m_completed.empty() );
+    EXPECT_FALSE( m_scheduler->IsScheduled( 1 ) );
+
+    Tick( 16ms );
+
+    ASSERT_EQ( m_completed.size(), 1u );
+    EXPECT_EQ( m_completed[0].second, gem::error::KNotFound );
+}
+
+TEST_F( DownloadSchedulerTest, EnqueueTellsQueuedFromRefused )
+{
+    m_scheduler->SetMaxParallelDownloads( 1 );
+
+    EXPECT_EQ( Enqueue( 1 ), EEnqueueResult::Started );
+    EXPECT_EQ( Enqueue( 1 ), EEnqueueResult::Started );
+    EXPECT_EQ( Enqueue( 2 ), EEnqueueResult::Queued );
+
+    m_scheduler->SetMaxParallelDownloads( 4 );
+    m_backend->startError = gem::error::KNotFound;
+
+    EXPECT_EQ( Enqueue( 3 ), EEnqueueResult::Refused );
+
+    // notified from within the start
+    m_backend->bCompleteOnStart = true;
+
+    EXPECT_EQ( Enqueue( 4 ), EEnqueueResult::Refused );
+
+    m_scheduler->PauseQueue();
+    m_backend->startError = gem::KNoError;
+    m_backend->bCompleteOnStart = false;
+
+    EXPECT_EQ( Enqueue( 5 ), EEnqueueResult::Queued );
+}
+
+TEST_F( DownloadSchedulerTest, BackendIsNotCalledUnderTheLock )
+{
+    // a synchronous failure notified from within the start reaches the completion once
+    m_backend->startError = gem::error::KNotFound;
+    m_backend->bCompleteOnStart = true;
+
+    Enqueue( 1 );
+    Tick( 16ms );
+
+    m_backend->startError = gem::KNoError;
+    m_backend->bCompleteOnStart = false;
+
+    Enqueue( 2 );
+    m_scheduler->Pause( 2 );
+    Enqueue( 3 );
+    m_scheduler->CancelAll();
+
+    EXPECT_FALSE( m_backend->bCalledUnderLock );
+    EXPECT_EQ( m_completed.size(), 1u );
+    EXPECT_TRUE( m_backend->downloads[3].bCanceled );
+}
+
+TEST_F( DownloadSchedulerTest, ParallelDownloadsAreReducedOverTheRateCap )
+{
+    m_scheduler->SetMaxBytesPerSecond( 1000 );
+
+    Enqueue( 1 );
+    Enqueue( 2 );
+    Enqueue( 3 );
+
+    EXPECT_EQ( m_backend->GetRunning().size(), 3u );
+
+    // 3 x 1000 bytes in 500 ms
+    m_backend->Transfer( 1000 );
+    Tick( 500ms );
+
+    EXPECT_EQ( m_scheduler->GetStats().allowedSlots, 2u );
+    EXPECT_EQ( m_backend->GetRunning(), std::vector<gem::LargeInteger>( { 1, 2 } ) );
+    EXPECT_EQ( m_scheduler->GetStats().queued, 1u );
+}
+
+TEST_F( DownloadSchedulerTest, SingleDownloadIsThrottledToTheRateCap )
+{
+    m_scheduler->SetMaxBytesPerSecond( 1000 );
+
+    Enqueue( 1 );
+
+    // 2000 bytes in 500 ms: 4x the cap, paused for 1.5 s so that the average is the cap
+    m_backend->Transfer( 2000 );
+    Tick( 500ms );
+
+    EXPECT_TRUE( m_scheduler->GetStats().bThrottled );
+    EXPECT_TRUE( m_backend->GetRunning().empty() );
+    EXPECT_TRUE( m_scheduler->IsScheduled( 1 ) );
+
+    Tick( 1400ms );
+
+    EXPECT_TRUE( m_backend->GetRunning().empty() );
+
+    Tick( 100ms );
+
+    EXPECT_FALSE( m_scheduler->GetStats().bThrottled );
+    EXPECT_EQ( m_backend->GetRunning(), std::vector<gem::LargeInteger>( { 1 } ) );
+    EXPECT_EQ( m_backend->downloads[1].startCount, 2 );
+}
+
+TEST_F( DownloadSchedulerTest, SingleDownloadUnderTheRateCapIsNotThrottled )
+{
+    m_scheduler->SetMaxBytesPerSecond( 1000 );
+
+    Enqueue( 1 );
+
+    m_backend->Transfer( 400 );
+    Tick( 500ms );
+
+    EXPECT_FALSE( m_scheduler->GetStats().bThrottled );
+    EXPECT_EQ( m_backend->GetRunning(), std::vector<gem::LargeInteger>( { 1 } ) );
+    EXPECT_EQ( m_backend->downloads[1].startCount, 1 );
+}
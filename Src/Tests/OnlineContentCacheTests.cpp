@@ -0,0 +1,104 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "OnlineContentCache.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+const int MAP_CONTENT_TYPE = 1;
+const int STYLE_CONTENT_TYPE = 2;
+
+class OnlineContentCacheTest : public ::testing::Test
+{
+protected:
+    OnlineContentCacheTest()
+        : m_filePath( ::testing::TempDir() + "OnlineContentCacheTest.txt" )
+        , m_entries( { { 1, 100 }, { 2, 200 }, { 3, 300 } } )
+    {
+        std::remove( m_filePath.c_str() );
+    }
+
+    ~OnlineContentCacheTest()
+    {
+        std::remove( m_filePath.c_str() );
+    }
+
+    std::string m_filePath;
+    OnlineContentEntries m_entries;
+};
+
+TEST_F( OnlineContentCacheTest, StampChangesWithTheItems )
+{
+    size_t stamp = OnlineContentCache::GetStamp( m_entries );
+
+    OnlineContentEntries resized = m_entries;
+    resized[1].sizeBytes++;
+
+    OnlineContentEntries shorter( m_entries.begin(), m_entries.end() - 1 );
+
+    EXPECT_EQ( OnlineContentCache::GetStamp( m_entries ), stamp );
+    EXPECT_NE( OnlineContentCache::GetStamp( resized ), stamp );
+    EXPECT_NE( OnlineContentCache::GetStamp( shorter ), stamp );
+}
+
+TEST_F( OnlineContentCacheTest, DiffListsOnlyTheChangedItems )
+{
+    // 2 resized, 3 removed, 4 added
+    OnlineContentEntries newEntries( { { 1, 100 }, { 2, 250 }, { 4, 400 } } );
+
+    OnlineContentDiff diff = OnlineContentCache::Diff( m_entries, newEntries );
+
+    EXPECT_EQ( diff.changedItems, std::vector<size_t>( { 1, 2 } ) );
+    EXPECT_EQ( diff.removedCount, 1u );
+    EXPECT_FALSE( diff.IsEmpty() );
+
+    EXPECT_TRUE( OnlineContentCache::Diff( m_entries, m_entries ).IsEmpty() );
+}
+
+TEST_F( OnlineContentCacheTest, StoredListsAreReloaded )
+{
+    {
+        OnlineContentCache cache;
+        cache.Open( m_filePath );
+
+        cache.Store( MAP_CONTENT_TYPE, m_entries );
+        cache.Store( STYLE_CONTENT_TYPE, OnlineContentEntries( { { 7, 70 } } ) );
+    }
+
+    OnlineContentCache cache;
+    cache.Open( m_filePath );
+
+    size_t stamp = 0;
+
+    ASSERT_TRUE( cache.GetStamp( MAP_CONTENT_TYPE, stamp ) );
+    EXPECT_EQ( stamp, OnlineContentCache::GetStamp( m_entries ) );
+
+    ASSERT_TRUE( cache.GetStamp( STYLE_CONTENT_TYPE, stamp ) );
+    EXPECT_EQ( stamp, OnlineContentCache::GetStamp( OnlineContentEntries( { { 7, 70 } } ) ) );
+}
+
+TEST_F( OnlineContentCacheTest, TruncatedFileIsIgnored )
+{
+    {
+        std::ofstream file( m_filePath );
+
+        // 3 items announced, 2 written
+        file << MAP_CONTENT_TYPE << ' ' << OnlineContentCache::GetStamp( m_entries ) << " 3\n";
+        file << "1 100\n2 200\n";
+    }
+
+    OnlineContentCache cache;
+    cache.Open( m_filePath );
+
+    size_t stamp = 0;
+
+    EXPECT_FALSE( cache.GetStamp( MAP_CONTENT_TYPE, stamp ) );
+}
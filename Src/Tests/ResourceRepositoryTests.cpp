@@ -0,0 +1,235 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "ResourceRepository.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+// the sizes of the lists the store publishes, a reader seeing another size would have read a torn list
+const size_t LIST_SIZES[] = { 5, 50, 500 };
+
+static bool IsPublishedSize( size_t size )
+{
+    // nothing is served while a type is not available
+    if ( size == 0 )
+        return true;
+
+    for ( auto listSize : LIST_SIZES )
+        if ( size == listSize )
+            return true;
+
+    return false;
+}
+
+static gem::ContentStoreItemList MakeList( size_t size )
+{
+    gem::ContentStoreItemList items;
+
+    for ( size_t index = 0; index < size; index++ )
+        items.push_back( gem::ContentStoreItem() );
+
+    return items;
+}
+
+// A content store whose lists change from the test threads; the list requests are answered when
+// the test completes them. No updaters.
+class FakeContentStore : public IContentStoreBackend
+{
+public:
+    FakeContentStore()
+        : m_listSize( LIST_SIZES[0] )
+    {}
+
+    gem::ContentStoreItemList GetLocalContentList( gem::EContentType type ) override
+    {
+        return MakeList( LIST_SIZES[0] );
+    }
+
+    std::pair<gem::ContentStoreItemList, bool> GetStoreContentList( gem::EContentType type ) override
+    {
+        return std::make_pair( MakeList( m_listSize ), false );
+    }
+
+    void AsyncGetStoreContentList( gem::EContentType type, gem::StrongPointer<gem::IProgressListener> listener ) override
+    {
+        std::lock_guard<std::mutex> guard( m_sync );
+
+        m_requests.push_back( listener );
+    }
+
+    gem::StrongPointer<gem::ContentUpdater> CreateContentUpdater( gem::EContentType type ) override
+    {
+        return gem::StrongPointer<gem::ContentUpdater>();
+    }
+
+    // the next lists requested have 'size' items
+    void SetListSize( size_t size )
+    {
+        m_listSize = size;
+    }
+
+    // answers the pending requests (from the calling thread, like the SDK notifications)
+    void CompleteRequests()
+    {
+        std::vector<gem::StrongPointer<gem::IProgressListener>> requests;
+
+        {
+            std::lock_guard<std::mutex> guard( m_sync );
+
+            requests.swap( m_requests );
+        }
+
+        for ( auto& listener : requests )
+            listener->notifyComplete( gem::KNoError, gem::String() );
+    }
+
+private:
+    std::atomic<size_t> m_listSize;
+
+    std::vector<gem::StrongPointer<gem::IProgressListener>> m_requests;
+    std::mutex m_sync;
+};
+
+class ResourceRepositoryTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        auto store = std::make_unique<FakeContentStore>();
+        m_store = store.get();
+
+        m_repository = std::make_unique<ResourceRepository>( &m_workerPool, std::string(), std::make_shared<CountryMetadata>(), std::move( store ) );
+    }
+
+    void SetOnlineContentStore( gem::EContentType contentType, size_t size )
+    {
+        m_repository->SetOnlineContentStore( contentType, MakeList( size ) );
+    }
+
+    void SetContentTypeState( gem::EContentType contentType, EResourceState state )
+    {
+        m_repository->SetContentTypeState( contentType, state );
+    }
+
+    gem::ContentStoreItemList GetContentStoreItems( EResourceType type )
+    {
+        return m_repository->GetContentStoreItems( type );
+    }
+
+    WorkerPool m_workerPool;
+
+    FakeContentStore* m_store;
+    std::unique_ptr<ResourceRepository> m_repository;
+};
+
+TEST_F( ResourceRepositoryTest, ServesTheListOfTheConnectionState )
+{
+    // offline, the local lists
+    EXPECT_TRUE( m_repository->IsResourceAvailable( EResourceType::Map ) );
+    EXPECT_EQ( GetContentStoreItems( EResourceType::Map ).size(), LIST_SIZES[0] );
+
+    // online, loading until the store answers
+    m_store->SetListSize( LIST_SIZES[1] );
+    m_repository->SetConnected( true );
+
+    EXPECT_FALSE( m_repository->IsResourceAvailable( EResourceType::Map ) );
+    EXPECT_EQ( m_repository->GetContentSnapshot( EResourceType::Map )->catalog.GetItemCount(), 0u );
+
+    m_store->CompleteRequests();
+
+    EXPECT_TRUE( m_repository->IsResourceAvailable( EResourceType::Map ) );
+    EXPECT_EQ( m_repository->GetContentSnapshot( EResourceType::Map )->catalog.GetItemCount(), LIST_SIZES[1] );
+    EXPECT_EQ( GetContentStoreItems( EResourceType::Style ).size(), LIST_SIZES[1] );
+
+    // the last good lists are served right away on the next connection
+    m_repository->SetConnected( false );
+    m_repository->SetConnected( true );
+
+    EXPECT_EQ( GetContentStoreItems( EResourceType::Map ).size(), LIST_SIZES[1] );
+}
+
+// writers on several threads (the connection, the store answers, the lists & states set directly)
+// against readers of the lists, the availability and the snapshots: every list read is one that
+// was published whole
+TEST_F( ResourceRepositoryTest, StressContentStateWritersAgainstReaders )
+{
+    std::atomic<bool> bStop( false );
+    std::atomic<size_t> failures( 0 );
+    std::atomic<size_t> reads( 0 );
+
+    std::vector<std::thread> threads;
+
+    threads.emplace_back( [&]()
+    {
+        for ( int step = 0; !bStop; step++ )
+            m_repository->SetConnected( step % 2 == 0 );
+    } );
+
+    threads.emplace_back( [&]()
+    {
+        for ( size_t step = 0; !bStop; step++ )
+        {
+            m_store->SetListSize( LIST_SIZES[step % 3] );
+            m_store->CompleteRequests();
+        }
+    } );
+
+    threads.emplace_back( [&]()
+    {
+        for ( size_t step = 0; !bStop; step++ )
+            SetOnlineContentStore( step % 2 ? MAP_TYPE : STYLE_TYPE, LIST_SIZES[step % 3] );
+    } );
+
+    threads.emplace_back( [&]()
+    {
+        const EResourceState states[] = { EResourceState::Unavailable, EResourceState::Downloading, EResourceState::Available };
+
+        for ( size_t step = 0; !bStop; step++ )
+            SetContentTypeState( step % 2 ? MAP_TYPE : STYLE_TYPE, states[step % 3] );
+    } );
+
+    size_t readerCount = std::max( 2u, std::thread::hardware_concurrency() / 2 );
+
+    for ( size_t reader = 0; reader < readerCount; reader++ )
+    {
+        threads.emplace_back( [&, reader]()
+        {
+            EResourceType type = reader % 2 ? EResourceType::Map : EResourceType::Style;
+
+            while ( !bStop )
+            {
+                if ( !IsPublishedSize( GetContentStoreItems( type ).size() ) )
+                    failures++;
+
+                m_repository->IsResourceAvailable( type );
+
+                ContentSnapshotPtr snapshot = m_repository->GetContentSnapshot( type );
+                if ( !snapshot || !IsPublishedSize( snapshot->catalog.GetItemCount() ) )
+                    failures++;
+
+                reads++;
+            }
+        } );
+    }
+
+    std::this_thread::sleep_for( 500ms );
+    bStop = true;
+
+    for ( auto& thread : threads )
+        thread.join();
+
+    EXPECT_EQ( failures, 0u );
+    EXPECT_GT( reads, 0u );
+}
@@ -0,0 +1,209 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "RouteArchive.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+
+// coordinates are stored rounded to 1e-6 degrees
+const double COORDINATES_TOLERANCE = 1e-6;
+
+// two waypoints, two routes with a polyline and instructions each
+static StoredRoutes MakeRoutes()
+{
+    StoredRoutes routes;
+    routes.mode = ETransportMode::Bike;
+    routes.mapVersion = ( 7ull << 32 ) | 3;
+
+    routes.waypoints.push_back( gem::Landmark( "Departure", { 45.65119, 25.60480 } ) );
+    routes.waypoints.push_back( gem::Landmark( "Arrival", { 45.84494, 24.97414 } ) );
+
+    for ( int index = 0; index < 2; index++ )
+    {
+        StoredRoute route;
+        route.timeSeconds = 3600 + index * 120;
+        route.distanceMeters = 62000 + index * 1500;
+
+        for ( int point = 0; point < 100; point++ )
+            route.polyline.push_back( gem::Coordinates( 45.65119 + point * 0.0019375, 25.60480 - point * 0.0063066 + index * 0.0001 ) );
+
+        for ( int instruction = 0; instruction < 5; instruction++ )
+        {
+            StoredRouteInstruction stored;
+            stored.coordinates = route.polyline[instruction * 20];
+            stored.timeSeconds = instruction * 700;
+            stored.distanceMeters = instruction * 12000;
+            stored.text = "Turn " + std::to_string( instruction );
+
+            route.instructions.push_back( stored );
+        }
+
+        routes.routes.push_back( route );
+    }
+
+    return routes;
+}
+
+static void ExpectNear( const gem::Coordinates& actual, const gem::Coordinates& expected )
+{
+    EXPECT_NEAR( actual.getLatitude(), expected.getLatitude(), COORDINATES_TOLERANCE );
+    EXPECT_NEAR( actual.getLongitude(), expected.getLongitude(), COORDINATES_TOLERANCE );
+}
+
+// the header size: what an empty archive takes besides its two zero counts
+static size_t GetHeaderSize()
+{
+    std::vector<unsigned char> buffer;
+    RouteArchive::Encode( StoredRoutes(), buffer );
+
+    return buffer.size() - 2;
+}
+
+// the header ends with the payload size, set to match a payload changed by a test
+static void SetPayloadSize( std::vector<unsigned char>& buffer )
+{
+    uint32_t payloadSize = uint32_t( buffer.size() - GetHeaderSize() );
+    memcpy( buffer.data() + GetHeaderSize() - sizeof( payloadSize ), &payloadSize, sizeof( payloadSize ) );
+}
+
+// a failed decode leaves the routes as they were
+static bool Decode( const std::vector<unsigned char>& buffer, StoredRoutes& routes )
+{
+    routes = StoredRoutes();
+    routes.fileSize = 1;
+
+    bool bDecoded = RouteArchive::Decode( buffer.data(), buffer.size(), routes );
+
+    if ( !bDecoded )
+    {
+        EXPECT_EQ( routes.fileSize, 1u );
+    }
+
+    return bDecoded;
+}
+
+TEST( RouteArchive, RoundTrip )
+{
+    StoredRoutes routes = MakeRoutes();
+
+    std::vector<unsigned char> buffer;
+    RouteArchive::Encode( routes, buffer );
+
+    StoredRoutes decoded;
+    ASSERT_TRUE( Decode( buffer, decoded ) );
+
+    EXPECT_EQ( decoded.mode, routes.mode );
+    EXPECT_EQ( decoded.mapVersion, routes.mapVersion );
+
+    ASSERT_EQ( decoded.waypoints.size(), routes.waypoints.size() );
+    for ( size_t index = 0; index < routes.waypoints.size(); index++ )
+    {
+        EXPECT_EQ( decoded.waypoints[index].getName().toStdString(), routes.waypoints[index].getName().toStdString() );
+        ExpectNear( decoded.waypoints[index].getCoordinates(), routes.waypoints[index].getCoordinates() );
+    }
+
+    ASSERT_EQ( decoded.routes.size(), routes.routes.size() );
+    for ( size_t index = 0; index < routes.routes.size(); index++ )
+    {
+        const StoredRoute& route = routes.routes[index];
+        const StoredRoute& decodedRoute = decoded.routes[index];
+
+        EXPECT_EQ( decodedRoute.timeSeconds, route.timeSeconds );
+        EXPECT_EQ( decodedRoute.distanceMeters, route.distanceMeters );
+
+        ASSERT_EQ( decodedRoute.polyline.size(), route.polyline.size() );
+        for ( size_t point = 0; point < route.polyline.size(); point++ )
+            ExpectNear( decodedRoute.polyline[point], route.polyline[point] );
+
+        ASSERT_EQ( decodedRoute.instructions.size(), route.instructions.size() );
+        for ( size_t instruction = 0; instruction < route.instructions.size(); instruction++ )
+        {
+            ExpectNear( decodedRoute.instructions[instruction].coordinates, route.instructions[instruction].coordinates );
+            EXPECT_EQ( decodedRoute.instructions[instruction].timeSeconds, route.instructions[instruction].timeSeconds );
+            EXPECT_EQ( decodedRoute.instructions[instruction].distanceMeters, route.instructions[instruction].distanceMeters );
+            EXPECT_EQ( decodedRoute.instructions[instruction].text, route.instructions[instruction].text );
+        }
+    }
+}
+
+TEST( RouteArchive, RejectsTruncatedData )
+{
+    std::vector<unsigned char> buffer;
+    RouteArchive::Encode( MakeRoutes(), buffer );
+
+    StoredRoutes decoded;
+
+    // cut anywhere, the header size not matching
+    for ( size_t size = 0; size < buffer.size(); size++ )
+        EXPECT_FALSE( Decode( std::vector<unsigned char>( buffer.begin(), buffer.begin() + size ), decoded ) ) << size;
+
+    // cut anywhere in the payload, the header matching (the reads past the end are caught)
+    for ( size_t size = GetHeaderSize(); size < buffer.size(); size++ )
+    {
+        std::vector<unsigned char> truncated( buffer.begin(), buffer.begin() + size );
+        SetPayloadSize( truncated );
+
+        EXPECT_FALSE( Decode( truncated, decoded ) ) << size;
+    }
+}
+
+TEST( RouteArchive, RejectsTrailingData )
+{
+    std::vector<unsigned char> buffer;
+    RouteArchive::Encode( MakeRoutes(), buffer );
+
+    buffer.push_back( 0 );
+
+    StoredRoutes decoded;
+
+    // after the payload
+    EXPECT_FALSE( Decode( buffer, decoded ) );
+
+    // in the payload
+    SetPayloadSize( buffer );
+    EXPECT_FALSE( Decode( buffer, decoded ) );
+}
+
+TEST( RouteArchive, RejectsCorruptCounts )
+{
+    std::vector<unsigned char> buffer;
+    RouteArchive::Encode( StoredRoutes(), buffer );
+
+    StoredRoutes decoded;
+    ASSERT_TRUE( Decode( buffer, decoded ) );
+
+    // more waypoints than bytes left
+    buffer[GetHeaderSize()] = 0x7F;
+    EXPECT_FALSE( Decode( buffer, decoded ) );
+
+    // more routes than bytes left
+    buffer[GetHeaderSize()] = 0;
+    buffer[GetHeaderSize() + 1] = 0x7F;
+    EXPECT_FALSE( Decode( buffer, decoded ) );
+
+    // a huge count (never reserved)
+    buffer.resize( GetHeaderSize() );
+    for ( int index = 0; index < 9; index++ )
+        buffer.push_back( 0xFF );
+    buffer.push_back( 0x01 );
+    SetPayloadSize( buffer );
+
+    EXPECT_FALSE( Decode( buffer, decoded ) );
+
+    // a varint running past 64 bits
+    buffer.resize( GetHeaderSize() );
+    for ( int index = 0; index < 11; index++ )
+        buffer.push_back( 0x80 );
+    buffer.push_back( 0x00 );
+    SetPayloadSize( buffer );
+
+    EXPECT_FALSE( Decode( buffer, decoded ) );
+}
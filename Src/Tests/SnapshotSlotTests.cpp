@@ -0,0 +1,182 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "SnapshotSlot.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+// every value is the version, a reader seeing a mix would have read a half written snapshot
+struct TestSnapshot
+{
+    TestSnapshot( size_t version )
+        : version( version )
+        , values( 1024, version )
+    {}
+
+    size_t version;
+    std::vector<size_t> values;
+};
+
+using TestSnapshotPtr = SnapshotSlot<TestSnapshot>::Ptr;
+
+TEST( SnapshotSlot, BuildsOnceUntilInvalidated )
+{
+    SnapshotSlot<TestSnapshot> slot;
+    int builds = 0;
+
+    auto build = [&]() { return std::make_shared<const TestSnapshot>( ++builds ); };
+
+    EXPECT_EQ( slot.Load(), nullptr );
+    EXPECT_EQ( slot.Get( build )->version, 1u );
+    EXPECT_EQ( slot.Get( build )->version, 1u );
+
+    slot.Invalidate();
+
+    EXPECT_EQ( slot.Load(), nullptr );
+    EXPECT_EQ( slot.Get( build )->version, 2u );
+}
+
+TEST( SnapshotSlot, ReplaceOnlyTheExpectedSnapshot )
+{
+    SnapshotSlot<TestSnapshot> slot;
+
+    TestSnapshotPtr first = slot.Get( []() { return std::make_shared<const TestSnapshot>( 1 ); } );
+
+    EXPECT_TRUE( slot.Replace( first, std::make_shared<const TestSnapshot>( 2 ) ) );
+    EXPECT_FALSE( slot.Replace( first, std::make_shared<const TestSnapshot>( 3 ) ) );
+    EXPECT_EQ( slot.Load()->version, 2u );
+
+    // the previous version stays valid for its holders
+    EXPECT_EQ( first->values.back(), 1u );
+}
+
+TEST( SnapshotSlot, ModifyPublishesACopy )
+{
+    SnapshotSlot<TestSnapshot> slot;
+    auto modify = []( TestSnapshot& snapshot ) { snapshot.version++; };
+
+    // nothing to modify
+    EXPECT_FALSE( slot.Modify( modify ) );
+    EXPECT_EQ( slot.Load(), nullptr );
+
+    TestSnapshotPtr first = slot.Get( []() { return std::make_shared<const TestSnapshot>( 1 ); } );
+
+    EXPECT_TRUE( slot.Modify( modify ) );
+
+    EXPECT_EQ( slot.Load()->version, 2u );
+    EXPECT_EQ( slot.Load()->values.back(), 1u );
+
+    // the previous version is untouched
+    EXPECT_EQ( first->version, 1u );
+}
+
+TEST( SnapshotSlot, InvalidationDuringABuildIsNotLost )
+{
+    SnapshotSlot<TestSnapshot> slot;
+
+    std::promise<void> buildStarted, buildRelease;
+    std::atomic<size_t> dataVersion( 1 );
+
+    auto builder = std::async( std::launch::async, [&]()
+    {
+        return slot.Get( [&]()
+        {
+            size_t version = dataVersion;
+
+            buildStarted.set_value();
+            buildRelease.get_future().wait();
+
+            return std::make_shared<const TestSnapshot>( version );
+        } );
+    } );
+
+    buildStarted.get_future().wait();
+
+    // the data changes while the build reads it
+    dataVersion = 2;
+    auto invalidator = std::async( std::launch::async, [&]() { slot.Invalidate(); } );
+
+    EXPECT_EQ( invalidator.wait_for( 50ms ), std::future_status::timeout );
+
+    buildRelease.set_value();
+    EXPECT_EQ( builder.get()->version, 1u );
+    invalidator.get();
+
+    EXPECT_EQ( slot.Get( [&]() { return std::make_shared<const TestSnapshot>( dataVersion ); } )->version, 2u );
+}
+
+// readers on every core against a writer which keeps invalidating & replacing the snapshot:
+// no reader ever sees a torn snapshot or an older version than one it already saw
+TEST( SnapshotSlot, StressReadersAgainstWriter )
+{
+    SnapshotSlot<TestSnapshot> slot;
+    std::atomic<size_t> lastVersion( 0 );
+    std::atomic<bool> bStop( false );
+    std::atomic<size_t> failures( 0 );
+    std::atomic<size_t> reads( 0 );
+
+    auto build = [&]() { return std::make_shared<const TestSnapshot>( ++lastVersion ); };
+
+    std::vector<std::thread> readers;
+    size_t readerCount = std::max( 2u, std::thread::hardware_concurrency() ) - 1;
+
+    for ( size_t reader = 0; reader < readerCount; reader++ )
+    {
+        readers.emplace_back( [&]()
+        {
+            size_t seenVersion = 0;
+
+            while ( !bStop )
+            {
+                TestSnapshotPtr snapshot = slot.Get( build );
+
+                bool bTorn = false;
+                for ( auto value : snapshot->values )
+                    bTorn |= value != snapshot->version;
+
+                if ( bTorn || snapshot->version < seenVersion )
+                    failures++;
+
+                seenVersion = snapshot->version;
+                reads++;
+            }
+        } );
+    }
+
+    auto endTime = std::chrono::steady_clock::now() + 500ms;
+
+    for ( int step = 0; std::chrono::steady_clock::now() < endTime; step++ )
+    {
+        if ( step % 2 )
+        {
+            slot.Invalidate();
+        }
+        else
+        {
+            TestSnapshotPtr current = slot.Load();
+            if ( current )
+                slot.Replace( current, build() );
+        }
+    }
+
+    bStop = true;
+
+    for ( auto& reader : readers )
+        reader.join();
+
+    EXPECT_EQ( failures, 0u );
+    EXPECT_GT( reads, 0u );
+}
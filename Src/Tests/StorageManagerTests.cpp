@@ -0,0 +1,131 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "StorageManager.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+
+const gem::LargeInteger MAP_SIZE = 100;
+
+// Downloaded maps of a fake store: ids 1 to 4, MAP_SIZE bytes each, the first one in "DEU"
+class StorageManagerTest : public ::testing::Test
+{
+protected:
+    StorageManagerTest()
+    {
+        for ( gem::LargeInteger itemId = 1; itemId <= 4; itemId++ )
+            m_storedMaps.push_back( StoredMap( itemId, MAP_SIZE, { itemId == 1 ? u"DEU" : u"FRA" } ) );
+    }
+
+    gem::LargeInteger GetUsedBytes() const
+    {
+        return gem::LargeInteger( m_storedMaps.size() ) * MAP_SIZE;
+    }
+
+    std::vector<gem::LargeInteger> SelectEvictions( gem::LargeInteger requiredBytes, bool& bFits ) const
+    {
+        std::vector<size_t> evictions;
+        bFits = m_storageManager.SelectEvictions( m_storedMaps, GetUsedBytes(), requiredBytes, evictions );
+
+        std::vector<gem::LargeInteger> itemIds;
+        for ( auto index : evictions )
+            itemIds.push_back( m_storedMaps[index].itemId );
+
+        return itemIds;
+    }
+
+    StorageManager m_storageManager;
+    std::vector<StoredMap> m_storedMaps;
+};
+
+TEST_F( StorageManagerTest, NothingIsEvictedWithoutQuota )
+{
+    bool bFits = false;
+
+    EXPECT_TRUE( SelectEvictions( 1000 * MAP_SIZE, bFits ).empty() );
+    EXPECT_TRUE( bFits );
+}
+
+TEST_F( StorageManagerTest, NothingIsEvictedUnderQuota )
+{
+    m_storageManager.SetQuota( 5 * MAP_SIZE );
+
+    bool bFits = false;
+
+    EXPECT_TRUE( SelectEvictions( MAP_SIZE, bFits ).empty() );
+    EXPECT_TRUE( bFits );
+}
+
+TEST_F( StorageManagerTest, NeverUsedMapsAreEvictedFirst )
+{
+    m_storageManager.SetQuota( 4 * MAP_SIZE );
+
+    m_storageManager.MarkItemUsed( 2 );
+    m_storageManager.MarkItemUsed( 4 );
+
+    bool bFits = false;
+
+    EXPECT_EQ( SelectEvictions( 2 * MAP_SIZE, bFits ), std::vector<gem::LargeInteger>( { 1, 3 } ) );
+    EXPECT_TRUE( bFits );
+}
+
+TEST_F( StorageManagerTest, ProtectedCountriesAreKept )
+{
+    m_storageManager.SetQuota( 4 * MAP_SIZE );
+    m_storageManager.SetProtectedCountries( { u"DEU" } );
+
+    bool bFits = false;
+
+    EXPECT_EQ( SelectEvictions( MAP_SIZE, bFits ), std::vector<gem::LargeInteger>( { 2 } ) );
+    EXPECT_TRUE( bFits );
+}
+
+TEST_F( StorageManagerTest, DownloadOverQuotaIsRefused )
+{
+    m_storageManager.SetQuota( 4 * MAP_SIZE );
+    m_storageManager.SetProtectedCountries( { u"FRA" } );
+
+    // only the "DEU" map can go, which is not enough
+    bool bFits = true;
+
+    EXPECT_TRUE( SelectEvictions( 2 * MAP_SIZE, bFits ).empty() );
+    EXPECT_FALSE( bFits );
+
+    // bigger than the quota itself
+    m_storageManager.SetProtectedCountries( {} );
+
+    EXPECT_TRUE( SelectEvictions( 5 * MAP_SIZE, bFits ).empty() );
+    EXPECT_FALSE( bFits );
+}
+
+TEST_F( StorageManagerTest, LastUseTimesAreReloaded )
+{
+    std::string filePath = ::testing::TempDir() + "StorageManagerTest.txt";
+    std::remove( filePath.c_str() );
+
+    {
+        StorageManager storageManager;
+        storageManager.Open( filePath );
+
+        storageManager.MarkItemUsed( 1 );
+        storageManager.MarkItemUsed( 2 );
+        storageManager.MarkItemUsed( 3 );
+    }
+
+    m_storageManager.Open( filePath );
+    m_storageManager.SetQuota( 4 * MAP_SIZE );
+
+    bool bFits = false;
+
+    EXPECT_EQ( SelectEvictions( MAP_SIZE, bFits ), std::vector<gem::LargeInteger>( { 4 } ) );
+    EXPECT_TRUE( bFits );
+
+    std::remove( filePath.c_str() );
+}
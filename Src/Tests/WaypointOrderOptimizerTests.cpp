@@ -0,0 +1,261 @@
+// Copyright (C) 2019-2023, Magic Lane B.V.
+// All rights reserved.
+//
+// This software is confidential and proprietary information of Magic Lane
+// ("Confidential Information"). You shall not disclose such Confidential
+// Information and shall use it only in accordance with the terms of the
+// license agreement you entered into with Magic Lane.
+
+#include "WaypointOrderOptimizer.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <future>
+#include <random>
+#include <thread>
+#include <numeric>
+#include <algorithm>
+
+using namespace std::chrono_literals;
+
+// searches of each optimisation, as the map service starts one per worker thread
+const size_t SEARCH_COUNT = 4;
+
+// by origin, count x count
+static RouteMatrix MakeMatrix( size_t count, const std::vector<int>& timeSeconds )
+{
+    RouteMatrix matrix;
+    matrix.originCount = count;
+    matrix.destinationCount = count;
+    matrix.timeSeconds = timeSeconds;
+    matrix.distanceMeters.assign( timeSeconds.size(), 0 );
+
+    return matrix;
+}
+
+// travel times 1 to 100, unrelated in the two directions
+static RouteMatrix MakeRandomMatrix( size_t count, unsigned int seed )
+{
+    std::mt19937 random( seed );
+    std::uniform_int_distribution<int> timeSeconds( 1, 100 );
+
+    std::vector<int> times( count * count, 0 );
+
+    for ( size_t origin = 0; origin < count; origin++ )
+        for ( size_t destination = 0; destination < count; destination++ )
+            if ( origin != destination )
+                times[origin * count + destination] = timeSeconds( random );
+
+    return MakeMatrix( count, times );
+}
+
+// the cost of every order of the intermediate stops
+static long long GetBestCost( const WaypointOrderOptimizer& optimizer, size_t count )
+{
+    std::vector<size_t> order( count );
+    std::iota( order.begin(), order.end(), size_t( 0 ) );
+
+    long long bestCost = optimizer.GetCost( order );
+
+    while ( std::next_permutation( order.begin() + 1, order.end() - 1 ) )
+        bestCost = std::min( bestCost, optimizer.GetCost( order ) );
+
+    return bestCost;
+}
+
+static WaypointOrderReport Optimize( WorkerPool& workerPool, const RouteMatrix& matrix )
+{
+    auto optimizer = std::make_shared<WaypointOrderOptimizer>( matrix );
+    optimizer->Start( workerPool, SEARCH_COUNT );
+
+    auto deadline = std::chrono::steady_clock::now() + 10s;
+
+    while ( !optimizer->IsDone() && std::chrono::steady_clock::now() < deadline )
+        std::this_thread::sleep_for( 1ms );
+
+    EXPECT_TRUE( optimizer->IsDone() );
+
+    return optimizer->GetReport();
+}
+
+// the departure first, the arrival last, each waypoint once
+static void ExpectValidOrder( const std::vector<size_t>& order, size_t count )
+{
+    ASSERT_EQ( order.size(), count );
+
+    EXPECT_EQ( order.front(), 0u );
+    EXPECT_EQ( order.back(), count - 1 );
+
+    std::vector<size_t> sorted = order;
+    std::sort( sorted.begin(), sorted.end() );
+
+    for ( size_t index = 0; index < count; index++ )
+        EXPECT_EQ( sorted[index], index );
+}
+
+class WaypointOrderOptimizerTest : public ::testing::Test
+{
+protected:
+    WorkerPool m_workerPool;
+};
+
+TEST_F( WaypointOrderOptimizerTest, FindsTheOnlyCheapChain )
+{
+    // 0 -> 4 -> 2 -> 5 -> 1 -> 3 -> 6 takes 1 s a leg, any other leg (the reversed ones included) 100 s
+    const size_t count = 7;
+    const std::vector<size_t> chain = { 0, 4, 2, 5, 1, 3, 6 };
+
+    std::vector<int> times( count * count, 100 );
+    for ( size_t index = 1; index < chain.size(); index++ )
+        times[chain[index - 1] * count + chain[index]] = 1;
+
+    WaypointOrderReport report = Optimize( m_workerPool, MakeMatrix( count, times ) );
+
+    EXPECT_EQ( report.order, chain );
+    EXPECT_EQ( report.optimizedSeconds, 6 );
+    EXPECT_EQ( report.inputSeconds, 600 );
+}
+
+TEST_F( WaypointOrderOptimizerTest, MatchesTheBestOrderOfThreeStops )
+{
+    // with 3 intermediate stops every order is one move away, the local search ends on the best one
+    const size_t count = 5;
+
+    for ( unsigned int seed = 1; seed <= 50; seed++ )
+    {
+        RouteMatrix matrix = MakeRandomMatrix( count, seed );
+        WaypointOrderOptimizer optimizer( matrix );
+
+        WaypointOrderReport report = Optimize( m_workerPool, matrix );
+
+        ExpectValidOrder( report.order, count );
+        EXPECT_EQ( report.optimizedSeconds, GetBestCost( optimizer, count ) ) << seed;
+        EXPECT_EQ( report.optimizedSeconds, optimizer.GetCost( report.order ) ) << seed;
+    }
+}
+
+TEST_F( WaypointOrderOptimizerTest, NeverWorseThanTheInputOrder )
+{
+    const size_t count = 8;
+
+    for ( unsigned int seed = 1; seed <= 20; seed++ )
+    {
+        RouteMatrix matrix = MakeRandomMatrix( count, seed );
+        WaypointOrderOptimizer optimizer( matrix );
+
+        WaypointOrderReport report = Optimize( m_workerPool, matrix );
+
+        ExpectValidOrder( report.order, count );
+        EXPECT_LE( report.optimizedSeconds, report.inputSeconds ) << seed;
+        EXPECT_GE( report.optimizedSeconds, GetBestCost( optimizer, count ) ) << seed;
+    }
+}
+
+TEST_F( WaypointOrderOptimizerTest, KeepsTheDepartureAndTheArrival )
+{
+    // leaving from the arrival and going back to the departure are free, the stops between them are not
+    const size_t count = 6;
+
+    std::vector<int> times( count * count, 50 );
+    for ( size_t index = 0; index < count; index++ )
+    {
+        times[( count - 1 ) * count + index] = 0;
+        times[index * count + 0] = 0;
+        times[index * count + index] = 0;
+    }
+
+    RouteMatrix matrix = MakeMatrix( count, times );
+    WaypointOrderOptimizer optimizer( matrix );
+
+    WaypointOrderReport report = Optimize( m_workerPool, matrix );
+
+    ExpectValidOrder( report.order, count );
+    EXPECT_EQ( report.optimizedSeconds, 250 );
+}
+
+TEST_F( WaypointOrderOptimizerTest, CompletesOnAStoppedPool )
+{
+    RouteMatrix matrix = MakeRandomMatrix( 6, 1 );
+
+    // stopped before the searches are queued
+    {
+        WorkerPool workerPool( 1 );
+        workerPool.Stop();
+
+        auto optimizer = std::make_shared<WaypointOrderOptimizer>( matrix );
+        optimizer->Start( workerPool, SEARCH_COUNT );
+
+        EXPECT_TRUE( optimizer->IsDone() );
+
+        // nothing searched, the input order
+        WaypointOrderReport report = optimizer->GetReport();
+        EXPECT_EQ( report.optimizedSeconds, report.inputSeconds );
+    }
+
+    // stopped with the searches queued behind a running task
+    {
+        WorkerPool workerPool( 1 );
+
+        std::promise<void> release;
+        std::shared_future<void> released = release.get_future().share();
+
+        workerPool.Execute( [released]() { released.wait(); }, 1 );
+
+        auto optimizer = std::make_shared<WaypointOrderOptimizer>( matrix );
+        optimizer->Start( workerPool, SEARCH_COUNT );
+
+        std::thread stopThread( [&]() { workerPool.Stop(); } );
+
+        std::this_thread::sleep_for( 50ms );
+        release.set_value();
+        stopThread.join();
+
+        EXPECT_TRUE( optimizer->IsDone() );
+    }
+}
+
+TEST( WaypointOrderCandidates, RoutesTheLegsBetweenNearWaypoints )
+{
+    // on a line, 1, 2, 3 and 4 km apart (about 0.009 degrees a km)
+    const double kilometers[] = { 0, 1, 3, 6, 10 };
+
+    gem::LandmarkList waypoints;
+    for ( auto offset : kilometers )
+        waypoints.push_back( gem::Landmark( "Stop", { 45.0 + offset * 0.008993, 25.0 } ) );
+
+    RouteMatrix estimate = WaypointOrderOptimizer::EstimateMatrix( waypoints, ETransportMode::Car );
+
+    // 1.3 km of road at 50 km/h
+    EXPECT_NEAR( estimate.timeSeconds[estimate.GetCell( 0, 1 )], 94, 1 );
+    EXPECT_NEAR( estimate.timeSeconds[estimate.GetCell( 0, 2 )], 3 * estimate.timeSeconds[estimate.GetCell( 0, 1 )], 1 );
+
+    std::vector<size_t> cells = WaypointOrderOptimizer::GetCandidateCells( estimate, 1 );
+
+    // the legs to the nearest stop and back, never into the departure nor out of the arrival
+    std::vector<size_t> expected = {
+        estimate.GetCell( 0, 1 ),
+        estimate.GetCell( 1, 2 ),
+        estimate.GetCell( 2, 1 ), estimate.GetCell( 2, 3 ),
+        estimate.GetCell( 3, 2 ), estimate.GetCell( 3, 4 ),
+    };
+    std::sort( expected.begin(), expected.end() );
+
+    EXPECT_EQ( cells, expected );
+
+    // roads twice as slow as estimated, one leg without a route
+    RouteMatrix routed = MakeMatrix( 5, std::vector<int>( 25, -1 ) );
+    for ( auto cell : cells )
+        routed.timeSeconds[cell] = 2 * estimate.timeSeconds[cell];
+    routed.timeSeconds[estimate.GetCell( 3, 2 )] = -1;
+
+    RouteMatrix merged = WaypointOrderOptimizer::MergeMatrix( estimate, routed, cells );
+
+    EXPECT_EQ( merged.timeSeconds[merged.GetCell( 1, 2 )], routed.timeSeconds[merged.GetCell( 1, 2 )] );
+    EXPECT_EQ( merged.timeSeconds[merged.GetCell( 3, 2 )], -1 );
+    EXPECT_EQ( merged.failedCount, 1u );
+
+    // scaled like the routed legs
+    EXPECT_EQ( merged.timeSeconds[merged.GetCell( 1, 3 )], 2 * estimate.timeSeconds[estimate.GetCell( 1, 3 )] );
+    EXPECT_EQ( merged.timeSeconds[merged.GetCell( 4, 0 )], 2 * estimate.timeSeconds[estimate.GetCell( 4, 0 )] );
+}